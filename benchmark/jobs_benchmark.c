@@ -0,0 +1,146 @@
+/* Benchmark of the job system against doing the same work on one thread, it doesn't need a GL context
+ * build with build/benchmark.sh jobs, the worker count can be given as the first argument (default: one per core)
+*/
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "../src/data_types/arena.c"
+#include "../src/data_types/jobs.c"
+
+#ifndef BENCHMARK_REPEATS
+#define BENCHMARK_REPEATS 10
+#endif
+
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+// The checksum keeps the compiler from throwing the work away and makes sure both versions agree (the code can contain commas)
+#define BENCHMARK(name, checksum, ...) do {\
+    double checksum = 0;\
+    double start = now_seconds();\
+    for(uint32_t repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) { __VA_ARGS__ }\
+    double seconds = (now_seconds() - start) / BENCHMARK_REPEATS;\
+    printf("%-28s %10.3f ms (checksum %.6g)\n", name, seconds*1e3, checksum);\
+  } while(0)
+
+//------------------------------------------
+// Fan out / fan in
+//------------------------------------------
+
+#define FAN_OUT_JOBS 100000
+#define FAN_OUT_WORK 200
+
+typedef struct {
+  uint32_t seed;
+  double result;
+} FanOutTask;
+
+// A small amount of work that can't be vectorised away
+static void fan_out_work(void* data) {
+  FanOutTask* task = data;
+  uint32_t x = task->seed | 1;
+  double sum = 0;
+  for(uint32_t i = 0; i < FAN_OUT_WORK; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sum += (double)(x & 0xffff);
+  }
+  task->result = sum;
+}
+
+//------------------------------------------
+// Parallel for
+//------------------------------------------
+
+#define PARALLEL_FOR_COUNT ((size_t)1 << 24)
+
+typedef struct {
+  const float* input;
+  float* output;
+} TransformData;
+
+static void transform_range(void* data, size_t begin, size_t end) {
+  TransformData* transform = data;
+  for(size_t i = begin; i < end; i++) transform->output[i] = sqrtf(transform->input[i]) * 0.5f + 1.0f;
+}
+
+//------------------------------------------
+// Dependencies (jobs that start and wait on their own jobs)
+//------------------------------------------
+
+typedef struct {
+  uint32_t n;
+  uint64_t result;
+} FibTask;
+
+static uint64_t fib_serial(uint32_t n) { return n < 2 ? n : fib_serial(n-1) + fib_serial(n-2); }
+
+static void fib_job(void* data) {
+  FibTask* task = data;
+  if(task->n < 20) {
+    task->result = fib_serial(task->n);
+    return;
+  }
+  FibTask children[2] = {{task->n - 1, 0}, {task->n - 2, 0}};
+  Job jobs[2] = {{fib_job, &children[0]}, {fib_job, &children[1]}};
+  JobCounter counter = {0};
+  run_jobs(jobs, 2, &counter);
+  wait_for_counter(&counter);
+  task->result = children[0].result + children[1].result;
+}
+
+int main(int argc, char** argv) {
+  uint32_t workerCount = argc > 1 ? atoi(argv[1]) : 0;
+  setup_job_system(workerCount);
+  printf("%u workers\n", job_worker_count());
+
+  Arena arena = create_virtual_arena((size_t)1 << 32);
+
+  FanOutTask* tasks = arena_alloc_array(&arena, FanOutTask, FAN_OUT_JOBS);
+  Job* jobs = arena_alloc_array(&arena, Job, FAN_OUT_JOBS);
+  for(uint32_t i = 0; i < FAN_OUT_JOBS; i++) {
+    tasks[i] = (FanOutTask){i, 0};
+    jobs[i] = (Job){fan_out_work, &tasks[i]};
+  }
+
+  BENCHMARK("fan out (serial)", checksum, {
+    for(uint32_t i = 0; i < FAN_OUT_JOBS; i++) fan_out_work(&tasks[i]);
+    for(uint32_t i = 0; i < FAN_OUT_JOBS; i++) checksum += tasks[i].result;
+  });
+  BENCHMARK("fan out (jobs)", checksum, {
+    JobCounter counter = {0};
+    run_jobs(jobs, FAN_OUT_JOBS, &counter);
+    wait_for_counter(&counter);
+    for(uint32_t i = 0; i < FAN_OUT_JOBS; i++) checksum += tasks[i].result;
+  });
+
+  float* input = arena_alloc_array(&arena, float, PARALLEL_FOR_COUNT);
+  float* output = arena_alloc_array(&arena, float, PARALLEL_FOR_COUNT);
+  for(size_t i = 0; i < PARALLEL_FOR_COUNT; i++) input[i] = (float)i;
+  TransformData transform = {input, output};
+
+  BENCHMARK("parallel for (serial)", checksum, {
+    transform_range(&transform, 0, PARALLEL_FOR_COUNT);
+    checksum += output[PARALLEL_FOR_COUNT-1] + output[PARALLEL_FOR_COUNT/2];
+  });
+  BENCHMARK("parallel for (jobs)", checksum, {
+    parallel_for(PARALLEL_FOR_COUNT, 16384, transform_range, &transform);
+    checksum += output[PARALLEL_FOR_COUNT-1] + output[PARALLEL_FOR_COUNT/2];
+  });
+
+  BENCHMARK("fib 32 (serial)", checksum, { checksum += fib_serial(32); });
+  BENCHMARK("fib 32 (jobs)", checksum, {
+    FibTask task = {32, 0};
+    fib_job(&task);
+    checksum += task.result;
+  });
+
+  shutdown_job_system();
+  free_arena(&arena);
+  return 0;
+}
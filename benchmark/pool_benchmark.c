@@ -0,0 +1,138 @@
+/* Contention benchmark of the concurrent pool against malloc/free and a DEFINE_POOL behind a mutex
+ * build with build/benchmark.sh pool, runs every allocator at 1 to 32 threads
+*/
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../src/data_types/arena.c"
+#include "../src/data_types/pool.c"
+
+#define MAX_THREADS 32
+#define ROUNDS 20000
+// elements a thread holds at once (like a loader building up a batch of meshes before handing them off)
+#define BATCH 64
+
+typedef struct {
+  float modelMatrix[16];
+} Element;
+
+DEFINE_POOL(Element)
+DEFINE_CONCURRENT_POOL(Element)
+
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+typedef enum {
+  ALLOCATOR_MALLOC,
+  ALLOCATOR_LOCKED_POOL,
+  ALLOCATOR_CONCURRENT_POOL,
+  ALLOCATOR_CONCURRENT_POOL_BULK,
+  ALLOCATOR_COUNT,
+} Allocator;
+
+static const char* allocatorNames[ALLOCATOR_COUNT] = {
+  "malloc/free",
+  "pool + mutex",
+  "concurrent pool",
+  "concurrent pool (bulk free)",
+};
+
+static Pool(Element) lockedPool;
+static pthread_mutex_t lockedPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static ConcurrentPool(Element) concurrentPool;
+
+static pthread_barrier_t startBarrier;
+static _Atomic uint64_t failures;
+
+static void* bench_thread(void* data) {
+  Allocator allocator = (Allocator)(uintptr_t)data;
+  Element* held[BATCH];
+  pthread_barrier_wait(&startBarrier);
+
+  for(uint32_t round = 0; round < ROUNDS; round++) {
+    for(uint32_t i = 0; i < BATCH; i++) {
+      Element* element = NULL;
+      switch(allocator) {
+        case ALLOCATOR_MALLOC:
+          element = malloc(sizeof(Element));
+          break;
+        case ALLOCATOR_LOCKED_POOL:
+          pthread_mutex_lock(&lockedPoolMutex);
+          element = pool_alloc(Element, &lockedPool);
+          pthread_mutex_unlock(&lockedPoolMutex);
+          break;
+        case ALLOCATOR_CONCURRENT_POOL:
+        case ALLOCATOR_CONCURRENT_POOL_BULK:
+          element = concurrent_pool_alloc(Element, &concurrentPool);
+          break;
+        case ALLOCATOR_COUNT:
+          break;
+      }
+      if(!element) {
+        atomic_fetch_add(&failures, 1);
+        abort();
+      }
+      element->modelMatrix[0] = i;
+      held[i] = element;
+    }
+
+    //free in a different order than the allocs
+    switch(allocator) {
+      case ALLOCATOR_MALLOC:
+        for(uint32_t i = 0; i < BATCH; i++) free(held[(i * 7) % BATCH]);
+        break;
+      case ALLOCATOR_LOCKED_POOL:
+        for(uint32_t i = 0; i < BATCH; i++) {
+          pthread_mutex_lock(&lockedPoolMutex);
+          pool_remove(Element, &lockedPool, held[(i * 7) % BATCH]);
+          pthread_mutex_unlock(&lockedPoolMutex);
+        }
+        break;
+      case ALLOCATOR_CONCURRENT_POOL:
+        for(uint32_t i = 0; i < BATCH; i++) concurrent_pool_free(Element, &concurrentPool, held[(i * 7) % BATCH]);
+        break;
+      case ALLOCATOR_CONCURRENT_POOL_BULK:
+        concurrent_pool_free_bulk(Element, &concurrentPool, held, BATCH);
+        break;
+      case ALLOCATOR_COUNT:
+        break;
+    }
+  }
+
+  if(allocator >= ALLOCATOR_CONCURRENT_POOL) concurrent_pool_flush(Element, &concurrentPool);
+  return NULL;
+}
+
+int main(void) {
+  //every thread holds a batch and can have a full magazine on top of it
+  size_t capacity = MAX_THREADS * (BATCH + CONCURRENT_POOL_MAGAZINE_SIZE);
+  lockedPool = create_pool(Element, malloc(capacity * sizeof(Node(Element))), capacity);
+  concurrentPool = create_concurrent_pool(Element, NULL, capacity);
+
+  printf("%-28s %8s %12s\n", "allocator", "threads", "Mops/s");
+  for(Allocator allocator = 0; allocator < ALLOCATOR_COUNT; allocator++) {
+    for(uint32_t threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2) {
+      pthread_t threads[MAX_THREADS];
+      pthread_barrier_init(&startBarrier, NULL, threadCount + 1);
+      for(uint32_t i = 0; i < threadCount; i++) pthread_create(&threads[i], NULL, bench_thread, (void*)(uintptr_t)allocator);
+
+      pthread_barrier_wait(&startBarrier);
+      double start = now_seconds();
+      for(uint32_t i = 0; i < threadCount; i++) pthread_join(threads[i], NULL);
+      double seconds = now_seconds() - start;
+      pthread_barrier_destroy(&startBarrier);
+
+      //an op is one alloc and one free
+      double ops = (double)threadCount * ROUNDS * BATCH;
+      printf("%-28s %8u %12.1f\n", allocatorNames[allocator], threadCount, ops / seconds * 1e-6);
+    }
+  }
+
+  free_pool(Element, &lockedPool);
+  free_concurrent_pool(Element, &concurrentPool);
+  return failures != 0;
+}
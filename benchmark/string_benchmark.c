@@ -0,0 +1,238 @@
+/* Microbenchmark of the string scanning functions against the byte at a time versions they replaced
+ * build with build/benchmark.sh string, run from the root of the repo (the input file can be given as the first argument)
+*/
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/data_types/string.c"
+#include "../src/data_types/arena.c"
+#include "../src/data_types/io.c"
+
+#define BENCHMARK_REPEATS 200
+
+//------------------------------------------
+// The old versions
+//------------------------------------------
+
+static int32_t naive_string_find(String string, const char c) {
+  for(size_t i = 0; i < string.len; i++) {
+    if(string.data[i] == c) return i;
+  }
+  return -1;
+}
+
+static int32_t naive_string_find_substring(const String parent, const String child) {
+  if(child.len > parent.len) return -1;
+  for(size_t i = 0; i < parent.len-child.len+1; i++) {
+    if(string_equals(child, string_span(parent.data+i, parent.data+i+child.len))) return i;
+  }
+  return -1;
+}
+
+static int32_t naive_string_find_any(String string, String set) {
+  for(size_t i = 0; i < string.len; i++) {
+    if(naive_string_find(set, string.data[i]) != -1) return i;
+  }
+  return -1;
+}
+
+static Cut naive_string_cut(String string, const char c) {
+  if(string.len == 0) return (Cut){0};
+  const char* begin = string.data;
+  const char* end = begin + string.len;
+  const char* cutPtr = begin;
+  for(; cutPtr<end && *cutPtr!=c; cutPtr++);
+  return (Cut){ .found=cutPtr<end, .head=string_span(begin, cutPtr), .tail=string_span(cutPtr+(cutPtr<end), end)};
+}
+
+static String naive_string_trim_left(String string, String removals) {
+  for (; string.len && naive_string_find(removals, *string.data) != -1; string.data++, string.len--);
+  return string;
+}
+
+static float naive_exp10i(const int32_t exp) {
+    float y = 1.0f;
+    float x = exp<0 ? 0.1f : exp>0 ? 10.0f : 1.0f;
+    int32_t n = exp<0 ? exp : -exp;
+    for (; n < -1; n /= 2) {
+        y *= n%2 ? x : 1.0f;
+        x *= x;
+    }
+    return x * y;
+}
+
+static float naive_string_to_float(const String string) {
+  float value = 0.0f;
+  float sign = 1.0f;
+  float exp = 0.0f;
+  for(size_t i = 0; i < string.len; i++) {
+    switch(string.data[i]) {
+      case '+': break;
+      case '-': sign = -1; break;
+      case '.': exp = 1; break;
+      case 'E':
+      case 'e': 
+        exp = exp ? exp : 1.0f;
+        exp *= naive_exp10i(string_to_int8(string_span(string.data+i+1, string.data + string.len)));
+        i = string.len;
+        break;
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+        value = 10.0f*value + (float)(string.data[i] - '0');
+        exp *= 0.1f;
+        break;
+      default:
+        return 0;
+    }
+  }
+  return sign * value * (exp ? exp : 1.0f);
+}
+
+//------------------------------------------
+// Benchmarks
+//------------------------------------------
+
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+// The checksum keeps the compiler from throwing the work away and makes sure both versions agree
+#define BENCHMARK(name, text, checksum, code) do {\
+    size_t checksum = 0;\
+    double start = now_seconds();\
+    for(uint32_t repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) { code }\
+    double seconds = now_seconds() - start;\
+    printf("%-28s %8.3f ms %8.2f GB/s (checksum %zu)\n", name, seconds*1e3, (double)(text).len*BENCHMARK_REPEATS/seconds*1e-9, checksum);\
+  } while(0)
+
+// Splits the text into lines and looks for "uniform" in each line like attach_shader_to_program does
+#define LINE_SCAN(cut_func, find_substring_func, text, checksum)\
+  Cut lines = {.tail=text};\
+  while(lines.tail.len > 0) {\
+    lines = cut_func(lines.tail, '\n');\
+    checksum += find_substring_func(lines.head, create_string_from_literal("uniform")) + 1;\
+  }
+
+// Walks the text field by field like the obj parser does
+#define FIELD_SCAN(cut_func, trim_func, text, checksum)\
+  Cut fields = {.tail=text};\
+  while(fields.tail.len > 0) {\
+    fields = cut_func(trim_func(fields.tail, create_string_from_literal(" \n")), ' ');\
+    checksum += fields.head.len;\
+  }
+
+/* FNV-1a over the bits of the parsed floats, the same for every float parser so the correctly rounded ones agree.
+ * The naive parser rounds after every digit, so its checksum differs
+*/
+#define FLOAT_CHECKSUM(values, count, checksum)\
+  uint64_t hash = 0xcbf29ce484222325;\
+  for(size_t i = 0; i < (count); i++) {\
+    uint32_t bits;\
+    memcpy(&bits, &(values)[i], sizeof(bits));\
+    hash = (hash ^ bits) * 0x100000001b3;\
+  }\
+  checksum += hash;
+
+// Fills needles with the count bytes that first show up the furthest into the text, so finding them scans most of it and still hits
+static void late_needles(String text, char* needles, size_t count) {
+  size_t firstSeen[256];
+  for(size_t i = 0; i < 256; i++) firstSeen[i] = SIZE_MAX;
+  for(size_t i = 0; i < text.len; i++) {
+    uint8_t c = text.data[i];
+    if(firstSeen[c] == SIZE_MAX) firstSeen[c] = i;
+  }
+  for(size_t n = 0; n < count; n++) {
+    size_t best = 0;
+    for(size_t i = 1; i < 256; i++) {
+      if(firstSeen[i] != SIZE_MAX && (firstSeen[best] == SIZE_MAX || firstSeen[i] > firstSeen[best])) best = i;
+    }
+    needles[n] = (char)best;
+    firstSeen[best] = SIZE_MAX;
+  }
+}
+
+int main(int argc, char** argv) {
+  Arena arena = create_virtual_arena((size_t)1 << 32);
+  String filePath = argc > 1 ? (String){argv[1], strlen(argv[1])} : create_string_from_literal("res/glTF/Sponza/Sponza.gltf");
+  String text = read_file(&arena, filePath);
+  if(!text.len) {
+    fprintf(stderr, "Failed to read %.*s\n", (int)filePath.len, filePath.data);
+    return 1;
+  }
+  printf("%.*s: %zu bytes, %d repeats, simd width %d\n", (int)filePath.len, filePath.data, text.len, BENCHMARK_REPEATS,
+#ifdef STRING_SIMD
+    STRING_SIMD_WIDTH
+#else
+    1
+#endif
+  );
+
+  //needles that aren't in the text next to ones that are found late in it
+  char lateBytes[3];
+  late_needles(text, lateBytes, 3);
+  String lateSet = {lateBytes, 3};
+  //the start of the line 9/10 into the text, a key near the end of a .gltf
+  Cut lateLine = string_cut(string_cut(string_span(text.data + text.len*9/10, text.data + text.len), '\n').tail, '\n');
+  String lateKey = string_trim_left(lateLine.head, create_string_from_literal(" \t"));
+  String lateSubstring = string_span(lateKey.data, lateKey.data + (lateKey.len < 24 ? lateKey.len : 24));
+  printf("found needles at bytes %d (find), %d (find_any), %d (find_substring \"%.*s\")\n", string_find(text, lateBytes[0]),
+    string_find_any(text, lateSet), string_find_substring(text, lateSubstring), (int)lateSubstring.len, lateSubstring.data);
+
+  BENCHMARK("find (naive)", text, checksum, { checksum += naive_string_find(text, '\x01') + 1; });
+  BENCHMARK("find", text, checksum, { checksum += string_find(text, '\x01') + 1; });
+  BENCHMARK("find found (naive)", text, checksum, { checksum += naive_string_find(text, lateBytes[0]) + 1; });
+  BENCHMARK("find found", text, checksum, { checksum += string_find(text, lateBytes[0]) + 1; });
+
+  BENCHMARK("find_any (naive)", text, checksum, { checksum += naive_string_find_any(text, create_string_from_literal("\x01\x02\x03")) + 1; });
+  BENCHMARK("find_any", text, checksum, { checksum += string_find_any(text, create_string_from_literal("\x01\x02\x03")) + 1; });
+  BENCHMARK("find_any found (naive)", text, checksum, { checksum += naive_string_find_any(text, lateSet) + 1; });
+  BENCHMARK("find_any found", text, checksum, { checksum += string_find_any(text, lateSet) + 1; });
+
+  BENCHMARK("find_substring (naive)", text, checksum, { checksum += naive_string_find_substring(text, create_string_from_literal("\"notInTheFile\"")) + 1; });
+  BENCHMARK("find_substring", text, checksum, { checksum += string_find_substring(text, create_string_from_literal("\"notInTheFile\"")) + 1; });
+  BENCHMARK("find_substring found (naive)", text, checksum, { checksum += naive_string_find_substring(text, lateSubstring) + 1; });
+  BENCHMARK("find_substring found", text, checksum, { checksum += string_find_substring(text, lateSubstring) + 1; });
+
+  BENCHMARK("line scan (naive)", text, checksum, { LINE_SCAN(naive_string_cut, naive_string_find_substring, text, checksum) });
+  BENCHMARK("line scan", text, checksum, { LINE_SCAN(string_cut, string_find_substring, text, checksum) });
+
+  BENCHMARK("field scan (naive)", text, checksum, { FIELD_SCAN(naive_string_cut, naive_string_trim_left, text, checksum) });
+  BENCHMARK("field scan", text, checksum, { FIELD_SCAN(string_cut, string_trim_left, text, checksum) });
+
+  //an obj like list of vertex positions
+  const size_t floatCount = 3000000;
+  char* floatText = arena_alloc(&arena, floatCount*16);
+  size_t floatTextLen = 0;
+  srand(1);
+  for(size_t i = 0; i < floatCount; i++) {
+    floatTextLen += sprintf(floatText + floatTextLen, "%.6f%c", (float)rand()/RAND_MAX*200.0f - 100.0f, i%3 == 2 ? '\n' : ' ');
+  }
+  String floats = {floatText, floatTextLen};
+  float* values = arena_alloc_array(&arena, float, floatCount);
+
+  printf("%zu floats, %zu bytes\n", floatCount, floats.len);
+  #undef BENCHMARK_REPEATS
+  #define BENCHMARK_REPEATS 1
+  BENCHMARK("parse floats (naive)", floats, checksum, {
+    Cut fields = {.tail=floats};
+    for(size_t i = 0; fields.tail.len; i++) {
+      fields = naive_string_cut(naive_string_trim_left(fields.tail, create_string_from_literal(" \n")), i%3 == 2 ? '\n' : ' ');
+      values[i] = naive_string_to_float(fields.head);
+    }
+    FLOAT_CHECKSUM(values, floatCount, checksum)
+  });
+  BENCHMARK("parse floats", floats, checksum, {
+    checksum += string_parse_floats(floats, values, floatCount) != floatCount;
+    FLOAT_CHECKSUM(values, floatCount, checksum)
+  });
+  BENCHMARK("strtof", floats, checksum, {
+    char* p = floatText;
+    for(size_t i = 0; i < floatCount; i++) values[i] = strtof(p, &p);
+    FLOAT_CHECKSUM(values, floatCount, checksum)
+  });
+
+  free_arena(&arena);
+  return 0;
+}
@@ -0,0 +1,244 @@
+/* Throughput of the vertex packing kernels against the per vertex memcpy loop they replaced, on the vertices of the Helmet.
+ * The Helmet is also tiled to a few million vertices so the buffers don't fit in the caches and the numbers can be compared to memcpy
+ * build with build/benchmark.sh vertex_pack, run from the root of the repo (another .gltf can be given as the first argument)
+*/
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/data_types/arena.c"
+#include "../src/data_types/string.c"
+#include "../src/data_types/io.c"
+#include "../src/gltf.c"
+#include "../src/vertex_pack.c"
+
+#ifndef BENCHMARK_REPEATS
+#define BENCHMARK_REPEATS 20
+#endif
+
+// vertices in the tiled copy of the mesh
+#define BENCHMARK_LARGE_VERTEX_COUNT ((size_t)1 << 22)
+
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+// bytes is what the code reads and writes once, the checksum of the output makes sure every version agrees
+#define BENCHMARK(name, bytes, output, outputSize, ...) do {\
+    double start = now_seconds();\
+    for(uint32_t repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) { __VA_ARGS__ }\
+    double seconds = (now_seconds() - start) / BENCHMARK_REPEATS;\
+    printf("%-38s %9.3f ms %8.2f GB/s (checksum %016llx)\n", name, seconds*1e3, (double)(bytes)/seconds*1e-9,\
+      (unsigned long long)wyhash(output, outputSize, 0));\
+  } while(0)
+
+//------------------------------------------
+// The old version
+//------------------------------------------
+
+// The loop cook_gltf_vertices and generate_render_data used, noinline so the format isn't known like in the engine
+__attribute__((noinline)) static void naive_pack_vertices(char* vertexData, uint32_t format, VertexStream position, VertexStream normal, VertexStream texCoord, size_t count, float* boundsMin, float* boundsMax) {
+  for(uint8_t i = 0; i < 3; i++) {
+    boundsMin[i] = FLT_MAX;
+    boundsMax[i] = -FLT_MAX;
+  }
+  size_t offset = 0;
+  for(size_t i = 0; i < count; i++) {
+    float p[3];
+    memcpy(p, (const char*)position.data + i*position.stride, 3*sizeof(float));
+    memcpy(vertexData + offset, p, 3*sizeof(float));
+    offset += 3*sizeof(float);
+    for(uint8_t j = 0; j < 3; j++) {
+      boundsMin[j] = fminf(boundsMin[j], p[j]);
+      boundsMax[j] = fmaxf(boundsMax[j], p[j]);
+    }
+
+    if(format & VERTEX_FORMAT_NORMAL) {
+      memcpy(vertexData + offset, (const char*)normal.data + i*normal.stride, 3*sizeof(float));
+      offset += 3*sizeof(float);
+    }
+    if(format & VERTEX_FORMAT_TEXCOORD) {
+      memcpy(vertexData + offset, (const char*)texCoord.data + i*texCoord.stride, 2*sizeof(float));
+      offset += 2*sizeof(float);
+    }
+  }
+}
+
+// The kernel with the SIMD loop turned off
+__attribute__((noinline)) static void scalar_pack_vertices(char* vertexData, VertexStream position, VertexStream normal, VertexStream texCoord, size_t count, float* boundsMin, float* boundsMax) {
+  pack_vertices_kernel(vertexData, VERTEX_FORMAT_NORMAL | VERTEX_FORMAT_TEXCOORD, false, position, normal, texCoord, count, boundsMin, boundsMax);
+}
+
+//------------------------------------------
+// Loading the Helmet
+//------------------------------------------
+
+// The attributes of the first primitive of the file as tight float arrays
+typedef struct {
+  size_t count;
+  float* positions;
+  float* normals;
+  float* texCoords;
+} BenchmarkMesh;
+
+static const char* load_accessor(Arena* arena, const GLTF* gltf, String bin, int32_t accessorIndex, uint8_t componentCount) {
+  if(accessorIndex == -1) return NULL;
+  const GLTFAccessor* accessor = array_index(GLTFAccessor, &gltf->accessors, accessorIndex);
+  if(accessor->bufferView == -1 || accessor->componentType != GLTF_COMPONENT_FLOAT || accessor->componentCount != componentCount) return NULL;
+  const GLTFBufferView* bufferView = array_index(GLTFBufferView, &gltf->bufferViews, accessor->bufferView);
+  if(bufferView->byteOffset + bufferView->byteLength > bin.len) return NULL;
+
+  size_t size = componentCount*sizeof(float);
+  size_t stride = gltf_accessor_stride(gltf, accessor);
+  char* result = arena_alloc(arena, accessor->count*size);
+  for(size_t i = 0; i < accessor->count; i++) memcpy(result + i*size, bin.data + bufferView->byteOffset + accessor->byteOffset + i*stride, size);
+  return result;
+}
+
+static bool load_benchmark_mesh(Arena* arena, String filePath, BenchmarkMesh* mesh) {
+  String json = read_file(arena, filePath);
+  GLTF gltf;
+  if(!json.len || !parse_gltf(arena, json, &gltf) || !gltf.primitives.length || gltf.buffers.length != 1) return false;
+  const GLTFBuffer* buffer = array_index(GLTFBuffer, &gltf.buffers, 0);
+
+  size_t directoryLength = string_find_reverse(filePath, '/') + 1;
+  char* binPath = arena_alloc(arena, directoryLength + buffer->uri.len);
+  memcpy(binPath, filePath.data, directoryLength);
+  memcpy(binPath + directoryLength, buffer->uri.data, buffer->uri.len);
+  String bin = read_file(arena, (String){binPath, directoryLength + buffer->uri.len});
+
+  const GLTFPrimitive* primitive = array_index(GLTFPrimitive, &gltf.primitives, 0);
+  mesh->positions = (float*)load_accessor(arena, &gltf, bin, primitive->attributes[GLTF_ATTRIBUTE_POSITION], 3);
+  mesh->normals = (float*)load_accessor(arena, &gltf, bin, primitive->attributes[GLTF_ATTRIBUTE_NORMAL], 3);
+  mesh->texCoords = (float*)load_accessor(arena, &gltf, bin, primitive->attributes[GLTF_ATTRIBUTE_TEXCOORD_0], 2);
+  if(!mesh->positions || !mesh->normals || !mesh->texCoords) return false;
+  mesh->count = array_index(GLTFAccessor, &gltf.accessors, primitive->attributes[GLTF_ATTRIBUTE_POSITION])->count;
+  return true;
+}
+
+// Repeats the mesh until it has count vertices
+static BenchmarkMesh tile_benchmark_mesh(Arena* arena, const BenchmarkMesh* mesh, size_t count) {
+  BenchmarkMesh result = {count};
+  result.positions = arena_alloc_array(arena, float, count*3);
+  result.normals = arena_alloc_array(arena, float, count*3);
+  result.texCoords = arena_alloc_array(arena, float, count*2);
+  for(size_t i = 0; i < count; i += mesh->count) {
+    size_t n = count - i < mesh->count ? count - i : mesh->count;
+    memcpy(result.positions + i*3, mesh->positions, n*3*sizeof(float));
+    memcpy(result.normals + i*3, mesh->normals, n*3*sizeof(float));
+    memcpy(result.texCoords + i*2, mesh->texCoords, n*2*sizeof(float));
+  }
+  return result;
+}
+
+//------------------------------------------
+// Benchmarks
+//------------------------------------------
+
+static void run_benchmarks(Arena* arena, const BenchmarkMesh* mesh) {
+  const uint32_t format = VERTEX_FORMAT_NORMAL | VERTEX_FORMAT_TEXCOORD;
+  size_t count = mesh->count;
+  size_t outputSize = count*vertex_format_stride(format);
+  size_t bytes = 2*outputSize;
+  float boundsMin[3], boundsMax[3];
+
+  ScratchArena scratch = create_scratch_arena(arena);
+  char* vertexData = arena_alloc_align(arena, outputSize, 64);
+  char* copy = arena_alloc_align(arena, outputSize, 64);
+  memset(vertexData, 0, outputSize);
+  memset(copy, 0, outputSize);
+
+  //the same attributes interleaved like a glTF exporter might write them, position normal tangent texCoord
+  const size_t sourceStride = 12*sizeof(float);
+  char* interleaved = arena_alloc_align(arena, count*sourceStride, 64);
+  memset(interleaved, 0, count*sourceStride);
+  for(size_t i = 0; i < count; i++) {
+    memcpy(interleaved + i*sourceStride, mesh->positions + i*3, 3*sizeof(float));
+    memcpy(interleaved + i*sourceStride + 3*sizeof(float), mesh->normals + i*3, 3*sizeof(float));
+    memcpy(interleaved + i*sourceStride + 10*sizeof(float), mesh->texCoords + i*2, 2*sizeof(float));
+  }
+
+  VertexStream position = {mesh->positions, 3*sizeof(float)};
+  VertexStream normal = {mesh->normals, 3*sizeof(float)};
+  VertexStream texCoord = {mesh->texCoords, 2*sizeof(float)};
+  VertexStream interleavedPosition = {interleaved, sourceStride};
+  VertexStream interleavedNormal = {interleaved + 3*sizeof(float), sourceStride};
+  VertexStream interleavedTexCoord = {interleaved + 10*sizeof(float), sourceStride};
+
+  printf("%zu vertices, %zu bytes packed\n", count, outputSize);
+  BENCHMARK("memcpy", bytes, copy, outputSize, { memcpy(copy, vertexData, outputSize); });
+  BENCHMARK("pack (per vertex memcpy)", bytes, vertexData, outputSize, { naive_pack_vertices(vertexData, format, position, normal, texCoord, count, boundsMin, boundsMax); });
+  BENCHMARK("pack (scalar)", bytes, vertexData, outputSize, { scalar_pack_vertices(vertexData, position, normal, texCoord, count, boundsMin, boundsMax); });
+  BENCHMARK("pack", bytes, vertexData, outputSize, { pack_vertices(vertexData, format, position, normal, texCoord, count, boundsMin, boundsMax); });
+  BENCHMARK("pack interleaved (per vertex memcpy)", bytes, vertexData, outputSize, {
+    naive_pack_vertices(vertexData, format, interleavedPosition, interleavedNormal, interleavedTexCoord, count, boundsMin, boundsMax);
+  });
+  BENCHMARK("pack interleaved", bytes, vertexData, outputSize, {
+    pack_vertices(vertexData, format, interleavedPosition, interleavedNormal, interleavedTexCoord, count, boundsMin, boundsMax);
+  });
+  printf("bounds (%.4f %.4f %.4f) (%.4f %.4f %.4f)\n", boundsMin[0], boundsMin[1], boundsMin[2], boundsMax[0], boundsMax[1], boundsMax[2]);
+
+  //unpacking into the tight arrays and packing them again has to give the same vertices
+  float* positions = arena_alloc_array(arena, float, count*3);
+  float* normals = arena_alloc_array(arena, float, count*3);
+  float* texCoords = arena_alloc_array(arena, float, count*2);
+  BENCHMARK("unpack", bytes, positions, count*3*sizeof(float), { unpack_vertices(vertexData, format, count, positions, normals, texCoords); });
+  pack_vertices(copy, format, (VertexStream){positions, 3*sizeof(float)}, (VertexStream){normals, 3*sizeof(float)}, (VertexStream){texCoords, 2*sizeof(float)}, count, NULL, NULL);
+  printf("round trip %s\n", memcmp(copy, vertexData, outputSize) ? "FAILED" : "ok");
+
+  //the compressed layout, the error is measured against the floats after decoding like the vertex shader does
+  const uint32_t compressedFormat = format | VERTEX_FORMAT_COMPRESSED;
+  const uint32_t compressedStride = vertex_format_stride(compressedFormat);
+  size_t compressedSize = count*compressedStride;
+  BENCHMARK("pack compressed", outputSize + compressedSize, vertexData, compressedSize, {
+    pack_vertices(vertexData, compressedFormat, position, normal, texCoord, count, boundsMin, boundsMax);
+  });
+  float positionError = 0, normalError = 0, texCoordError = 0;
+  for(size_t i = 0; i < count; i++) {
+    const char* vertex = vertexData + i*compressedStride;
+    uint16_t quantized[3], halfs[2];
+    int16_t encoded[2];
+    float decoded[3];
+    memcpy(quantized, vertex, sizeof(quantized));
+    memcpy(encoded, vertex + vertex_format_normal_offset(compressedFormat), sizeof(encoded));
+    memcpy(halfs, vertex + vertex_format_texcoord_offset(compressedFormat), sizeof(halfs));
+    for(uint8_t j = 0; j < 3; j++) {
+      float p = boundsMin[j] + quantized[j]/65535.0f*(boundsMax[j] - boundsMin[j]);
+      positionError = fmaxf(positionError, fabsf(p - mesh->positions[i*3 + j]));
+    }
+    octahedral_decode(encoded, decoded);
+    const float* n = mesh->normals + i*3;
+    float cosine = (decoded[0]*n[0] + decoded[1]*n[1] + decoded[2]*n[2]) / sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    normalError = fmaxf(normalError, acosf(fminf(cosine, 1.0f))*180.0f/(float)M_PI);
+    for(uint8_t j = 0; j < 2; j++) texCoordError = fmaxf(texCoordError, fabsf(half_to_float(halfs[j]) - mesh->texCoords[i*2 + j]));
+  }
+  printf("compressed %zu bytes (%.1f%%), max error position %.2e normal %.4f degrees texCoord %.2e\n\n",
+    compressedSize, 100.0*compressedSize/outputSize, positionError, normalError, texCoordError);
+
+  release_scratch_arena(scratch);
+}
+
+int main(int argc, char** argv) {
+  Arena arena = create_virtual_arena((size_t)1 << 32);
+  String filePath = argc > 1 ? (String){argv[1], strlen(argv[1])} : create_string_from_literal("res/glTF/Helmet/SciFiHelmet.gltf");
+  BenchmarkMesh mesh;
+  if(!load_benchmark_mesh(&arena, filePath, &mesh)) {
+    fprintf(stderr, "Failed to load the positions, normals and texture coordinates of %.*s\n", (int)filePath.len, filePath.data);
+    return 1;
+  }
+  printf("%.*s, %d repeats, simd %s\n", (int)filePath.len, filePath.data, BENCHMARK_REPEATS,
+#ifdef VERTEX_PACK_SIMD
+    "on"
+#else
+    "off"
+#endif
+  );
+
+  run_benchmarks(&arena, &mesh);
+  BenchmarkMesh large = tile_benchmark_mesh(&arena, &mesh, BENCHMARK_LARGE_VERTEX_COUNT);
+  run_benchmarks(&arena, &large);
+
+  free_arena(&arena);
+  return 0;
+}
@@ -0,0 +1,10 @@
+#!/bin/bash
+# usage: build/benchmark.sh <name> [args...]  builds and runs benchmark/<name>_benchmark.c
+
+name=$1
+shift
+${CC:-clang} benchmark/${name}_benchmark.c\
+  -o ${name}Benchmark\
+  -lm -lpthread -O2 -march=native -g -Wall -Werror
+
+$PWD/${name}Benchmark "$@"
@@ -0,0 +1,20 @@
+#!/bin/bash
+# usage: build/test.sh [name...]  builds and runs tests/<name>_test.c, every test when no name is given
+
+names=("$@")
+if [ ${#names[@]} -eq 0 ]; then
+  for file in tests/*_test.c; do
+    file=${file#tests/}
+    names+=(${file%_test.c})
+  done
+fi
+
+result=0
+for name in "${names[@]}"; do
+  ${CC:-clang} tests/${name}_test.c glad/glad.o dependencies/stb_image/stb_image.o\
+    -o ${name}Test\
+    -lm -lpthread -Idependencies/stb_image/include -Iglad/include -Idependencies/cglm/include\
+    -Wall -Werror -fsanitize=address,undefined -g || { result=1; continue; }
+  $PWD/${name}Test || result=1
+done
+exit $result
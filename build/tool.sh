@@ -0,0 +1,11 @@
+#!/bin/bash
+# usage: build/tool.sh <name> [args...]  builds and runs tools/<name>.c, the tools are headless and don't need a window
+
+name=$1
+shift
+${CC:-clang} tools/${name}.c glad/glad.o dependencies/stb_image/stb_image.o\
+  -o ${name}Tool\
+  -lm -lpthread -Idependencies/stb_image/include -Iglad/include -Idependencies/cglm/include\
+  -O2 -g -Wall -Werror
+
+$PWD/${name}Tool "$@"
@@ -11,12 +11,30 @@ uniform mat4 projectionMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 modelMatrix;
 
+// VERTEX_FORMAT_COMPRESSED: the position is a unorm16 inside the bounds of the mesh and the normal is octahedral encoded
+// (only aNormal.xy is set), the half float texture coordinates don't need decoding
+uniform bool compressedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// The inverse of octahedral_encode in vertex_pack.c
+vec3 octahedral_decode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
+    vec3 position = compressedVertices ? positionOffset + aPos * positionScale : aPos;
+    vec3 normal = compressedVertices ? octahedral_decode(aNormal.xy) : aNormal;
+
     TexCoords = aTexCoords;
-    WorldPos = vec3(modelMatrix * vec4(aPos, 1.0));
-    Normal = vec3(modelMatrix * vec4(aNormal, 0.0));
+    WorldPos = vec3(modelMatrix * vec4(position, 1.0));
+    Normal = vec3(modelMatrix * vec4(normal, 0.0));
     
     gl_Position =  projectionMatrix * viewMatrix * vec4(WorldPos, 1.0);
 }
-
@@ -3,7 +3,16 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <malloc.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memory_stats.c"
 
 #ifndef ARENA_ASSERT
 #include <assert.h>
@@ -14,39 +23,134 @@
 #define DEFAULT_ALIGNMENT (2 * sizeof(void*))
 #endif //DEFAULT_ALIGNMENT
 
+// Virtual arenas commit memory in chunks of this size (must be a multiple of the page size)
+#ifndef ARENA_COMMIT_SIZE
+#define ARENA_COMMIT_SIZE ((size_t)1 << 16)
+#endif //ARENA_COMMIT_SIZE
+
+// Address space reserved for each of the per thread scratch arenas
+#ifndef THREAD_SCRATCH_ARENA_RESERVE
+#define THREAD_SCRATCH_ARENA_RESERVE ((size_t)1 << 32)
+#endif //THREAD_SCRATCH_ARENA_RESERVE
+
+#define THREAD_SCRATCH_ARENA_COUNT 2
+
+// How many runs of bytes charged to different tags an arena remembers, past that new bytes go to the tag of the last run
+#ifndef ARENA_TAG_RUN_COUNT
+#define ARENA_TAG_RUN_COUNT 32
+#endif //ARENA_TAG_RUN_COUNT
+
 #define ARENA_IS_POWER_OF_TWO(n) (((n) != 0) && (((n) & (n - 1)) == 0))
 
 typedef struct Arena Arena;
 
+#ifdef MEMORY_TRACKING
+// The bytes from begin up to the next run (or the offset) were charged to tag
+typedef struct {
+  size_t begin;
+  MemoryTag tag;
+} ArenaTagRun;
+#endif
+
+/* There are two kinds of arenas
+ * 1. fixed arenas (create_arena) use a buffer given by the caller, capcity never changes
+ * 2. virtual arenas (create_virtual_arena) reserve an address range and commit pages on demand,
+ *    here capcity is the committed size and reserved is the size of the whole range
+*/
 struct Arena {
   char *data;
   size_t offset;
   size_t capcity;
+  size_t reserved;
+  size_t highWaterMark;
+#ifdef MEMORY_TRACKING
+  //when it's untagged allocations are charged to the tag the thread pushed
+  MemoryTag memoryTag;
+  //a rewind gives the bytes back to the tags that were charged for them
+  uint8_t tagRunCount;
+  ArenaTagRun tagRuns[ARENA_TAG_RUN_COUNT];
+#endif
 };
 
+#ifdef MEMORY_TRACKING
+#define arena_set_memory_tag(arena, tag) ((arena)->memoryTag = (tag))
+
+// Charges the size bytes that are about to be allocated at the offset
+static void arena_track_alloc(Arena* arena, size_t size) {
+  MemoryTag tag = arena->memoryTag ? arena->memoryTag : memory_current_tag();
+  ArenaTagRun* last = arena->tagRunCount ? &arena->tagRuns[arena->tagRunCount - 1] : NULL;
+  //an empty run (nothing was allocated since it started) is taken over
+  if(last && last->begin == arena->offset) last->tag = tag;
+  else if(!last || last->tag != tag) {
+    if(arena->tagRunCount < ARENA_TAG_RUN_COUNT) arena->tagRuns[arena->tagRunCount++] = (ArenaTagRun){arena->offset, tag};
+    else tag = last->tag;
+  }
+  memory_track_alloc(tag, size);
+}
+
+// Gives the bytes from offset up to the current offset back to the tags that were charged for them
+static void arena_track_rewind(Arena* arena, size_t offset) {
+  size_t end = arena->offset;
+  while(arena->tagRunCount && end > offset) {
+    ArenaTagRun* last = &arena->tagRuns[arena->tagRunCount - 1];
+    size_t begin = last->begin > offset ? last->begin : offset;
+    memory_track_free(last->tag, end - begin);
+    end = begin;
+    if(last->begin >= offset) arena->tagRunCount--;
+  }
+}
+#else
+#define arena_set_memory_tag(arena, tag) ((void)0)
+#define arena_track_alloc(arena, size) ((void)0)
+#define arena_track_rewind(arena, offset) ((void)0)
+#endif
+
 typedef struct {
   Arena* allocator;
   const size_t markOffset;
 } ScratchArena;
 
-uintptr_t align_forward(uintptr_t ptr, uint8_t alignment) {
-  uintptr_t offset = ptr % alignment;
-  uintptr_t offset_comp = (alignment - offset) % alignment;
+typedef struct {
+  size_t used;
+  size_t committed;
+  size_t reserved;
+  size_t highWaterMark;
+} ArenaStats;
 
-  return ptr + offset_comp;
+uintptr_t align_forward(uintptr_t ptr, size_t alignment) {
+  ARENA_ASSERT(ARENA_IS_POWER_OF_TWO(alignment));
+  return (ptr + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
 }
 
-void* arena_alloc_align(Arena* arena, size_t n, uint8_t alignment) {
-  ARENA_ASSERT(ARENA_IS_POWER_OF_TWO(alignment));
+// Commits enough pages so that at least 'size' bytes of the arena are usable
+bool arena_commit(Arena* arena, size_t size) {
+  if(size <= arena->capcity) return true;
+  if(size > arena->reserved) return false;
+
+  size_t newCapacity = align_forward(size, ARENA_COMMIT_SIZE);
+  if(newCapacity > arena->reserved) newCapacity = arena->reserved;
+
+  if(mprotect(arena->data + arena->capcity, newCapacity - arena->capcity, PROT_READ | PROT_WRITE) != 0) return false;
+  arena->capcity = newCapacity;
+  return true;
+}
+
+void* arena_alloc_align(Arena* arena, size_t n, size_t alignment) {
   uintptr_t ptr = (uintptr_t)arena->data + arena->offset;
-  uintptr_t aligned_ptr = align_forward(ptr, alignment);
+  uintptr_t alignedPtr = align_forward(ptr, alignment);
+  size_t end = alignedPtr - (uintptr_t)arena->data + n;
 
-  ARENA_ASSERT(aligned_ptr < (uintptr_t)arena->data + arena->capcity);
+  if(end > arena->capcity && !arena_commit(arena, end)) {
+    fprintf(stderr, "Arena out of memory (requested %zu bytes, %zu of %zu used)\n", n, arena->offset, arena->reserved ? arena->reserved : arena->capcity);
+    fflush(stderr);
+    abort();
+  }
 
-  arena->offset = aligned_ptr - (uintptr_t)arena->data + n;
-  char* result = (char *)aligned_ptr;
+  arena_track_alloc(arena, end - arena->offset);
+  arena->offset = end;
+  if(end > arena->highWaterMark) arena->highWaterMark = end;
 
-  return result;
+  return (void*)alignedPtr;
 }
 
 void* arena_alloc(Arena* arena, size_t n) {
@@ -54,13 +158,185 @@ void* arena_alloc(Arena* arena, size_t n) {
   return arena_alloc_align(arena, n, alignment);
 }
 
-void arena_clear(Arena *arena) { arena->offset = 0; }
+/* Resizes an allocation made from this arena.
+ * When it's the last allocation (nothing has been allocated after it) it grows or shrinks in place,
+ * otherwise a new block is allocated and the old data is copied over (the old block is left in the arena)
+*/
+void* arena_realloc(Arena* arena, void* ptr, size_t oldSize, size_t newSize, size_t alignment) {
+  if(ptr && (char*)ptr + oldSize == arena->data + arena->offset) {
+    size_t end = (char*)ptr - arena->data + newSize;
+    if(end <= arena->capcity || arena_commit(arena, end)) {
+      if(end > arena->offset) arena_track_alloc(arena, end - arena->offset);
+      else arena_track_rewind(arena, end);
+      arena->offset = end;
+      if(end > arena->highWaterMark) arena->highWaterMark = end;
+      return ptr;
+    }
+  }
+
+  void* newPtr = arena_alloc_align(arena, newSize, alignment);
+  if(ptr) memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+  return newPtr;
+}
+
+void arena_clear(Arena *arena) {
+  arena_track_rewind(arena, 0);
+  arena->offset = 0;
+}
+
 Arena create_arena(char*data, size_t capcity) { return (Arena){.data=data, .offset=0, .capcity=capcity}; }
 
+// Reserves 'reserveSize' bytes of address space without backing it with memory
+Arena create_virtual_arena(size_t reserveSize) {
+  reserveSize = align_forward(reserveSize, ARENA_COMMIT_SIZE);
+  void* data = mmap(NULL, reserveSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(data == MAP_FAILED) {
+    fprintf(stderr, "Failed to reserve %zu bytes for arena\n", reserveSize);
+    fflush(stderr);
+    abort();
+  }
+  return (Arena){.data=data, .offset=0, .capcity=0, .reserved=reserveSize};
+}
+
+// Gives the committed pages past the current offset back to the OS (only for virtual arenas)
+void arena_decommit(Arena* arena) {
+  if(!arena->reserved) return;
+  size_t keep = align_forward(arena->offset, ARENA_COMMIT_SIZE);
+  if(keep >= arena->capcity) return;
+
+  madvise(arena->data + keep, arena->capcity - keep, MADV_DONTNEED);
+  mprotect(arena->data + keep, arena->capcity - keep, PROT_NONE);
+  arena->capcity = keep;
+}
+
+ArenaStats arena_get_stats(const Arena* arena) {
+  return (ArenaStats){
+    .used=arena->offset,
+    .committed=arena->capcity,
+    .reserved=arena->reserved ? arena->reserved : arena->capcity,
+    .highWaterMark=arena->highWaterMark
+  };
+}
+
 ScratchArena create_scratch_arena(Arena* arena) { return (ScratchArena){.allocator=arena, .markOffset=arena->offset}; }
-void release_scratch_arena(ScratchArena mark) { mark.allocator->offset = mark.markOffset; }
+void release_scratch_arena(ScratchArena mark) {
+  arena_track_rewind(mark.allocator, mark.markOffset);
+  mark.allocator->offset = mark.markOffset;
+}
+
+void free_arena(Arena* arena) {
+  arena_track_rewind(arena, 0);
+  if(arena->reserved) munmap(arena->data, arena->reserved);
+  else free(arena->data);
+  *arena = (Arena){0};
+}
+
+//------------------------------------------
+// Thread scratch arenas
+//------------------------------------------
+
+/* Every thread owns its own scratch arenas so get/release never needs a lock.
+ * There are 2 per thread so a function that is given an arena to allocate its result in
+ * can still get a scratch arena that doesn't rewind over that result (pass it in as 'conflict')
+*/
+static _Thread_local Arena threadScratchArenas[THREAD_SCRATCH_ARENA_COUNT];
+
+ScratchArena get_thread_scratch_arena(const Arena* conflict) {
+  for(uint8_t i = 0; i < THREAD_SCRATCH_ARENA_COUNT; i++) {
+    Arena* arena = &threadScratchArenas[i];
+    if(arena == conflict) continue;
+    if(!arena->data) {
+      *arena = create_virtual_arena(THREAD_SCRATCH_ARENA_RESERVE);
+      arena_set_memory_tag(arena, MEMORY_TAG_SCRATCH);
+    }
+    return create_scratch_arena(arena);
+  }
+  fprintf(stderr, "No thread scratch arena is free\n");
+  fflush(stderr);
+  abort();
+}
+
+//Should be called before a thread that used get_thread_scratch_arena exits
+void free_thread_scratch_arenas(void) {
+  for(uint8_t i = 0; i < THREAD_SCRATCH_ARENA_COUNT; i++) {
+    if(threadScratchArenas[i].data) free_arena(&threadScratchArenas[i]);
+  }
+}
+
+//------------------------------------------
+// Atomic Arena
+//------------------------------------------
+
+// Bump allocator that can be shared between threads, the offset is moved forward with a compare and swap
+typedef struct {
+  char* data;
+  _Atomic size_t offset;
+  _Atomic size_t capcity;
+  size_t reserved;
+#ifdef MEMORY_TRACKING
+  //taken from the creating thread, the threads that allocate from it can have any tag pushed
+  MemoryTag memoryTag;
+#endif
+} AtomicArena;
+
+AtomicArena create_atomic_arena(char* data, size_t capcity) {
+  AtomicArena arena = {.data=data, .reserved=0};
+  arena_set_memory_tag(&arena, memory_current_tag());
+  atomic_init(&arena.offset, 0);
+  atomic_init(&arena.capcity, capcity);
+  return arena;
+}
+
+AtomicArena create_virtual_atomic_arena(size_t reserveSize) {
+  Arena virtualArena = create_virtual_arena(reserveSize);
+  AtomicArena arena = {.data=virtualArena.data, .reserved=virtualArena.reserved};
+  arena_set_memory_tag(&arena, memory_current_tag());
+  atomic_init(&arena.offset, 0);
+  atomic_init(&arena.capcity, 0);
+  return arena;
+}
+
+void* atomic_arena_alloc_align(AtomicArena* arena, size_t n, size_t alignment) {
+  size_t offset = atomic_load_explicit(&arena->offset, memory_order_relaxed);
+  size_t begin, end;
+  do {
+    begin = align_forward((uintptr_t)arena->data + offset, alignment) - (uintptr_t)arena->data;
+    end = begin + n;
+  } while(!atomic_compare_exchange_weak_explicit(&arena->offset, &offset, end, memory_order_relaxed, memory_order_relaxed));
+  memory_track_alloc(arena->memoryTag, end - offset);
+
+  //Several threads can commit at once, mprotect on an already committed range is harmless
+  size_t committed = atomic_load_explicit(&arena->capcity, memory_order_acquire);
+  while(end > committed) {
+    size_t newCommitted = align_forward(end, ARENA_COMMIT_SIZE);
+    if(newCommitted > arena->reserved) newCommitted = arena->reserved;
+    if(end > newCommitted || mprotect(arena->data + committed, newCommitted - committed, PROT_READ | PROT_WRITE) != 0) {
+      fprintf(stderr, "Atomic arena out of memory (requested %zu bytes at offset %zu)\n", n, begin);
+      fflush(stderr);
+      abort();
+    }
+    if(atomic_compare_exchange_weak_explicit(&arena->capcity, &committed, newCommitted, memory_order_release, memory_order_acquire)) break;
+  }
+
+  return arena->data + begin;
+}
+
+void* atomic_arena_alloc(AtomicArena* arena, size_t n) { return atomic_arena_alloc_align(arena, n, DEFAULT_ALIGNMENT); }
+
+//Not thread safe, only call this when no other thread is allocating
+void atomic_arena_clear(AtomicArena* arena) {
+  memory_track_free(arena->memoryTag, atomic_load_explicit(&arena->offset, memory_order_relaxed));
+  atomic_store_explicit(&arena->offset, 0, memory_order_relaxed);
+}
+
+void free_atomic_arena(AtomicArena* arena) {
+  memory_track_free(arena->memoryTag, atomic_load_explicit(&arena->offset, memory_order_relaxed));
+  if(arena->reserved) munmap(arena->data, arena->reserved);
+  else free(arena->data);
+  arena->data = NULL;
+}
 
-void free_arena(Arena* arena) { free(arena->data); }
+#define atomic_arena_alloc_array(arena, type, n) atomic_arena_alloc(arena, sizeof(type) * n)
 
 #define arena_alloc_array(arena, type, n) arena_alloc(arena, sizeof(type) * n)
 #define arena_alloc_struct(arena, type) arena_alloc(arena, sizeof(type))
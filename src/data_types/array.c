@@ -7,17 +7,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "arena.c"
+#include "memory_stats.c"
+
+/* Dynamic arrays live on the heap (create_dynamic_array) or in an arena (create_arena_dynamic_array).
+ * An arena backed array grows in place while it's the last allocation of the arena, otherwise it's moved to the end of it
+*/
 #define DynamicArray(type) type##DynamicArray
 #define dynamic_array_index(type, array, index) type##_dynamic_array_index(array, index)
 #define dynamic_array_append(type, array, value) type##_dynamic_array_append(array, value)
 #define dynamic_array_insert(type, array, index, value) type##_dynamic_array_insert(array, index, value)
-#define create_dynamic_array(type, capacity) (type##DynamicArray){malloc(capacity * sizeof(type)), 0, capacity}
+#define create_dynamic_array(type, capacity) (type##DynamicArray){malloc(capacity * sizeof(type)), 0, capacity, NULL}
+#define create_arena_dynamic_array(type, arena, capacity) (type##DynamicArray){arena_alloc_align(arena, (capacity) * sizeof(type), _Alignof(type)), 0, capacity, arena}
 
 #define DEFINE_DYNAMIC_ARRAY(type)\
   typedef struct {\
     type* data;\
     size_t length;\
     size_t capacity;\
+    Arena* arena;\
   } type##DynamicArray;\
   \
   type* type##_dynamic_array_index(const type##DynamicArray* dynamicArray, size_t index) {\
@@ -30,8 +38,12 @@
   }\
   \
   void type##_dynamic_array_grow(type##DynamicArray* dynamicArray, size_t amount) {\
-    size_t newCapacity = dynamicArray->capacity + amount;\
-    type* newData =  realloc(dynamicArray->data, newCapacity * sizeof(type));\
+    size_t newCapacity = dynamicArray->capacity + (amount ? amount : 1);\
+    /*arena growth is tracked by the arena*/\
+    if(!dynamicArray->arena) memory_track_alloc(memory_current_tag(), (newCapacity - dynamicArray->capacity) * sizeof(type));\
+    type* newData = dynamicArray->arena ?\
+      arena_realloc(dynamicArray->arena, dynamicArray->data, dynamicArray->capacity * sizeof(type), newCapacity * sizeof(type), _Alignof(type)) :\
+      realloc(dynamicArray->data, newCapacity * sizeof(type));\
     if(!newData) {\
       fprintf(stderr, "Failed to allocate memory");\
       fflush(stderr);\
@@ -63,6 +75,57 @@
     dynamicArray->length++;\
   }
 
+/* Small arrays keep the first inlineCapacity elements inside the struct, nothing is allocated until the list outgrows it.
+ * After that the elements are moved to the arena (or the heap when arena is NULL) and it grows like a dynamic array.
+ * The inline elements are only found through small_array_index, so the array can be copied and returned by value
+*/
+#define SmallArray(type) type##SmallArray
+#define small_array_index(type, array, index) type##_small_array_index(array, index)
+#define small_array_append(type, array, value) type##_small_array_append(array, value)
+#define create_small_array(type, allocator) (type##SmallArray){.arena=(allocator)}
+
+#define DEFINE_SMALL_ARRAY(type, inlineCapacity)\
+  typedef struct {\
+    type* data;\
+    size_t length;\
+    size_t capacity;\
+    Arena* arena;\
+    type inlineData[inlineCapacity];\
+  } type##SmallArray;\
+  \
+  type* type##_small_array_index(type##SmallArray* smallArray, size_t index) {\
+    if(index >= smallArray->length) {\
+      fprintf(stderr, "Index Out of Bounds");\
+      fflush(stderr);\
+      abort();\
+    }\
+    return smallArray->data ? &smallArray->data[index] : &smallArray->inlineData[index];\
+  }\
+  \
+  void type##_small_array_append(type##SmallArray* smallArray, const type* value) {\
+    if(!smallArray->data && smallArray->length < (inlineCapacity)) {\
+      smallArray->inlineData[smallArray->length++] = *value;\
+      return;\
+    }\
+    if(smallArray->length + 1 > smallArray->capacity) {\
+      /*with no inline elements the first append finds length 0*/\
+      size_t newCapacity = smallArray->length * 2 > 4 ? smallArray->length * 2 : 4;\
+      if(!smallArray->arena) memory_track_alloc(memory_current_tag(), (newCapacity - smallArray->capacity) * sizeof(type));\
+      type* newData = smallArray->arena ?\
+        arena_realloc(smallArray->arena, smallArray->data, smallArray->capacity * sizeof(type), newCapacity * sizeof(type), _Alignof(type)) :\
+        realloc(smallArray->data, newCapacity * sizeof(type));\
+      if(!newData) {\
+        fprintf(stderr, "Failed to allocate memory");\
+        fflush(stderr);\
+        abort();\
+      }\
+      if(!smallArray->data) memcpy(newData, smallArray->inlineData, smallArray->length * sizeof(type));\
+      smallArray->data = newData;\
+      smallArray->capacity = newCapacity;\
+    }\
+    smallArray->data[smallArray->length++] = *value;\
+  }
+
 #define Array(type) type##Array
 #define array_index(type, array, index) type##_array_index(array, index)
 #define create_array(type, data, length) (type##Array){data, length}
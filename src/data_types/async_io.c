@@ -0,0 +1,432 @@
+#ifndef ASYNC_IO_HEADER
+#define ASYNC_IO_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#if defined(__linux__) && !defined(ASYNC_IO_NO_URING)
+#include <linux/io_uring.h>
+#define ASYNC_IO_URING
+#endif
+
+#include "arena.c"
+#include "string.c"
+#include "io.c"
+
+// How many files the io_uring backend keeps in flight at once (also the number of open fds)
+#ifndef ASYNC_IO_QUEUE_DEPTH
+#define ASYNC_IO_QUEUE_DEPTH 64
+#endif //ASYNC_IO_QUEUE_DEPTH
+
+// Worker threads of the pread fallback
+#ifndef ASYNC_IO_THREAD_COUNT
+#define ASYNC_IO_THREAD_COUNT 4
+#endif //ASYNC_IO_THREAD_COUNT
+
+/* Reads a batch of whole files at once instead of one blocking read after the other.
+ * All the reads of a batch are added first, then submitted together. The reads go through io_uring when the kernel
+ * allows it, otherwise a few threads do blocking reads in parallel.
+ * Callbacks are always run on the thread that polls/waits on the batch (so they can make GL calls), in the order
+ * the reads complete, so a file can be decoded while the others are still being read.
+ *
+ *   AsyncReadBatch* batch = create_async_read_batch(arena, count);
+ *   async_read_file(batch, path, callback, userData);   //for every file
+ *   async_read_batch_submit(batch);
+ *   ...other work, calling async_read_batch_poll(batch) now and then...
+ *   async_read_batch_wait(batch);
+*/
+typedef struct AsyncRead AsyncRead;
+typedef void (*AsyncReadCallback)(AsyncRead* read);
+
+struct AsyncRead {
+  String path;
+  //data is only valid inside the callback, copy it out or take it with async_read_take_data if it's needed later
+  const char* data;
+  size_t len;
+  bool ok;
+  AsyncReadCallback callback;
+  void* userData;
+
+  char* buffer;
+  size_t size;
+  size_t done;
+  int fd;
+};
+
+#ifdef ASYNC_IO_URING
+typedef struct {
+  int fd;
+  unsigned entries;
+  void* sqRing;
+  size_t sqRingSize;
+  void* cqRing;
+  size_t cqRingSize;
+  struct io_uring_sqe* sqes;
+  size_t sqesSize;
+
+  _Atomic unsigned* sqHead;
+  _Atomic unsigned* sqTail;
+  unsigned sqMask;
+  unsigned* sqArray;
+  unsigned sqPending;
+
+  _Atomic unsigned* cqHead;
+  _Atomic unsigned* cqTail;
+  unsigned cqMask;
+  struct io_uring_cqe* cqes;
+} AsyncUring;
+#endif
+
+typedef struct {
+  Arena* arena;
+  AsyncRead* reads;
+  size_t count;
+  size_t capacity;
+  size_t completed;
+  bool submitted;
+  bool useUring;
+
+#ifdef ASYNC_IO_URING
+  AsyncUring ring;
+  size_t nextSubmit;
+  size_t inFlight;
+#endif
+
+  //pread fallback, workers claim reads with nextRead and push the finished ones to the finished list
+  bool threadsStarted;
+  pthread_t threads[ASYNC_IO_THREAD_COUNT];
+  size_t threadCount;
+  _Atomic size_t nextRead;
+  pthread_mutex_t lock;
+  pthread_cond_t finishedCond;
+  size_t* finished;
+  size_t finishedCount;
+} AsyncReadBatch;
+
+AsyncReadBatch* create_async_read_batch(Arena* arena, size_t capacity) {
+  AsyncReadBatch* batch = arena_alloc_struct(arena, AsyncReadBatch);
+  *batch = (AsyncReadBatch){0};
+  batch->arena = arena;
+  batch->reads = arena_alloc_array(arena, AsyncRead, capacity);
+  batch->finished = arena_alloc_array(arena, size_t, capacity);
+  batch->capacity = capacity;
+  return batch;
+}
+
+// The path is copied into the batch's arena so it doesn't have to outlive this call
+void async_read_file(AsyncReadBatch* batch, String path, AsyncReadCallback callback, void* userData) {
+  if(batch->submitted || batch->count == batch->capacity) {
+    fprintf(stderr, "Can't add %.*s to the read batch (it's full or already submitted)\n", (int)path.len, path.data);
+    fflush(stderr);
+    abort();
+  }
+  char* pathData = arena_alloc_align(batch->arena, path.len + 1, 1);
+  string_to_c_str(path, pathData);
+
+  batch->reads[batch->count++] = (AsyncRead){
+    .path=(String){pathData, path.len},
+    .callback=callback,
+    .userData=userData,
+    .fd=-1
+  };
+}
+
+// Opens the file and allocates a buffer for all of it, false when there is nothing to read
+static bool async_read_open(AsyncRead* read) {
+  read->fd = io_open(read->path);
+  if(read->fd == -1) return false;
+
+  struct stat fileStat;
+  if(fstat(read->fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0) return false;
+  read->size = fileStat.st_size;
+  read->buffer = malloc(read->size);
+  if(!read->buffer) {
+    fprintf(stderr, "Failed to allocate memory");
+    fflush(stderr);
+    abort();
+  }
+  return true;
+}
+
+static void async_read_blocking(AsyncRead* read) {
+  if(!async_read_open(read)) return;
+  read->done = io_read_all(read->fd, read->buffer, read->size);
+}
+
+// Gives the data of a read to the caller (only inside its callback), it has to be freed with free
+char* async_read_take_data(AsyncRead* read) {
+  char* data = read->buffer;
+  read->buffer = NULL;
+  return data;
+}
+
+static void async_read_finish(AsyncReadBatch* batch, AsyncRead* read) {
+  if(read->fd != -1) close(read->fd);
+  read->fd = -1;
+
+  read->ok = read->buffer && read->done == read->size;
+  read->data = read->buffer;
+  read->len = read->done;
+  if(read->callback) read->callback(read);
+
+  free(read->buffer);
+  read->buffer = NULL;
+  read->data = NULL;
+  batch->completed++;
+}
+
+//------------------------------------------
+// io_uring
+//------------------------------------------
+
+#ifdef ASYNC_IO_URING
+/* liburing isn't a dependency, the 2 syscalls and the ring layout are all that's needed.
+ * The kernel owns the sq head and the cq tail, we own the sq tail and the cq head
+*/
+static int async_uring_setup(AsyncUring* ring, unsigned entries) {
+  struct io_uring_params params = {0};
+  int fd = syscall(__NR_io_uring_setup, entries, &params);
+  if(fd < 0) return -1;
+
+  ring->fd = fd;
+  ring->entries = params.sq_entries;
+  ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  //newer kernels put both rings in the same mapping
+  bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if(singleMap && ring->cqRingSize > ring->sqRingSize) ring->sqRingSize = ring->cqRingSize;
+
+  ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  ring->cqRing = singleMap ? ring->sqRing : mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if(ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    if(ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqesSize);
+    if(!singleMap && ring->cqRing != MAP_FAILED) munmap(ring->cqRing, ring->cqRingSize);
+    if(ring->sqRing != MAP_FAILED) munmap(ring->sqRing, ring->sqRingSize);
+    close(fd);
+    return -1;
+  }
+
+  char* sq = ring->sqRing;
+  ring->sqHead = (_Atomic unsigned*)(sq + params.sq_off.head);
+  ring->sqTail = (_Atomic unsigned*)(sq + params.sq_off.tail);
+  ring->sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+  ring->sqPending = 0;
+
+  char* cq = ring->cqRing;
+  ring->cqHead = (_Atomic unsigned*)(cq + params.cq_off.head);
+  ring->cqTail = (_Atomic unsigned*)(cq + params.cq_off.tail);
+  ring->cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  return 0;
+}
+
+static void async_uring_free(AsyncUring* ring) {
+  munmap(ring->sqes, ring->sqesSize);
+  if(ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+  munmap(ring->sqRing, ring->sqRingSize);
+  close(ring->fd);
+}
+
+static int async_uring_enter(AsyncUring* ring, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  int result;
+  do result = syscall(__NR_io_uring_enter, ring->fd, toSubmit, minComplete, flags, NULL, 0);
+  while(result < 0 && errno == EINTR);
+  return result;
+}
+
+// Queues a read of the rest of the file, it's only sent to the kernel by async_uring_flush
+static void async_uring_queue_read(AsyncUring* ring, AsyncRead* read, size_t index) {
+  unsigned tail = atomic_load_explicit(ring->sqTail, memory_order_relaxed);
+  unsigned slot = tail & ring->sqMask;
+  struct io_uring_sqe* sqe = &ring->sqes[slot];
+
+  size_t remaining = read->size - read->done;
+  //a single read is capped by the kernel at a bit under 2GB anyway
+  if(remaining > 0x7ffff000) remaining = 0x7ffff000;
+
+  *sqe = (struct io_uring_sqe){0};
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = read->fd;
+  sqe->off = read->done;
+  sqe->addr = (uintptr_t)(read->buffer + read->done);
+  sqe->len = remaining;
+  sqe->user_data = index;
+
+  ring->sqArray[slot] = slot;
+  atomic_store_explicit(ring->sqTail, tail + 1, memory_order_release);
+  ring->sqPending++;
+}
+
+static void async_uring_flush(AsyncUring* ring) {
+  while(ring->sqPending) {
+    int submitted = async_uring_enter(ring, ring->sqPending, 0, 0);
+    if(submitted <= 0) break;
+    ring->sqPending -= submitted;
+  }
+}
+
+// Opens reads until the ring is full, files that can't be opened complete right away
+static void async_uring_submit_pending(AsyncReadBatch* batch) {
+  while(batch->nextSubmit < batch->count && batch->inFlight < batch->ring.entries) {
+    size_t index = batch->nextSubmit++;
+    AsyncRead* read = &batch->reads[index];
+    if(!async_read_open(read)) {
+      async_read_finish(batch, read);
+      continue;
+    }
+    async_uring_queue_read(&batch->ring, read, index);
+    batch->inFlight++;
+  }
+  async_uring_flush(&batch->ring);
+}
+
+static size_t async_uring_reap(AsyncReadBatch* batch, bool wait) {
+  AsyncUring* ring = &batch->ring;
+  unsigned head = atomic_load_explicit(ring->cqHead, memory_order_relaxed);
+  if(wait && batch->inFlight && head == atomic_load_explicit(ring->cqTail, memory_order_acquire)) {
+    async_uring_enter(ring, 0, 1, IORING_ENTER_GETEVENTS);
+  }
+
+  size_t finished = 0;
+  unsigned tail = atomic_load_explicit(ring->cqTail, memory_order_acquire);
+  for(; head != tail; head++) {
+    struct io_uring_cqe cqe = ring->cqes[head & ring->cqMask];
+    AsyncRead* read = &batch->reads[cqe.user_data];
+
+    if(cqe.res == -EINTR || cqe.res == -EAGAIN) {
+      async_uring_queue_read(ring, read, cqe.user_data);
+      continue;
+    }
+    if(cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+      //old kernels don't have IORING_OP_READ
+      lseek(read->fd, read->done, SEEK_SET);
+      read->done += io_read_all(read->fd, read->buffer + read->done, read->size - read->done);
+    }
+    else if(cqe.res > 0) {
+      read->done += cqe.res;
+      if(read->done < read->size) {
+        async_uring_queue_read(ring, read, cqe.user_data);
+        continue;
+      }
+    }
+    //cqe.res == 0 is the end of the file, the read is short and fails in async_read_finish
+
+    batch->inFlight--;
+    async_read_finish(batch, read);
+    finished++;
+  }
+  atomic_store_explicit(ring->cqHead, head, memory_order_release);
+
+  async_uring_submit_pending(batch);
+  return finished;
+}
+#endif
+
+//------------------------------------------
+// pread threads
+//------------------------------------------
+
+static void* async_read_worker(void* data) {
+  AsyncReadBatch* batch = data;
+  for(;;) {
+    size_t index = atomic_fetch_add_explicit(&batch->nextRead, 1, memory_order_relaxed);
+    if(index >= batch->count) break;
+    async_read_blocking(&batch->reads[index]);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->finished[batch->finishedCount++] = index;
+    pthread_cond_signal(&batch->finishedCond);
+    pthread_mutex_unlock(&batch->lock);
+  }
+  return NULL;
+}
+
+static size_t async_threads_reap(AsyncReadBatch* batch, bool wait) {
+  pthread_mutex_lock(&batch->lock);
+  while(wait && batch->finishedCount == batch->completed) pthread_cond_wait(&batch->finishedCond, &batch->lock);
+  size_t finishedCount = batch->finishedCount;
+  pthread_mutex_unlock(&batch->lock);
+
+  //the finished list only grows, so the entries before finishedCount can be read without the lock
+  size_t begin = batch->completed;
+  for(size_t i = begin; i < finishedCount; i++) async_read_finish(batch, &batch->reads[batch->finished[i]]);
+  return finishedCount - begin;
+}
+
+//------------------------------------------
+// Batch
+//------------------------------------------
+
+void async_read_batch_submit(AsyncReadBatch* batch) {
+  batch->submitted = true;
+  if(!batch->count) return;
+
+#ifdef ASYNC_IO_URING
+  unsigned entries = batch->count < ASYNC_IO_QUEUE_DEPTH ? batch->count : ASYNC_IO_QUEUE_DEPTH;
+  batch->useUring = async_uring_setup(&batch->ring, entries) == 0;
+  if(batch->useUring) {
+    async_uring_submit_pending(batch);
+    return;
+  }
+#endif
+
+  batch->threadsStarted = true;
+  pthread_mutex_init(&batch->lock, NULL);
+  pthread_cond_init(&batch->finishedCond, NULL);
+  atomic_init(&batch->nextRead, 0);
+  size_t threadCount = batch->count < ASYNC_IO_THREAD_COUNT ? batch->count : ASYNC_IO_THREAD_COUNT;
+  for(size_t i = 0; i < threadCount; i++) {
+    if(pthread_create(&batch->threads[i], NULL, async_read_worker, batch) != 0) break;
+    batch->threadCount++;
+  }
+  //without any threads the reads are done on this thread when the batch is polled
+}
+
+// Runs the callbacks of the reads that are done without blocking, returns how many ran
+size_t async_read_batch_poll(AsyncReadBatch* batch) {
+  if(!batch->submitted || batch->completed == batch->count) return 0;
+#ifdef ASYNC_IO_URING
+  if(batch->useUring) return async_uring_reap(batch, false);
+#endif
+  if(!batch->threadCount) async_read_worker(batch);
+  return async_threads_reap(batch, false);
+}
+
+// Blocks until every read of the batch has completed and its callback has run
+void async_read_batch_wait(AsyncReadBatch* batch) {
+  if(!batch->submitted) async_read_batch_submit(batch);
+
+#ifdef ASYNC_IO_URING
+  if(batch->useUring) {
+    while(batch->completed < batch->count) async_uring_reap(batch, true);
+    async_uring_free(&batch->ring);
+    batch->useUring = false;
+    return;
+  }
+#endif
+
+  if(!batch->threadsStarted) return;
+  if(!batch->threadCount) async_read_worker(batch);
+  while(batch->completed < batch->count) async_threads_reap(batch, true);
+  for(size_t i = 0; i < batch->threadCount; i++) pthread_join(batch->threads[i], NULL);
+  batch->threadCount = 0;
+  pthread_cond_destroy(&batch->finishedCond);
+  pthread_mutex_destroy(&batch->lock);
+  batch->threadsStarted = false;
+}
+
+#endif
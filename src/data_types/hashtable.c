@@ -3,76 +3,253 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <malloc.h>
 #include <stdbool.h>
 #include <memory.h>
 
+#include "arena.c"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Open addressing hash table in the style of SwissTable
+ * Every slot has a control byte that is either EMPTY, DELETED or the low 7 bits of the hash (H2).
+ * Lookups compare a whole group of control bytes against H2 at once and only look at the slots that match,
+ * the full hash is stored in the slot so hashFunc is called once per operation and never when resizing.
+ * The control bytes of the first group are mirrored after the last slot so a group can be loaded at any index
+*/
+#define HASH_TABLE_EMPTY ((int8_t)-128)
+#define HASH_TABLE_DELETED ((int8_t)-2)
+#define HASH_TABLE_MIN_CAPACITY 16
+
+#if defined(__SSE2__)
+#define HASH_TABLE_GROUP_WIDTH 16
+#define HASH_TABLE_BIT_SHIFT 0
+
+static inline uint64_t hash_table_group_match(const int8_t* ctrl, int8_t h2) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), group));
+}
+
+static inline uint64_t hash_table_group_match_empty(const int8_t* ctrl) {
+  return hash_table_group_match(ctrl, HASH_TABLE_EMPTY);
+}
+
+static inline uint64_t hash_table_group_match_empty_or_deleted(const int8_t* ctrl) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint64_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), group));
+}
+#else
+//Portable fallback that works on 8 control bytes at a time inside a uint64_t, the match for byte i is bit 8*i+7
+#define HASH_TABLE_GROUP_WIDTH 8
+#define HASH_TABLE_BIT_SHIFT 3
+#define HASH_TABLE_LSBS 0x0101010101010101ull
+#define HASH_TABLE_MSBS 0x8080808080808080ull
+
+static inline uint64_t hash_table_load_group(const int8_t* ctrl) {
+  uint64_t group;
+  memcpy(&group, ctrl, sizeof(group));
+  return group;
+}
+
+//Can give false positives, they are filtered out when the stored hash and key get compared
+static inline uint64_t hash_table_group_match(const int8_t* ctrl, int8_t h2) {
+  uint64_t x = hash_table_load_group(ctrl) ^ (HASH_TABLE_LSBS * (uint8_t)h2);
+  return (x - HASH_TABLE_LSBS) & ~x & HASH_TABLE_MSBS;
+}
+
+static inline uint64_t hash_table_group_match_empty(const int8_t* ctrl) {
+  uint64_t group = hash_table_load_group(ctrl);
+  return (group & ~(group << 6)) & HASH_TABLE_MSBS;
+}
+
+static inline uint64_t hash_table_group_match_empty_or_deleted(const int8_t* ctrl) {
+  uint64_t group = hash_table_load_group(ctrl);
+  return (group & ~(group << 7)) & HASH_TABLE_MSBS;
+}
+#endif
+
+#define hash_table_next_bit(mask) ((size_t)__builtin_ctzll(mask) >> HASH_TABLE_BIT_SHIFT)
+
+//Mixes the result of hashFunc so weak hash functions still spread over H1 and H2
+static inline uint64_t hash_table_mix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static inline size_t hash_table_capacity_for(size_t count) {
+  //keeps the load factor under 7/8
+  size_t capacity = HASH_TABLE_MIN_CAPACITY;
+  while(capacity - capacity/8 < count) capacity *= 2;
+  return capacity;
+}
+
+static inline void hash_table_set_ctrl(int8_t* ctrl, size_t capacity, size_t index, int8_t value) {
+  ctrl[index] = value;
+  if(index < HASH_TABLE_GROUP_WIDTH) ctrl[capacity + index] = value;
+}
+
+//Finds the first EMPTY or DELETED slot in the probe sequence of the hash
+static inline size_t hash_table_find_first_non_full(const int8_t* ctrl, size_t capacity, uint64_t hash) {
+  size_t mask = capacity - 1;
+  size_t position = (hash >> 7) & mask;
+  for(size_t step = HASH_TABLE_GROUP_WIDTH;; step += HASH_TABLE_GROUP_WIDTH) {
+    uint64_t match = hash_table_group_match_empty_or_deleted(ctrl + position);
+    if(match) return (position + hash_table_next_bit(match)) & mask;
+    position = (position + step) & mask;
+  }
+}
+
+//The control bytes and the slots are a single allocation, the slots come after the control bytes
+static inline void* hash_table_alloc(Arena* arena, size_t size) {
+  if(arena) return arena_alloc_align(arena, size, 16);
+  void* data = malloc(size);
+  if(!data) {
+    fprintf(stderr, "Failed to allocate memory");
+    fflush(stderr);
+    abort();
+  }
+  return data;
+}
+
 #define HashTable(key_t, value_t) key_t##_##value_t##_Table
 #define KeyValue(key_t, value_t) key_t##_##value_t##_Pair
-#define create_hash_table(key_t, value_t, data, capacity) create_##key_t##_##value_t##_table(data, capacity)
+// arena can be NULL, then the table is allocated with malloc and has to be freed with free_hash_table
+#define create_hash_table(key_t, value_t, arena, capacity) create_##key_t##_##value_t##_table(arena, capacity)
+#define free_hash_table(key_t, value_t, table) free_##key_t##_##value_t##_table(table)
+// returns NULL when the key isn't in the table
 #define hash_table_index(key_t, value_t, table, key) key_t##_##value_t##_table_index(table, key)
 #define hash_table_set(key_t, value_t, table, key, value) key_t##_##value_t##_table_set(table, key, value)
 #define hash_table_get(key_t, value_t, table, key, defaultValue) key_t##_##value_t##_table_get(table, key, defaultValue)
 #define hash_table_contains(key_t, value_t, table, key) key_t##_##value_t##_table_contains(table, key)
+#define hash_table_remove(key_t, value_t, table, key) key_t##_##value_t##_table_remove(table, key)
 
-#define DEFINE_HASH_TABLE(key_t, value_t, hashFunc, isEqual);\
+#define hash_table_foreach(key_t, value_t, hashTable, var, code)\
+  for(size_t i__ = 0; i__ < (hashTable)->capacity; i__++) {\
+    if((hashTable)->ctrl[i__] < 0) continue;\
+    key_t##_##value_t##_Pair* var = &(hashTable)->slots[i__];\
+    code\
+  }
+
+#define DEFINE_HASH_TABLE(key_t, value_t, hashFunc, isEqual)\
   typedef struct {\
-    bool taken;\
+    uint64_t hash;\
     key_t key;\
     value_t value;\
   } key_t##_##value_t##_Pair;\
 \
   typedef struct {\
-    key_t##_##value_t##_Pair* table;\
+    int8_t* ctrl;\
+    key_t##_##value_t##_Pair* slots;\
     size_t capacity;\
+    size_t count;\
+    size_t growthLeft;\
+    Arena* arena;\
   } key_t##_##value_t##_Table;\
 \
-  key_t##_##value_t##_Pair* key_t##_##value_t##_table_look_up(key_t##_##value_t##_Table* table, key_t key) {\
-    uint64_t hashValue = hashFunc(key);\
-    for(size_t index = (hashValue%table->capacity); index < table->capacity; index++) {\
-      if(!table->table[index].taken || isEqual(table->table[index].key, key)) return &table->table[index];\
-    }\
-    assert(false);\
+  void key_t##_##value_t##_table_allocate(key_t##_##value_t##_Table* table, size_t capacity) {\
+    size_t ctrlSize = (capacity + HASH_TABLE_GROUP_WIDTH + 15) & ~(size_t)15;\
+    char* data = hash_table_alloc(table->arena, ctrlSize + capacity*sizeof(key_t##_##value_t##_Pair));\
+    table->ctrl = (int8_t*)data;\
+    table->slots = (key_t##_##value_t##_Pair*)(data + ctrlSize);\
+    table->capacity = capacity;\
+    table->count = 0;\
+    table->growthLeft = capacity - capacity/8;\
+    memset(table->ctrl, HASH_TABLE_EMPTY, capacity + HASH_TABLE_GROUP_WIDTH);\
   }\
 \
-  value_t* key_t##_##value_t##_table_index(key_t##_##value_t##_Table* table, key_t key) {\
-    key_t##_##value_t##_Pair* pair = key_t##_##value_t##_table_look_up(table, key);\
-    return &pair->value;\
+  key_t##_##value_t##_Table create_##key_t##_##value_t##_table(Arena* arena, size_t capacity) {\
+    key_t##_##value_t##_Table table = (key_t##_##value_t##_Table){.arena=arena};\
+    key_t##_##value_t##_table_allocate(&table, hash_table_capacity_for(capacity));\
+    return table;\
   }\
-  void key_t##_##value_t##_table_set(key_t##_##value_t##_Table* table, key_t key, value_t value) {\
-    key_t##_##value_t##_Pair* pair = key_t##_##value_t##_table_look_up(table, key);\
-    pair->taken = true;\
-    pair->key = key;\
-    pair->value = value;\
+\
+  void free_##key_t##_##value_t##_table(key_t##_##value_t##_Table* table) {\
+    if(!table->arena) free(table->ctrl);\
+    table->ctrl = NULL;\
+    table->slots = NULL;\
+    table->capacity = 0;\
+    table->count = 0;\
+  }\
+\
+  /* Rebuilds the table with 'capacity' slots, this also gets rid of every DELETED slot */\
+  void key_t##_##value_t##_table_resize(key_t##_##value_t##_Table* table, size_t capacity) {\
+    key_t##_##value_t##_Table old = *table;\
+    key_t##_##value_t##_table_allocate(table, capacity);\
+    for(size_t i = 0; i < old.capacity; i++) {\
+      if(old.ctrl[i] < 0) continue;\
+      uint64_t hash = old.slots[i].hash;\
+      size_t index = hash_table_find_first_non_full(table->ctrl, table->capacity, hash);\
+      hash_table_set_ctrl(table->ctrl, table->capacity, index, (int8_t)(hash & 0x7F));\
+      table->slots[index] = old.slots[i];\
+    }\
+    table->count = old.count;\
+    table->growthLeft -= old.count;\
+    if(!table->arena) free(old.ctrl);\
   }\
 \
-  value_t key_t##_##value_t##_table_get(const key_t##_##value_t##_Table* table, key_t key, value_t default_value) {\
-    uint64_t hashValue = hashFunc(key);\
-    key_t##_##value_t##_Pair* pair;\
-    for(size_t index = (hashValue%table->capacity); index < table->capacity; index++) {\
-      if(!table->table[index].taken || isEqual(table->table[index].key, key)) {\
-        pair = table->table + index;\
-        return pair->value;\
+  size_t key_t##_##value_t##_table_find(const key_t##_##value_t##_Table* table, key_t key, uint64_t hash) {\
+    size_t mask = table->capacity - 1;\
+    size_t position = (hash >> 7) & mask;\
+    int8_t h2 = (int8_t)(hash & 0x7F);\
+    for(size_t step = HASH_TABLE_GROUP_WIDTH;; step += HASH_TABLE_GROUP_WIDTH) {\
+      const int8_t* group = table->ctrl + position;\
+      for(uint64_t match = hash_table_group_match(group, h2); match; match &= match - 1) {\
+        size_t index = (position + hash_table_next_bit(match)) & mask;\
+        if(table->slots[index].hash == hash && isEqual(table->slots[index].key, key)) return index;\
       }\
+      if(hash_table_group_match_empty(group)) return SIZE_MAX;\
+      position = (position + step) & mask;\
     }\
-    return default_value;\
   }\
 \
-  bool key_t##_##value_t##_table_contains(key_t##_##value_t##_Table* table, key_t key) {\
-    key_t##_##value_t##_Pair* pair = key_t##_##value_t##_table_look_up(table, key);\
-    return pair->taken;\
+  value_t* key_t##_##value_t##_table_index(const key_t##_##value_t##_Table* table, key_t key) {\
+    size_t index = key_t##_##value_t##_table_find(table, key, hash_table_mix(hashFunc(key)));\
+    return index == SIZE_MAX ? NULL : &table->slots[index].value;\
   }\
 \
-  key_t##_##value_t##_Table create_##key_t##_##value_t##_table(key_t##_##value_t##_Pair* data, size_t capacity) {\
-    for(size_t i = 0; i < capacity; i++) data[i].taken = false;\
-    key_t##_##value_t##_Table table = (key_t##_##value_t##_Table){.table=data, .capacity=capacity};\
-    return table;\
+  void key_t##_##value_t##_table_set(key_t##_##value_t##_Table* table, key_t key, value_t value) {\
+    uint64_t hash = hash_table_mix(hashFunc(key));\
+    size_t index = key_t##_##value_t##_table_find(table, key, hash);\
+    if(index != SIZE_MAX) {\
+      table->slots[index].value = value;\
+      return;\
+    }\
+    index = hash_table_find_first_non_full(table->ctrl, table->capacity, hash);\
+    if(table->growthLeft == 0 && table->ctrl[index] == HASH_TABLE_EMPTY) {\
+      /* when most of the used up slots are DELETED rehashing in place is enough */\
+      bool mostlyDeleted = table->count*2 <= table->capacity - table->capacity/8;\
+      key_t##_##value_t##_table_resize(table, mostlyDeleted ? table->capacity : 2*table->capacity);\
+      index = hash_table_find_first_non_full(table->ctrl, table->capacity, hash);\
+    }\
+    if(table->ctrl[index] == HASH_TABLE_EMPTY) table->growthLeft--;\
+    hash_table_set_ctrl(table->ctrl, table->capacity, index, (int8_t)(hash & 0x7F));\
+    table->slots[index] = (key_t##_##value_t##_Pair){hash, key, value};\
+    table->count++;\
   }\
 \
-  void free_##key_t##_##value_t##_table(key_t##_##value_t##_Table* table) {\
-    free(table->table);\
-    table->capacity = 0;\
-    table->table = NULL;\
+  value_t key_t##_##value_t##_table_get(const key_t##_##value_t##_Table* table, key_t key, value_t defaultValue) {\
+    value_t* value = key_t##_##value_t##_table_index(table, key);\
+    return value ? *value : defaultValue;\
+  }\
+\
+  bool key_t##_##value_t##_table_contains(const key_t##_##value_t##_Table* table, key_t key) {\
+    return key_t##_##value_t##_table_index(table, key) != NULL;\
+  }\
+\
+  bool key_t##_##value_t##_table_remove(key_t##_##value_t##_Table* table, key_t key) {\
+    size_t index = key_t##_##value_t##_table_find(table, key, hash_table_mix(hashFunc(key)));\
+    if(index == SIZE_MAX) return false;\
+    hash_table_set_ctrl(table->ctrl, table->capacity, index, HASH_TABLE_DELETED);\
+    table->count--;\
+    return true;\
   }
 
 #endif
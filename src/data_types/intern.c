@@ -0,0 +1,57 @@
+#ifndef INTERN_HEADER
+#define INTERN_HEADER
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "arena.c"
+#include "string.c"
+#include "hashtable.c"
+
+#ifndef INTERN_ARENA_RESERVE
+#define INTERN_ARENA_RESERVE ((size_t)1 << 30)
+#endif //INTERN_ARENA_RESERVE
+
+/* A string that has been put into the global intern table.
+ * The same text always gives back the same id, and the hash is computed once when the string is interned,
+ * so comparing is an integer compare and hashing is a load.
+ * Id 0 is never given out, a zero initialized InternedString is "no string" and doesn't equal any interned one.
+ * The data of the string is owned by the intern table and lives until the end of the program
+*/
+typedef struct {
+  String string;
+  uint64_t hash;
+  uint32_t id;
+} InternedString;
+
+DEFINE_HASH_TABLE(String, InternedString, string_hash, string_equals)
+
+static Arena internArena;
+static HashTable(String, InternedString) internTable;
+static uint32_t internCount;
+
+//This isn't thread safe, intern the strings on the main thread (ideally once at startup)
+InternedString intern_string(String string) {
+  if(!internArena.data) {
+    internArena = create_virtual_arena(INTERN_ARENA_RESERVE);
+    internTable = create_hash_table(String, InternedString, NULL, 256);
+  }
+
+  InternedString* interned = hash_table_index(String, InternedString, &internTable, string);
+  if(interned) return *interned;
+
+  char* data = arena_alloc_align(&internArena, string.len + 1, 1);
+  string_to_c_str(string, data);
+  String copy = (String){data, string.len};
+
+  InternedString result = (InternedString){copy, string_hash(copy), ++internCount};
+  hash_table_set(String, InternedString, &internTable, copy, result);
+  return result;
+}
+
+#define intern_string_literal(s) intern_string(create_string_from_literal(s))
+
+uint64_t interned_string_hash(InternedString string) { return string.hash; }
+bool interned_string_equals(InternedString a, InternedString b) { return a.id == b.id; }
+
+#endif
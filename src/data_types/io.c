@@ -2,32 +2,207 @@
 #define IO_HEADER
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "string.c"
 #include "arena.c"
 
-String read_file(Arena* arena, String filename) {
-  FILE *fileptr;
-  char filename_c[filename.len + 1];
-  string_to_c_str(filename, filename_c);
-  fileptr = fopen(filename_c, "r");
-  if(!fileptr) {
-    fprintf(stderr, "%s isn't a valid file path\n", filename_c);
+// Opens the file at filePath, returns -1 when it can't be opened
+static int io_open(String filePath) {
+  char cFilePath[filePath.len + 1];
+  string_to_c_str(filePath, cFilePath);
+  int fd = open(cFilePath, O_RDONLY | O_CLOEXEC);
+  if(fd == -1) {
+    fprintf(stderr, "%s isn't a valid file path\n", cFilePath);
     fflush(stderr);
-    return (String){0};
   }
+  return fd;
+}
 
-  fseek(fileptr, 0, SEEK_END);
-  size_t n = ftell(fileptr);
-  fseek(fileptr, 0, SEEK_SET);
+// read() can return less than asked for, keeps reading until size bytes are read or the file ends
+static size_t io_read_all(int fd, char* data, size_t size) {
+  size_t done = 0;
+  while(done < size) {
+    ssize_t n = read(fd, data + done, size - done);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) break;
+    done += n;
+  }
+  return done;
+}
+
+String read_file(Arena* arena, String filename) {
+  int fd = io_open(filename);
+  if(fd == -1) return (String){0};
+
+  struct stat fileStat;
+  if(fstat(fd, &fileStat) != 0) {
+    close(fd);
+    return (String){0};
+  }
+  size_t n = fileStat.st_size;
 
   char *str = arena_alloc(arena,sizeof(char)*n);
+  n = io_read_all(fd, str, n);
+  close(fd);
 
-  assert(fread(str, 1, n, fileptr) == n);
-  fclose(fileptr);
   String string = {0};
   string.data = str;
   string.len = n;
   return string;
 }
 
+/* Writes the whole file next to filename and renames it over the old one,
+ * so a reader never sees a half written file. Returns false when the file couldn't be written
+*/
+bool write_file(String filename, const void* data, size_t size) {
+  char cFilePath[filename.len + 1];
+  string_to_c_str(filename, cFilePath);
+  char tmpFilePath[filename.len + 32];
+  snprintf(tmpFilePath, sizeof(tmpFilePath), "%s.%d.tmp", cFilePath, (int)getpid());
+
+  int fd = open(tmpFilePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd == -1) {
+    fprintf(stderr, "Failed to create %s\n", tmpFilePath);
+    fflush(stderr);
+    return false;
+  }
+  size_t done = 0;
+  while(done < size) {
+    ssize_t n = write(fd, (const char*)data + done, size - done);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) break;
+    done += n;
+  }
+  bool ok = close(fd) == 0 && done == size;
+  if(ok) ok = rename(tmpFilePath, cFilePath) == 0;
+  if(!ok) {
+    fprintf(stderr, "Failed to write %s\n", cFilePath);
+    fflush(stderr);
+    unlink(tmpFilePath);
+  }
+  return ok;
+}
+
+//------------------------------------------
+// File View
+//------------------------------------------
+
+/* A read only view of a whole file (or part of one) that is used in place instead of being copied into an arena.
+ * Files are mmapped when possible, files that can't be mapped (pipes, empty or special files) are read into a malloc'd buffer.
+ * Views can be sliced and shared, the mapping is released when the last view of it is closed
+*/
+typedef enum {
+  FILE_VIEW_NORMAL,
+  FILE_VIEW_SEQUENTIAL, // read once front to back (shader sources, json)
+  FILE_VIEW_WILLNEED,   // everything will be used soon, start reading all of it in now (vertex buffers)
+  FILE_VIEW_RANDOM,
+} FileViewHint;
+
+typedef struct {
+  _Atomic uint32_t refCount;
+  bool mapped;
+  void* base;
+  size_t size;
+} FileViewShared;
+
+typedef struct {
+  const char* data;
+  size_t len;
+  FileViewShared* shared;
+} FileView;
+
+static const int fileViewAdvice[] = {
+  [FILE_VIEW_NORMAL] = MADV_NORMAL,
+  [FILE_VIEW_SEQUENTIAL] = MADV_SEQUENTIAL,
+  [FILE_VIEW_WILLNEED] = MADV_WILLNEED,
+  [FILE_VIEW_RANDOM] = MADV_RANDOM,
+};
+
+// returns an empty view when the file can't be opened
+FileView open_file_view(String filePath, FileViewHint hint) {
+  int fd = io_open(filePath);
+  if(fd == -1) return (FileView){0};
+
+  struct stat fileStat;
+  size_t size = fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) ? fileStat.st_size : 0;
+
+  FileViewShared* shared = malloc(sizeof(FileViewShared));
+  if(!shared) {
+    fprintf(stderr, "Failed to allocate memory");
+    fflush(stderr);
+    abort();
+  }
+  atomic_init(&shared->refCount, 1);
+
+  void* base = MAP_FAILED;
+#ifndef FILE_VIEW_NO_MMAP
+  if(size) base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+#endif
+  if(base != MAP_FAILED) {
+    madvise(base, size, fileViewAdvice[hint]);
+    shared->mapped = true;
+  }
+  else {
+    //read() fallback, the size isn't known up front for non regular files so the buffer grows as it's read
+    bool knownSize = size != 0;
+    size_t capacity = knownSize ? size : 4096;
+    size = 0;
+    base = malloc(capacity);
+    for(;;) {
+      if(!base) {
+        fprintf(stderr, "Failed to allocate memory");
+        fflush(stderr);
+        abort();
+      }
+      size_t n = io_read_all(fd, (char*)base + size, capacity - size);
+      size += n;
+      if(knownSize || size < capacity) break;
+      capacity *= 2;
+      base = realloc(base, capacity);
+    }
+    shared->mapped = false;
+  }
+  close(fd);
+
+  shared->base = base;
+  shared->size = size;
+  return (FileView){base, size, shared};
+}
+
+// Gives another reference to the same memory, every retained view has to be closed
+FileView file_view_retain(FileView view) {
+  if(view.shared) atomic_fetch_add_explicit(&view.shared->refCount, 1, memory_order_relaxed);
+  return view;
+}
+
+// A retained view of len bytes starting at offset (clamped to the view)
+FileView file_view_slice(FileView view, size_t offset, size_t len) {
+  if(offset > view.len) offset = view.len;
+  if(len > view.len - offset) len = view.len - offset;
+  FileView slice = file_view_retain(view);
+  slice.data += offset;
+  slice.len = len;
+  return slice;
+}
+
+void close_file_view(FileView* view) {
+  FileViewShared* shared = view->shared;
+  *view = (FileView){0};
+  if(!shared || atomic_fetch_sub_explicit(&shared->refCount, 1, memory_order_acq_rel) != 1) return;
+
+  if(shared->mapped) munmap(shared->base, shared->size);
+  else free(shared->base);
+  free(shared);
+}
+
+String file_view_string(FileView view) { return (String){view.data, view.len}; }
+
 #endif
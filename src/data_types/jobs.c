@@ -0,0 +1,364 @@
+#ifndef JOBS_HEADER
+#define JOBS_HEADER
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "arena.c"
+
+#ifndef JOB_MAX_WORKERS
+#define JOB_MAX_WORKERS 64
+#endif //JOB_MAX_WORKERS
+
+// Jobs each worker can have queued at once (must be a power of 2), a job pushed to a full queue runs right away
+#ifndef JOB_QUEUE_CAPACITY
+#define JOB_QUEUE_CAPACITY 4096
+#endif //JOB_QUEUE_CAPACITY
+
+// How many times an idle worker looks for work before it goes to sleep
+#ifndef JOB_IDLE_SPINS
+#define JOB_IDLE_SPINS 64
+#endif //JOB_IDLE_SPINS
+
+#define JOB_CACHE_LINE 64
+
+/* Work stealing job system.
+ * The thread that calls setup_job_system becomes worker 0, the other workers are new threads.
+ * Every worker has its own Chase-Lev deque: the owner pushes and pops at the bottom without locks, idle workers steal from the top.
+ * A JobCounter is incremented for every job started with it and decremented when the job ends,
+ * wait_for_counter runs other jobs until it reaches 0, so waiting inside a job doesn't block a worker.
+ * Jobs can only be started and waited on from the job system's own threads
+*/
+typedef void (*JobFunction)(void* data);
+
+typedef struct {
+  JobFunction function;
+  void* data;
+} Job;
+
+typedef struct {
+  _Atomic int64_t value;
+} JobCounter;
+
+/* A thief reads the slot before it claims it with the CAS on top, so the slot can be overwritten under it.
+ * The fields are relaxed atomics to make that read well defined, a torn read is thrown away when the CAS fails
+*/
+typedef struct {
+  _Atomic(JobFunction) function;
+  _Atomic(void*) data;
+  _Atomic(JobCounter*) counter;
+} JobSlot;
+
+typedef struct {
+  alignas(JOB_CACHE_LINE) _Atomic int64_t top;
+  alignas(JOB_CACHE_LINE) _Atomic int64_t bottom;
+  alignas(JOB_CACHE_LINE) JobSlot slots[JOB_QUEUE_CAPACITY];
+} JobDeque;
+
+typedef struct {
+  JobFunction function;
+  void* data;
+  JobCounter* counter;
+} QueuedJob;
+
+static struct {
+  uint32_t workerCount;
+  _Atomic bool running;
+  JobDeque* deques;
+  pthread_t threads[JOB_MAX_WORKERS];
+
+  //idle workers sleep on the condition until a job is pushed
+  alignas(JOB_CACHE_LINE) _Atomic int64_t queuedJobs;
+  _Atomic uint32_t sleepingWorkers;
+  pthread_mutex_t sleepLock;
+  pthread_cond_t wakeUp;
+} jobSystem;
+
+static _Thread_local uint32_t jobWorkerIndex = UINT32_MAX;
+static _Thread_local uint32_t jobRandomState;
+
+//------------------------------------------
+// Chase-Lev deque
+//------------------------------------------
+
+static bool job_deque_push(JobDeque* deque, QueuedJob job) {
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  if(bottom - top >= JOB_QUEUE_CAPACITY) return false;
+
+  JobSlot* slot = &deque->slots[bottom & (JOB_QUEUE_CAPACITY - 1)];
+  atomic_store_explicit(&slot->function, job.function, memory_order_relaxed);
+  atomic_store_explicit(&slot->data, job.data, memory_order_relaxed);
+  atomic_store_explicit(&slot->counter, job.counter, memory_order_relaxed);
+  //publishes the slot (and whatever the job's data points at) to the thieves that acquire bottom
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+  return true;
+}
+
+static QueuedJob job_slot_load(JobSlot* slot) {
+  return (QueuedJob){
+    atomic_load_explicit(&slot->function, memory_order_relaxed),
+    atomic_load_explicit(&slot->data, memory_order_relaxed),
+    atomic_load_explicit(&slot->counter, memory_order_relaxed),
+  };
+}
+
+// Only called by the owner, takes the newest job
+static bool job_deque_pop(JobDeque* deque, QueuedJob* job) {
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+  if(top > bottom) {
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return false;
+  }
+
+  *job = job_slot_load(&deque->slots[bottom & (JOB_QUEUE_CAPACITY - 1)]);
+  if(top == bottom) {
+    //last job, race the thieves for it
+    bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+// Called by the other workers, takes the oldest job
+static bool job_deque_steal(JobDeque* deque, QueuedJob* job) {
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+  if(top >= bottom) return false;
+
+  *job = job_slot_load(&deque->slots[top & (JOB_QUEUE_CAPACITY - 1)]);
+  return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+//------------------------------------------
+// Workers
+//------------------------------------------
+
+static void job_execute(QueuedJob job) {
+  atomic_fetch_sub_explicit(&jobSystem.queuedJobs, 1, memory_order_relaxed);
+  job.function(job.data);
+  if(job.counter) atomic_fetch_sub_explicit(&job.counter->value, 1, memory_order_release);
+}
+
+static uint32_t job_random(void) {
+  //xorshift32, it only picks which worker to steal from
+  uint32_t x = jobRandomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return jobRandomState = x;
+}
+
+// Runs one job from this worker's deque or stolen from another one, false when there was nothing to do
+static bool job_try_run_one(void) {
+  QueuedJob job;
+  if(job_deque_pop(&jobSystem.deques[jobWorkerIndex], &job)) {
+    job_execute(job);
+    return true;
+  }
+
+  uint32_t workerCount = jobSystem.workerCount;
+  uint32_t start = job_random() % workerCount;
+  for(uint32_t i = 0; i < workerCount; i++) {
+    uint32_t victim = (start + i) % workerCount;
+    if(victim == jobWorkerIndex) continue;
+    if(job_deque_steal(&jobSystem.deques[victim], &job)) {
+      job_execute(job);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void job_sleep(void) {
+  pthread_mutex_lock(&jobSystem.sleepLock);
+  atomic_fetch_add(&jobSystem.sleepingWorkers, 1);
+  while(atomic_load(&jobSystem.queuedJobs) <= 0 && atomic_load(&jobSystem.running)) {
+    pthread_cond_wait(&jobSystem.wakeUp, &jobSystem.sleepLock);
+  }
+  atomic_fetch_sub(&jobSystem.sleepingWorkers, 1);
+  pthread_mutex_unlock(&jobSystem.sleepLock);
+}
+
+static void* job_worker_main(void* data) {
+  jobWorkerIndex = (uint32_t)(uintptr_t)data;
+  jobRandomState = jobWorkerIndex * 2654435761u + 1;
+
+  uint32_t idleSpins = 0;
+  while(atomic_load_explicit(&jobSystem.running, memory_order_relaxed)) {
+    if(job_try_run_one()) {
+      idleSpins = 0;
+      continue;
+    }
+    if(++idleSpins < JOB_IDLE_SPINS) {
+      sched_yield();
+      continue;
+    }
+    job_sleep();
+    idleSpins = 0;
+  }
+  free_thread_scratch_arenas();
+  return NULL;
+}
+
+//------------------------------------------
+// API
+//------------------------------------------
+
+// workerCount includes the calling thread, 0 uses one worker per core
+void setup_job_system(uint32_t workerCount) {
+  if(!workerCount) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    workerCount = cores > 0 ? cores : 1;
+  }
+  if(workerCount > JOB_MAX_WORKERS) workerCount = JOB_MAX_WORKERS;
+
+  jobSystem.deques = aligned_alloc(JOB_CACHE_LINE, sizeof(JobDeque) * workerCount);
+  if(!jobSystem.deques) {
+    fprintf(stderr, "Failed to allocate memory");
+    fflush(stderr);
+    abort();
+  }
+  for(uint32_t i = 0; i < workerCount; i++) {
+    atomic_init(&jobSystem.deques[i].top, 0);
+    atomic_init(&jobSystem.deques[i].bottom, 0);
+  }
+  jobSystem.workerCount = workerCount;
+  atomic_init(&jobSystem.queuedJobs, 0);
+  atomic_init(&jobSystem.sleepingWorkers, 0);
+  atomic_init(&jobSystem.running, true);
+  pthread_mutex_init(&jobSystem.sleepLock, NULL);
+  pthread_cond_init(&jobSystem.wakeUp, NULL);
+
+  jobWorkerIndex = 0;
+  jobRandomState = 1;
+  for(uint32_t i = 1; i < workerCount; i++) {
+    if(pthread_create(&jobSystem.threads[i], NULL, job_worker_main, (void*)(uintptr_t)i) != 0) {
+      fprintf(stderr, "Failed to create job worker %u\n", i);
+      fflush(stderr);
+      abort();
+    }
+  }
+}
+
+// Every started job has to be waited on before this is called
+void shutdown_job_system(void) {
+  pthread_mutex_lock(&jobSystem.sleepLock);
+  atomic_store(&jobSystem.running, false);
+  pthread_cond_broadcast(&jobSystem.wakeUp);
+  pthread_mutex_unlock(&jobSystem.sleepLock);
+
+  for(uint32_t i = 1; i < jobSystem.workerCount; i++) pthread_join(jobSystem.threads[i], NULL);
+  pthread_cond_destroy(&jobSystem.wakeUp);
+  pthread_mutex_destroy(&jobSystem.sleepLock);
+  free(jobSystem.deques);
+  jobSystem.deques = NULL;
+  jobSystem.workerCount = 0;
+}
+
+uint32_t job_worker_count(void) { return jobSystem.workerCount; }
+// The index of the calling worker (0 is the thread that called setup_job_system)
+uint32_t job_worker_index(void) { return jobWorkerIndex; }
+
+// Starts count jobs, counter (can be NULL) is incremented by count and reaches 0 again once they have all finished
+void run_jobs(const Job* jobs, size_t count, JobCounter* counter) {
+  if(jobWorkerIndex >= jobSystem.workerCount) {
+    fprintf(stderr, "Jobs can only be started from a job system thread\n");
+    fflush(stderr);
+    abort();
+  }
+  if(counter) atomic_fetch_add_explicit(&counter->value, count, memory_order_relaxed);
+
+  JobDeque* deque = &jobSystem.deques[jobWorkerIndex];
+  for(size_t i = 0; i < count; i++) {
+    QueuedJob job = {jobs[i].function, jobs[i].data, counter};
+    atomic_fetch_add(&jobSystem.queuedJobs, 1);
+    if(!job_deque_push(deque, job)) job_execute(job);
+  }
+
+  //queuedJobs is bumped before sleepingWorkers is read and a worker reads queuedJobs after bumping sleepingWorkers, so a wake up can't be missed
+  uint32_t sleeping = atomic_load(&jobSystem.sleepingWorkers);
+  if(sleeping) {
+    pthread_mutex_lock(&jobSystem.sleepLock);
+    if(count > 1 && sleeping > 1) pthread_cond_broadcast(&jobSystem.wakeUp);
+    else pthread_cond_signal(&jobSystem.wakeUp);
+    pthread_mutex_unlock(&jobSystem.sleepLock);
+  }
+}
+
+void run_job(JobFunction function, void* data, JobCounter* counter) {
+  Job job = {function, data};
+  run_jobs(&job, 1, counter);
+}
+
+bool job_counter_done(JobCounter* counter) { return atomic_load_explicit(&counter->value, memory_order_acquire) <= 0; }
+
+// Runs other jobs until every job started with counter has finished
+void wait_for_counter(JobCounter* counter) {
+  while(!job_counter_done(counter)) {
+    if(!job_try_run_one()) sched_yield();
+  }
+}
+
+// Runs one queued job if there is one, for threads that wait on something other than a counter
+bool run_queued_job(void) { return jobWorkerIndex < jobSystem.workerCount && job_try_run_one(); }
+
+//------------------------------------------
+// Parallel for
+//------------------------------------------
+
+typedef void (*ParallelForFunction)(void* data, size_t begin, size_t end);
+
+typedef struct {
+  ParallelForFunction function;
+  void* data;
+  size_t begin;
+  size_t end;
+} ParallelForBatch;
+
+static void parallel_for_job(void* data) {
+  ParallelForBatch* batch = data;
+  batch->function(batch->data, batch->begin, batch->end);
+}
+
+// Calls function on [0, count) split into ranges of batchSize, returns once all of them are done
+void parallel_for(size_t count, size_t batchSize, ParallelForFunction function, void* data) {
+  if(!count) return;
+  if(!batchSize) batchSize = 1;
+  size_t batchCount = (count + batchSize - 1) / batchSize;
+  if(batchCount == 1) {
+    function(data, 0, count);
+    return;
+  }
+
+  //the batches live until the wait returns, so nested parallel_for calls release their scratch in order
+  ScratchArena scratch = get_thread_scratch_arena(NULL);
+  ParallelForBatch* batches = arena_alloc_array(scratch.allocator, ParallelForBatch, batchCount);
+  Job* jobs = arena_alloc_array(scratch.allocator, Job, batchCount);
+  for(size_t i = 0; i < batchCount; i++) {
+    size_t begin = i * batchSize;
+    size_t end = begin + batchSize < count ? begin + batchSize : count;
+    batches[i] = (ParallelForBatch){function, data, begin, end};
+    jobs[i] = (Job){parallel_for_job, &batches[i]};
+  }
+
+  JobCounter counter = {0};
+  run_jobs(jobs, batchCount, &counter);
+  wait_for_counter(&counter);
+  release_scratch_arena(scratch);
+}
+
+#endif
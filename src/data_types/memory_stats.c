@@ -0,0 +1,139 @@
+#ifndef MEMORY_STATS_HEADER
+#define MEMORY_STATS_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/* Allocation accounting by subsystem, only compiled in when MEMORY_TRACKING is defined.
+ * Code pushes the tag of the subsystem it's working for, arena/pool/dynamic array allocations are charged to that tag.
+ * Arenas can also be given a fixed tag (the thread scratch arenas are always MEMORY_TAG_SCRATCH).
+ * GL buffers and textures are charged to their own tags with the size of the storage they ask the driver for.
+ * Arenas don't free single allocations, bytes are given back when the arena is rewound (clear, scratch release, free)
+ * and they are given back to the tags that were charged for them.
+ * Without MEMORY_TRACKING every macro here expands to nothing and the arguments aren't evaluated
+*/
+typedef enum {
+  MEMORY_TAG_UNTAGGED,
+  MEMORY_TAG_MESH,
+  MEMORY_TAG_MATERIAL,
+  MEMORY_TAG_GLTF,
+  MEMORY_TAG_SHADER,
+  MEMORY_TAG_SCRATCH,
+  MEMORY_TAG_FRAME,
+  MEMORY_TAG_GL_BUFFER,
+  MEMORY_TAG_GL_TEXTURE,
+  MEMORY_TAG_COUNT,
+} MemoryTag;
+
+#ifdef MEMORY_TRACKING
+
+static const char* const memoryTagNames[MEMORY_TAG_COUNT] = {
+  [MEMORY_TAG_UNTAGGED] = "untagged",
+  [MEMORY_TAG_MESH] = "mesh",
+  [MEMORY_TAG_MATERIAL] = "material",
+  [MEMORY_TAG_GLTF] = "gltf",
+  [MEMORY_TAG_SHADER] = "shader",
+  [MEMORY_TAG_SCRATCH] = "scratch",
+  [MEMORY_TAG_FRAME] = "frame",
+  [MEMORY_TAG_GL_BUFFER] = "gl_buffer",
+  [MEMORY_TAG_GL_TEXTURE] = "gl_texture",
+};
+
+#ifndef MEMORY_TAG_STACK_DEPTH
+#define MEMORY_TAG_STACK_DEPTH 16
+#endif //MEMORY_TAG_STACK_DEPTH
+
+typedef struct {
+  _Atomic int64_t current;
+  _Atomic int64_t peak;
+  _Atomic uint64_t count;
+} MemoryTagStats;
+
+static MemoryTagStats memoryStats[MEMORY_TAG_COUNT];
+static _Thread_local MemoryTag memoryTagStack[MEMORY_TAG_STACK_DEPTH];
+static _Thread_local uint8_t memoryTagDepth;
+
+void memory_stats_push_tag(MemoryTag tag) {
+  if(memoryTagDepth == MEMORY_TAG_STACK_DEPTH) {
+    fprintf(stderr, "Memory tag stack overflow\n");
+    fflush(stderr);
+    abort();
+  }
+  memoryTagStack[memoryTagDepth++] = tag;
+}
+
+void memory_stats_pop_tag(void) {
+  if(memoryTagDepth) memoryTagDepth--;
+}
+
+MemoryTag memory_stats_current_tag(void) { return memoryTagDepth ? memoryTagStack[memoryTagDepth-1] : MEMORY_TAG_UNTAGGED; }
+
+void memory_stats_alloc(MemoryTag tag, size_t size) {
+  MemoryTagStats* stats = &memoryStats[tag];
+  int64_t current = atomic_fetch_add_explicit(&stats->current, size, memory_order_relaxed) + size;
+  atomic_fetch_add_explicit(&stats->count, 1, memory_order_relaxed);
+
+  int64_t peak = atomic_load_explicit(&stats->peak, memory_order_relaxed);
+  while(current > peak && !atomic_compare_exchange_weak_explicit(&stats->peak, &peak, current, memory_order_relaxed, memory_order_relaxed));
+}
+
+void memory_stats_free(MemoryTag tag, size_t size) {
+  atomic_fetch_sub_explicit(&memoryStats[tag].current, size, memory_order_relaxed);
+}
+
+// For sub allocators (pools) whose memory was already charged when their block was allocated
+void memory_stats_count(MemoryTag tag) {
+  atomic_fetch_add_explicit(&memoryStats[tag].count, 1, memory_order_relaxed);
+}
+
+void memory_stats_report(FILE* stream) {
+  fprintf(stream, "%-12s %14s %14s %10s\n", "tag", "current", "peak", "count");
+  for(uint8_t i = 0; i < MEMORY_TAG_COUNT; i++) {
+    MemoryTagStats* stats = &memoryStats[i];
+    fprintf(stream, "%-12s %14lld %14lld %10llu\n", memoryTagNames[i],
+      (long long)atomic_load_explicit(&stats->current, memory_order_relaxed),
+      (long long)atomic_load_explicit(&stats->peak, memory_order_relaxed),
+      (unsigned long long)atomic_load_explicit(&stats->count, memory_order_relaxed));
+  }
+  fflush(stream);
+}
+
+void memory_stats_report_json(FILE* stream) {
+  fprintf(stream, "{");
+  for(uint8_t i = 0; i < MEMORY_TAG_COUNT; i++) {
+    MemoryTagStats* stats = &memoryStats[i];
+    fprintf(stream, "%s\"%s\":{\"current\":%lld,\"peak\":%lld,\"count\":%llu}", i ? "," : "", memoryTagNames[i],
+      (long long)atomic_load_explicit(&stats->current, memory_order_relaxed),
+      (long long)atomic_load_explicit(&stats->peak, memory_order_relaxed),
+      (unsigned long long)atomic_load_explicit(&stats->count, memory_order_relaxed));
+  }
+  fprintf(stream, "}\n");
+  fflush(stream);
+}
+
+#define memory_push_tag(tag) memory_stats_push_tag(tag)
+#define memory_pop_tag() memory_stats_pop_tag()
+#define memory_current_tag() memory_stats_current_tag()
+#define memory_track_alloc(tag, size) memory_stats_alloc(tag, size)
+#define memory_track_free(tag, size) memory_stats_free(tag, size)
+#define memory_track_count(tag) memory_stats_count(tag)
+#define memory_report(stream) memory_stats_report(stream)
+#define memory_report_json(stream) memory_stats_report_json(stream)
+
+#else
+
+#define memory_push_tag(tag) ((void)0)
+#define memory_pop_tag() ((void)0)
+#define memory_current_tag() MEMORY_TAG_UNTAGGED
+#define memory_track_alloc(tag, size) ((void)0)
+#define memory_track_free(tag, size) ((void)0)
+#define memory_track_count(tag) ((void)0)
+#define memory_report(stream) ((void)0)
+#define memory_report_json(stream) ((void)0)
+
+#endif //MEMORY_TRACKING
+
+#endif
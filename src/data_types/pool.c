@@ -3,6 +3,15 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <pthread.h>
+
+#include "arena.c"
+#include "memory_stats.c"
 
 #define Pool(type) type##Pool
 #define Node(type) type##Node
@@ -68,7 +77,391 @@
     pool->end = result->prev;\
     result->prev = result;\
     pool->count++;\
+    memory_track_count(memory_current_tag());\
     return &(result->data);\
   }
 
+//------------------------------------------
+// Sparse Pool
+//------------------------------------------
+
+/* A handle is 32 bits, the low 20 bits index the sparse array and the high 12 bits are the generation of that slot.
+ * The generation is bumped every time a slot is removed, so a handle to a removed element no longer matches.
+ * Generation 0 is never used, which makes 0 an invalid handle
+*/
+typedef uint32_t PoolHandle;
+
+#define POOL_HANDLE_INDEX_BITS 20
+#define POOL_HANDLE_GENERATION_BITS 12
+#define POOL_HANDLE_INDEX_MASK ((1u << POOL_HANDLE_INDEX_BITS) - 1)
+#define POOL_HANDLE_GENERATION_MASK ((1u << POOL_HANDLE_GENERATION_BITS) - 1)
+#define POOL_MAX_CAPACITY ((size_t)1 << POOL_HANDLE_INDEX_BITS)
+#define POOL_INVALID_HANDLE ((PoolHandle)0)
+
+#define pool_handle_index(handle) ((handle) & POOL_HANDLE_INDEX_MASK)
+#define pool_handle_generation(handle) ((handle) >> POOL_HANDLE_INDEX_BITS)
+#define make_pool_handle(index, generation) ((PoolHandle)(((generation) << POOL_HANDLE_INDEX_BITS) | (index)))
+
+// For a live slot denseIndex is where its element is in the dense array, for a free slot it is the next free slot
+typedef struct {
+  uint32_t denseIndex;
+  uint32_t generation;
+} PoolSlot;
+
+#define SparsePool(type) type##SparsePool
+
+#define create_sparse_pool(type, arena, capacity) create_##type##SparsePool(arena, capacity)
+#define free_sparse_pool(type, pool) free_##type##SparsePool(pool)
+#define sparse_pool_alloc(type, pool) type##SparsePool_alloc(pool)
+#define sparse_pool_insert(type, pool, value) type##SparsePool_insert(pool, value)
+#define sparse_pool_get(type, pool, handle) type##SparsePool_get(pool, handle)
+#define sparse_pool_contains(type, pool, handle) type##SparsePool_contains(pool, handle)
+#define sparse_pool_remove(type, pool, handle) type##SparsePool_remove(pool, handle)
+#define sparse_pool_clear(type, pool) type##SparsePool_clear(pool)
+
+// The handle of the element at a dense index (the order of the dense array changes on remove)
+#define sparse_pool_handle_at(pool, i) make_pool_handle((pool)->denseToSparse[i], (pool)->sparse[(pool)->denseToSparse[i]].generation)
+
+//Iterates over the live elements only, removing elements while iterating is not allowed
+#define sparse_pool_foreach(type, pool, var, code)\
+  for(size_t i = 0; i < (pool)->count; i++) {\
+    type* var = &((pool)->dense[i]);\
+    code\
+  }
+
+/* Sparse set pool
+ * dense holds the live elements packed at the front so iteration only touches live memory,
+ * sparse maps a handle to the position in dense and denseToSparse maps back so removing can swap the last element in.
+ * When arena is NULL the pool is allocated with malloc and has to be freed with free_sparse_pool
+*/
+#define DEFINE_SPARSE_POOL(type) \
+  typedef struct {\
+    type* dense;\
+    uint32_t* denseToSparse;\
+    PoolSlot* sparse;\
+    size_t count;\
+    size_t capacity;\
+    uint32_t freeHead;\
+    Arena* arena;\
+    /*the tag it was created under, it's freed from the same one*/\
+    MemoryTag memoryTag;\
+  } type##SparsePool;\
+  \
+  void type##SparsePool_clear(type##SparsePool* pool) {\
+    /*bump the generation of every live slot so the handles to them stop matching*/\
+    for(size_t i = 0; i < pool->count; i++) {\
+      PoolSlot* slot = &pool->sparse[pool->denseToSparse[i]];\
+      slot->generation = (slot->generation + 1) & POOL_HANDLE_GENERATION_MASK;\
+      if(!slot->generation) slot->generation = 1;\
+    }\
+    for(size_t i = 0; i < pool->capacity; i++) {\
+      pool->sparse[i].denseIndex = i + 1;\
+      if(!pool->sparse[i].generation) pool->sparse[i].generation = 1;\
+    }\
+    pool->count = 0;\
+    pool->freeHead = 0;\
+  }\
+  \
+  type##SparsePool create_##type##SparsePool(Arena* arena, size_t capacity) {\
+    assert(capacity > 0 && capacity <= POOL_MAX_CAPACITY);\
+    size_t size = capacity*(sizeof(type) + sizeof(uint32_t) + sizeof(PoolSlot));\
+    char* data = arena ? arena_alloc(arena, size) : malloc(size);\
+    if(!data) {\
+      fprintf(stderr, "Failed to allocate memory");\
+      fflush(stderr);\
+      abort();\
+    }\
+    type##SparsePool pool = {0};\
+    pool.memoryTag = memory_current_tag();\
+    if(!arena) memory_track_alloc(pool.memoryTag, size);\
+    pool.dense = (type*)data;\
+    pool.sparse = (PoolSlot*)(data + capacity*sizeof(type));\
+    pool.denseToSparse = (uint32_t*)(data + capacity*(sizeof(type) + sizeof(PoolSlot)));\
+    pool.capacity = capacity;\
+    pool.arena = arena;\
+    for(size_t i = 0; i < capacity; i++) pool.sparse[i].generation = 0;\
+    type##SparsePool_clear(&pool);\
+    return pool;\
+  }\
+  \
+  void free_##type##SparsePool(type##SparsePool* pool) {\
+    if(!pool->arena) {\
+      memory_track_free(pool->memoryTag, pool->capacity*(sizeof(type) + sizeof(uint32_t) + sizeof(PoolSlot)));\
+      free(pool->dense);\
+    }\
+    *pool = (type##SparsePool){0};\
+  }\
+  \
+  bool type##SparsePool_contains(const type##SparsePool* pool, PoolHandle handle) {\
+    uint32_t index = pool_handle_index(handle);\
+    if(index >= pool->capacity) return false;\
+    const PoolSlot* slot = &pool->sparse[index];\
+    return slot->generation == pool_handle_generation(handle) && slot->denseIndex < pool->count && pool->denseToSparse[slot->denseIndex] == index;\
+  }\
+  \
+  type* type##SparsePool_get(type##SparsePool* pool, PoolHandle handle) {\
+    if(!type##SparsePool_contains(pool, handle)) return NULL;\
+    return &pool->dense[pool->sparse[pool_handle_index(handle)].denseIndex];\
+  }\
+  \
+  PoolHandle type##SparsePool_insert(type##SparsePool* pool, type value) {\
+    if(pool->count >= pool->capacity) {\
+      fprintf(stderr, "Pool filled to capacity (%zu)\n", pool->capacity);\
+      fflush(stderr);\
+      return POOL_INVALID_HANDLE;\
+    }\
+    uint32_t index = pool->freeHead;\
+    PoolSlot* slot = &pool->sparse[index];\
+    pool->freeHead = slot->denseIndex;\
+    \
+    slot->denseIndex = pool->count;\
+    pool->denseToSparse[pool->count] = index;\
+    pool->dense[pool->count] = value;\
+    pool->count++;\
+    memory_track_count(pool->memoryTag);\
+    return make_pool_handle(index, slot->generation);\
+  }\
+  \
+  PoolHandle type##SparsePool_alloc(type##SparsePool* pool) { return type##SparsePool_insert(pool, (type){0}); }\
+  \
+  bool type##SparsePool_remove(type##SparsePool* pool, PoolHandle handle) {\
+    if(!type##SparsePool_contains(pool, handle)) return false;\
+    uint32_t index = pool_handle_index(handle);\
+    PoolSlot* slot = &pool->sparse[index];\
+    \
+    /*move the last element into the hole so dense stays packed*/\
+    uint32_t last = pool->count - 1;\
+    if(slot->denseIndex != last) {\
+      uint32_t movedIndex = pool->denseToSparse[last];\
+      pool->dense[slot->denseIndex] = pool->dense[last];\
+      pool->denseToSparse[slot->denseIndex] = movedIndex;\
+      pool->sparse[movedIndex].denseIndex = slot->denseIndex;\
+    }\
+    pool->count--;\
+    \
+    slot->generation = (slot->generation + 1) & POOL_HANDLE_GENERATION_MASK;\
+    if(!slot->generation) slot->generation = 1;\
+    slot->denseIndex = pool->freeHead;\
+    pool->freeHead = index;\
+    return true;\
+  }
+
+//------------------------------------------
+// Concurrent Pool
+//------------------------------------------
+
+/* Threads that can have their own magazine in every concurrent pool at once, a thread gives its slot back when it exits.
+ * Threads started while every slot is taken always go to the shared free list
+*/
+#ifndef CONCURRENT_POOL_MAX_THREADS
+#define CONCURRENT_POOL_MAX_THREADS 128
+#endif //CONCURRENT_POOL_MAX_THREADS
+
+#ifndef CONCURRENT_POOL_MAGAZINE_SIZE
+#define CONCURRENT_POOL_MAGAZINE_SIZE 32
+#endif //CONCURRENT_POOL_MAGAZINE_SIZE
+
+#define CONCURRENT_POOL_END UINT32_MAX
+
+// head keeps a generation in the high 32 bits so a head that was popped and pushed back in between doesn't pass the CAS (ABA)
+#define concurrent_pool_head(generation, index) (((uint64_t)(generation) << 32) | (uint32_t)(index))
+
+#define ConcurrentPool(type) type##ConcurrentPool
+
+#define create_concurrent_pool(type, arena, capacity) create_##type##ConcurrentPool(arena, capacity)
+#define free_concurrent_pool(type, pool) free_##type##ConcurrentPool(pool)
+#define concurrent_pool_alloc(type, pool) type##ConcurrentPool_alloc(pool)
+#define concurrent_pool_free(type, pool, data) type##ConcurrentPool_free(pool, data)
+#define concurrent_pool_free_bulk(type, pool, items, count) type##ConcurrentPool_free_bulk(pool, items, count)
+#define concurrent_pool_flush(type, pool) type##ConcurrentPool_flush(pool)
+
+// A small stack of free indices that only its own thread touches
+typedef struct {
+  alignas(64) uint32_t count;
+  uint32_t items[CONCURRENT_POOL_MAGAZINE_SIZE];
+} PoolMagazine;
+
+//a set bit for every slot owned by a running thread
+static _Atomic uint64_t concurrentPoolSlotsUsed[(CONCURRENT_POOL_MAX_THREADS + 63)/64];
+//the slot + 1, 0 until the thread first uses a concurrent pool
+static _Thread_local uint32_t concurrentPoolThreadSlot;
+static pthread_key_t concurrentPoolSlotKey;
+static pthread_once_t concurrentPoolSlotKeyOnce = PTHREAD_ONCE_INIT;
+
+/*runs when a thread that took a slot exits, the free indices left in its magazines stay there for the next thread that gets the slot*/
+static void concurrent_pool_release_thread_slot(void* data) {
+  uint32_t slot = (uint32_t)(uintptr_t)data - 1;
+  atomic_fetch_and_explicit(&concurrentPoolSlotsUsed[slot/64], ~((uint64_t)1 << (slot%64)), memory_order_release);
+}
+
+static void concurrent_pool_create_slot_key(void) {
+  if(pthread_key_create(&concurrentPoolSlotKey, concurrent_pool_release_thread_slot) != 0) {
+    fprintf(stderr, "Failed to create the concurrent pool thread key\n");
+    fflush(stderr);
+    abort();
+  }
+}
+
+static uint32_t concurrent_pool_acquire_thread_slot(void) {
+  pthread_once(&concurrentPoolSlotKeyOnce, concurrent_pool_create_slot_key);
+  for(uint32_t word = 0; word*64 < CONCURRENT_POOL_MAX_THREADS; word++) {
+    uint64_t used = atomic_load_explicit(&concurrentPoolSlotsUsed[word], memory_order_relaxed);
+    while(~used) {
+      uint32_t slot = word*64 + __builtin_ctzll(~used);
+      if(slot >= CONCURRENT_POOL_MAX_THREADS) break;
+      if(atomic_compare_exchange_weak_explicit(&concurrentPoolSlotsUsed[word], &used, used | ((uint64_t)1 << (slot%64)), memory_order_acquire, memory_order_relaxed)) {
+        pthread_setspecific(concurrentPoolSlotKey, (void*)(uintptr_t)(slot + 1));
+        return slot;
+      }
+    }
+  }
+  return CONCURRENT_POOL_MAX_THREADS;
+}
+
+static inline uint32_t concurrent_pool_thread_slot(void) {
+  if(!concurrentPoolThreadSlot) concurrentPoolThreadSlot = concurrent_pool_acquire_thread_slot() + 1;
+  return concurrentPoolThreadSlot - 1;
+}
+
+/* Pool that can be allocated from and freed to by many threads at once.
+ * The free nodes form a Treiber stack linked by index, the head is an index plus a generation that changes on every
+ * push and pop so it can be swapped with a single 64 bit CAS.
+ * Every thread keeps a magazine of free indices, allocs and frees only go to the shared list to refill or drain half of it.
+ * Indices sitting in other threads' magazines can't be handed out, so give the pool some room over what is live at once
+ * and call concurrent_pool_flush before a thread that used the pool exits, or its indices wait for the next thread that gets its slot.
+ * When arena is NULL the pool is allocated with aligned_alloc and has to be freed with free_concurrent_pool
+*/
+#define DEFINE_CONCURRENT_POOL(type) \
+  typedef struct {\
+    type data;\
+    _Atomic uint32_t next;\
+  } type##ConcurrentNode;\
+  \
+  typedef struct {\
+    alignas(64) _Atomic uint64_t head;\
+    alignas(64) type##ConcurrentNode* nodes;\
+    PoolMagazine* magazines;\
+    size_t capacity;\
+    Arena* arena;\
+    /*the tag it was created under, it's freed from the same one*/\
+    MemoryTag memoryTag;\
+  } type##ConcurrentPool;\
+  \
+  type##ConcurrentPool create_##type##ConcurrentPool(Arena* arena, size_t capacity) {\
+    assert(capacity > 0 && capacity < CONCURRENT_POOL_END);\
+    size_t magazineOffset = align_forward(capacity*sizeof(type##ConcurrentNode), alignof(PoolMagazine));\
+    size_t size = magazineOffset + CONCURRENT_POOL_MAX_THREADS*sizeof(PoolMagazine);\
+    char* data = arena ? arena_alloc_align(arena, size, alignof(PoolMagazine)) : aligned_alloc(alignof(PoolMagazine), size);\
+    if(!data) {\
+      fprintf(stderr, "Failed to allocate memory");\
+      fflush(stderr);\
+      abort();\
+    }\
+    type##ConcurrentPool pool = {0};\
+    pool.memoryTag = memory_current_tag();\
+    if(!arena) memory_track_alloc(pool.memoryTag, size);\
+    pool.nodes = (type##ConcurrentNode*)data;\
+    pool.magazines = (PoolMagazine*)(data + magazineOffset);\
+    pool.capacity = capacity;\
+    pool.arena = arena;\
+    for(size_t i = 0; i < capacity; i++) atomic_init(&pool.nodes[i].next, i + 1 < capacity ? i + 1 : CONCURRENT_POOL_END);\
+    for(size_t i = 0; i < CONCURRENT_POOL_MAX_THREADS; i++) pool.magazines[i].count = 0;\
+    atomic_init(&pool.head, concurrent_pool_head(0, 0));\
+    return pool;\
+  }\
+  \
+  void free_##type##ConcurrentPool(type##ConcurrentPool* pool) {\
+    if(!pool->arena) {\
+      memory_track_free(pool->memoryTag, align_forward(pool->capacity*sizeof(type##ConcurrentNode), alignof(PoolMagazine)) + CONCURRENT_POOL_MAX_THREADS*sizeof(PoolMagazine));\
+      free(pool->nodes);\
+    }\
+    *pool = (type##ConcurrentPool){0};\
+  }\
+  \
+  /*pops up to max nodes off the shared list with one CAS, the chain is only used if the head didn't change while walking it*/\
+  static uint32_t type##ConcurrentPool_pop_chain(type##ConcurrentPool* pool, uint32_t max, uint32_t* indices) {\
+    uint64_t head = atomic_load_explicit(&pool->head, memory_order_acquire);\
+    for(;;) {\
+      uint32_t index = (uint32_t)head;\
+      uint32_t count = 0;\
+      while(index < pool->capacity && count < max) {\
+        indices[count++] = index;\
+        index = atomic_load_explicit(&pool->nodes[index].next, memory_order_relaxed);\
+      }\
+      if(!count) return 0;\
+      uint64_t newHead = concurrent_pool_head((head >> 32) + 1, index);\
+      if(atomic_compare_exchange_weak_explicit(&pool->head, &head, newHead, memory_order_acquire, memory_order_acquire)) return count;\
+    }\
+  }\
+  \
+  /*pushes the chain first..last (already linked through next) onto the shared list with one CAS*/\
+  static void type##ConcurrentPool_push_chain(type##ConcurrentPool* pool, uint32_t first, uint32_t last) {\
+    uint64_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);\
+    uint64_t newHead;\
+    do {\
+      atomic_store_explicit(&pool->nodes[last].next, (uint32_t)head, memory_order_relaxed);\
+      newHead = concurrent_pool_head((head >> 32) + 1, first);\
+    } while(!atomic_compare_exchange_weak_explicit(&pool->head, &head, newHead, memory_order_release, memory_order_relaxed));\
+  }\
+  \
+  static void type##ConcurrentPool_push_indices(type##ConcurrentPool* pool, const uint32_t* indices, size_t count) {\
+    for(size_t i = 0; i + 1 < count; i++) atomic_store_explicit(&pool->nodes[indices[i]].next, indices[i+1], memory_order_relaxed);\
+    type##ConcurrentPool_push_chain(pool, indices[0], indices[count-1]);\
+  }\
+  \
+  type* type##ConcurrentPool_alloc(type##ConcurrentPool* pool) {\
+    uint32_t slot = concurrent_pool_thread_slot();\
+    uint32_t index;\
+    if(slot == CONCURRENT_POOL_MAX_THREADS) {\
+      if(!type##ConcurrentPool_pop_chain(pool, 1, &index)) return NULL;\
+    }\
+    else {\
+      PoolMagazine* magazine = &pool->magazines[slot];\
+      if(!magazine->count) magazine->count = type##ConcurrentPool_pop_chain(pool, CONCURRENT_POOL_MAGAZINE_SIZE/2, magazine->items);\
+      if(!magazine->count) return NULL;\
+      index = magazine->items[--magazine->count];\
+    }\
+    memory_track_count(pool->memoryTag);\
+    return &pool->nodes[index].data;\
+  }\
+  \
+  void type##ConcurrentPool_free(type##ConcurrentPool* pool, type* data) {\
+    uint32_t index = (type##ConcurrentNode*)data - pool->nodes;\
+    assert(index < pool->capacity);\
+    uint32_t slot = concurrent_pool_thread_slot();\
+    if(slot == CONCURRENT_POOL_MAX_THREADS) {\
+      type##ConcurrentPool_push_chain(pool, index, index);\
+      return;\
+    }\
+    PoolMagazine* magazine = &pool->magazines[slot];\
+    if(magazine->count == CONCURRENT_POOL_MAGAZINE_SIZE) {\
+      magazine->count = CONCURRENT_POOL_MAGAZINE_SIZE/2;\
+      type##ConcurrentPool_push_indices(pool, magazine->items + magazine->count, CONCURRENT_POOL_MAGAZINE_SIZE - magazine->count);\
+    }\
+    magazine->items[magazine->count++] = index;\
+  }\
+  \
+  /*frees count elements with a single CAS on the shared list (it skips the magazine)*/\
+  void type##ConcurrentPool_free_bulk(type##ConcurrentPool* pool, type** items, size_t count) {\
+    if(!count) return;\
+    uint32_t first = (type##ConcurrentNode*)items[0] - pool->nodes;\
+    uint32_t last = first;\
+    for(size_t i = 1; i < count; i++) {\
+      uint32_t index = (type##ConcurrentNode*)items[i] - pool->nodes;\
+      assert(index < pool->capacity);\
+      atomic_store_explicit(&pool->nodes[last].next, index, memory_order_relaxed);\
+      last = index;\
+    }\
+    type##ConcurrentPool_push_chain(pool, first, last);\
+  }\
+  \
+  /*gives the calling thread's magazine back to the shared list*/\
+  void type##ConcurrentPool_flush(type##ConcurrentPool* pool) {\
+    uint32_t slot = concurrent_pool_thread_slot();\
+    if(slot == CONCURRENT_POOL_MAX_THREADS) return;\
+    PoolMagazine* magazine = &pool->magazines[slot];\
+    if(magazine->count) type##ConcurrentPool_push_indices(pool, magazine->items, magazine->count);\
+    magazine->count = 0;\
+  }
+
 #endif
@@ -98,6 +98,72 @@ bool string_equals(String a, String b) {
   return a.len == b.len && (!a.len || ((*a.data == *b.data) && !memcmp(a.data, b.data, a.len)));
 }
 
+//------------------------------------------
+// Hashing (wyhash)
+//------------------------------------------
+
+static inline void wyhash_mum(uint64_t* a, uint64_t* b) {
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wyhash_mix(uint64_t a, uint64_t b) {
+  wyhash_mum(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t wyhash_read8(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t wyhash_read4(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t wyhash_read3(const uint8_t* p, size_t k) { return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1]; }
+
+uint64_t wyhash(const void* key, size_t len, uint64_t seed) {
+  static const uint64_t secret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+  const uint8_t* p = key;
+  uint64_t a, b;
+  seed ^= wyhash_mix(seed ^ secret[0], secret[1]);
+
+  if(len <= 16) {
+    if(len >= 4) {
+      a = (wyhash_read4(p) << 32) | wyhash_read4(p + ((len >> 3) << 2));
+      b = (wyhash_read4(p + len - 4) << 32) | wyhash_read4(p + len - 4 - ((len >> 3) << 2));
+    }
+    else if(len > 0) {
+      a = wyhash_read3(p, len);
+      b = 0;
+    }
+    else a = b = 0;
+  }
+  else {
+    size_t i = len;
+    if(i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = wyhash_mix(wyhash_read8(p) ^ secret[1], wyhash_read8(p + 8) ^ seed);
+        see1 = wyhash_mix(wyhash_read8(p + 16) ^ secret[2], wyhash_read8(p + 24) ^ see1);
+        see2 = wyhash_mix(wyhash_read8(p + 32) ^ secret[3], wyhash_read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while(i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while(i > 16) {
+      seed = wyhash_mix(wyhash_read8(p) ^ secret[1], wyhash_read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = wyhash_read8(p + i - 16);
+    b = wyhash_read8(p + i - 8);
+  }
+
+  a ^= secret[1];
+  b ^= seed;
+  wyhash_mum(&a, &b);
+  return wyhash_mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+uint64_t string_hash(String string) { return wyhash(string.data, string.len, 0); }
+
 String string_span(const char* beg, const char* end) {
   String s = {0};
   s.data = beg;
@@ -105,37 +171,202 @@ String string_span(const char* beg, const char* end) {
   return s;
 }
 
-//returns the value in which the string was found return -1 when not found
-int32_t string_find_substring(const String parent, const String child) {
-  if(child.len > parent.len) return -1;
-  for(size_t i = 0; i < parent.len-child.len+1; i++) {
-    if(string_equals(child, string_span(parent.data+i, parent.data+i+child.len))) return i;
+//------------------------------------------
+// Scanning (SIMD)
+//------------------------------------------
+
+/* The scanning functions compare a whole register of bytes at once and turn the result into a bit mask,
+ * the first set bit is the first match. string_simd_mask gives STRING_SIMD_MASK_BITS bits per byte
+ * (NEON has no movemask so every byte becomes a nibble with only its top bit kept).
+ * Define STRING_NO_SIMD to force the scalar versions
+*/
+#if defined(__AVX2__) && !defined(STRING_NO_SIMD)
+#include <immintrin.h>
+#define STRING_SIMD 1
+#define STRING_SIMD_WIDTH 32
+#define STRING_SIMD_MASK_BITS 1
+typedef __m256i StringSimd;
+static inline StringSimd string_simd_load(const char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline StringSimd string_simd_splat(char c) { return _mm256_set1_epi8(c); }
+static inline StringSimd string_simd_eq(StringSimd a, StringSimd b) { return _mm256_cmpeq_epi8(a, b); }
+static inline StringSimd string_simd_or(StringSimd a, StringSimd b) { return _mm256_or_si256(a, b); }
+static inline StringSimd string_simd_and(StringSimd a, StringSimd b) { return _mm256_and_si256(a, b); }
+static inline uint64_t string_simd_mask(StringSimd a) { return (uint32_t)_mm256_movemask_epi8(a); }
+
+#elif defined(__SSE2__) && !defined(STRING_NO_SIMD)
+#include <emmintrin.h>
+#define STRING_SIMD 1
+#define STRING_SIMD_WIDTH 16
+#define STRING_SIMD_MASK_BITS 1
+typedef __m128i StringSimd;
+static inline StringSimd string_simd_load(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline StringSimd string_simd_splat(char c) { return _mm_set1_epi8(c); }
+static inline StringSimd string_simd_eq(StringSimd a, StringSimd b) { return _mm_cmpeq_epi8(a, b); }
+static inline StringSimd string_simd_or(StringSimd a, StringSimd b) { return _mm_or_si128(a, b); }
+static inline StringSimd string_simd_and(StringSimd a, StringSimd b) { return _mm_and_si128(a, b); }
+static inline uint64_t string_simd_mask(StringSimd a) { return (uint16_t)_mm_movemask_epi8(a); }
+
+#elif defined(__ARM_NEON) && !defined(STRING_NO_SIMD)
+#include <arm_neon.h>
+#define STRING_SIMD 1
+#define STRING_SIMD_WIDTH 16
+#define STRING_SIMD_MASK_BITS 4
+typedef uint8x16_t StringSimd;
+static inline StringSimd string_simd_load(const char* p) { return vld1q_u8((const uint8_t*)p); }
+static inline StringSimd string_simd_splat(char c) { return vdupq_n_u8((uint8_t)c); }
+static inline StringSimd string_simd_eq(StringSimd a, StringSimd b) { return vceqq_u8(a, b); }
+static inline StringSimd string_simd_or(StringSimd a, StringSimd b) { return vorrq_u8(a, b); }
+static inline StringSimd string_simd_and(StringSimd a, StringSimd b) { return vandq_u8(a, b); }
+static inline uint64_t string_simd_mask(StringSimd a) {
+  //keep one bit of every nibble so mask & (mask - 1) clears one byte
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(a), 4)), 0) & 0x8888888888888888ull;
+}
+#endif
+
+#ifdef STRING_SIMD
+#define string_simd_first(mask) ((size_t)__builtin_ctzll(mask) / STRING_SIMD_MASK_BITS)
+#define string_simd_last(mask) ((size_t)(63 - __builtin_clzll(mask)) / STRING_SIMD_MASK_BITS)
+#endif
+
+// The set of chars used by string_find_any and the trim functions, one bit per byte value
+typedef struct {
+  uint64_t bits[4];
+} CharSet;
+
+static inline CharSet create_char_set(String chars) {
+  CharSet set = {0};
+  for(size_t i = 0; i < chars.len; i++) {
+    uint8_t c = chars.data[i];
+    set.bits[c >> 6] |= (uint64_t)1 << (c & 63);
   }
-  return -1;
+  return set;
+}
+
+static inline bool char_set_contains(const CharSet* set, char c) { return (set->bits[(uint8_t)c >> 6] >> ((uint8_t)c & 63)) & 1; }
+
+//returns a pointer to the first c in [begin, end) or end when not found
+static inline const char* string_scan_byte(const char* begin, const char* end, char c) {
+  const char* p = begin;
+#ifdef STRING_SIMD
+  StringSimd needle = string_simd_splat(c);
+  for(; end - p >= STRING_SIMD_WIDTH; p += STRING_SIMD_WIDTH) {
+    uint64_t mask = string_simd_mask(string_simd_eq(string_simd_load(p), needle));
+    if(mask) return p + string_simd_first(mask);
+  }
+#endif
+  for(; p < end; p++) {
+    if(*p == c) return p;
+  }
+  return end;
 }
 
+//returns the position of the first c or -1 when not found
 int32_t string_find(String string, const char c) {
-  for(size_t i = 0; i < string.len; i++) {
-    if(string.data[i] == c) return i;
+  const char* end = string.data + string.len;
+  const char* found = string_scan_byte(string.data, end, c);
+  return found == end ? -1 : found - string.data;
+}
+
+int32_t string_find_reverse(String string, const char c) {
+  size_t i = string.len;
+#ifdef STRING_SIMD
+  StringSimd needle = string_simd_splat(c);
+  for(; i >= STRING_SIMD_WIDTH; i -= STRING_SIMD_WIDTH) {
+    uint64_t mask = string_simd_mask(string_simd_eq(string_simd_load(string.data + i - STRING_SIMD_WIDTH), needle));
+    if(mask) return i - STRING_SIMD_WIDTH + string_simd_last(mask);
+  }
+#endif
+  for(; i > 0; i--) {
+    if(string.data[i-1] == c) return i-1;
   }
   return -1;
 }
 
-int32_t string_find_reverse(String string, const char c) {
-  for(size_t i = string.len-1; i >= 0; i--) {
-    if(string.data[i] == c) return i;
+/* returns the position of the first char that is in set or -1 when not found
+ * Sets of up to 4 chars (whitespace, separators ...) are compared in registers, bigger sets use a lookup table
+*/
+int32_t string_find_any(String string, String set) {
+  if(set.len == 1) return string_find(string, set.data[0]);
+  size_t i = 0;
+#ifdef STRING_SIMD
+  if(set.len && set.len <= 4) {
+    StringSimd needles[4];
+    for(size_t j = 0; j < 4; j++) needles[j] = string_simd_splat(set.data[j < set.len ? j : 0]);
+    for(; i + STRING_SIMD_WIDTH <= string.len; i += STRING_SIMD_WIDTH) {
+      StringSimd block = string_simd_load(string.data + i);
+      StringSimd matches = string_simd_or(string_simd_or(string_simd_eq(block, needles[0]), string_simd_eq(block, needles[1])),
+                                          string_simd_or(string_simd_eq(block, needles[2]), string_simd_eq(block, needles[3])));
+      uint64_t mask = string_simd_mask(matches);
+      if(mask) return i + string_simd_first(mask);
+    }
+  }
+#endif
+  CharSet charSet = create_char_set(set);
+  for(; i < string.len; i++) {
+    if(char_set_contains(&charSet, string.data[i])) return i;
   }
   return -1;
 }
+
+/* returns the position of the first child in parent or -1 when not found
+ * Candidates are found by comparing the first and the last char of child at every position in a register,
+ * only positions where both match are checked with memcmp
+*/
+int32_t string_find_substring(const String parent, const String child) {
+  if(child.len > parent.len) return -1;
+  if(child.len == 0) return 0;
+  if(child.len == 1) return string_find(parent, child.data[0]);
+
+  size_t last = parent.len - child.len;
+  size_t i = 0;
+#ifdef STRING_SIMD
+  StringSimd first = string_simd_splat(child.data[0]);
+  StringSimd final = string_simd_splat(child.data[child.len-1]);
+  for(; i + STRING_SIMD_WIDTH <= last + 1; i += STRING_SIMD_WIDTH) {
+    StringSimd blockFirst = string_simd_load(parent.data + i);
+    StringSimd blockLast = string_simd_load(parent.data + i + child.len - 1);
+    uint64_t mask = string_simd_mask(string_simd_and(string_simd_eq(blockFirst, first), string_simd_eq(blockLast, final)));
+    while(mask) {
+      size_t offset = string_simd_first(mask);
+      if(!memcmp(parent.data + i + offset + 1, child.data + 1, child.len - 2)) return i + offset;
+      mask &= mask - 1;
+    }
+  }
+#endif
+  const char* end = parent.data + last + 1;
+  for(const char* p = parent.data + i; (p = string_scan_byte(p, end, child.data[0])) < end; p++) {
+    if(!memcmp(p + 1, child.data + 1, child.len - 1)) return p - parent.data;
+  }
+  return -1;
+}
+
+// For the short sets trim is used with, comparing against every char is cheaper than building a CharSet
+static inline bool string_contains_char(String set, char c) {
+  for(size_t i = 0; i < set.len; i++) {
+    if(set.data[i] == c) return true;
+  }
+  return false;
+}
+
 //Trim the part of the string that contains a char in removals
 String string_trim_left(String string, String removals) {
-  for (; string.len && string_find(removals, *string.data) != -1; string.data++, string.len--);
+  if(removals.len > 8) {
+    CharSet set = create_char_set(removals);
+    for (; string.len && char_set_contains(&set, *string.data); string.data++, string.len--);
+    return string;
+  }
+  for (; string.len && string_contains_char(removals, *string.data); string.data++, string.len--);
   return string;
 }
 
 //Trim the part of the string that contains a char in removals
 String string_trim_right(String string, String removals) {
-  for (; string.len && string_find(removals, string.data[string.len-1]) != -1; string.len--);
+  if(removals.len > 8) {
+    CharSet set = create_char_set(removals);
+    for (; string.len && char_set_contains(&set, string.data[string.len-1]); string.len--);
+    return string;
+  }
+  for (; string.len && string_contains_char(removals, string.data[string.len-1]); string.len--);
   return string;
 }
 
@@ -285,59 +516,347 @@ int64_t string_to_int64(const String string) {
 }
 
 
-static float exp10i(const int32_t exp) {
-    float y = 1.0f;
-    float x = exp<0 ? 0.1f : exp>0 ? 10.0f : 1.0f;
-    int32_t n = exp<0 ? exp : -exp;
-    for (; n < -1; n /= 2) {
-        y *= n%2 ? x : 1.0f;
-        x *= x;
+//------------------------------------------
+// Float parsing
+//------------------------------------------
+
+/* Floats are parsed the way fast_float does it (Eisel-Lemire):
+ * the digits are read into a 64 bit integer w and a power of ten q, then w * 10^q is computed with a 128 bit
+ * multiplication by a truncated power of five, which is enough to round correctly for every input that fits in 19 digits.
+ * Inputs with more digits are checked with w and w+1 and when those round differently strtof decides
+*/
+#define STRING_FLOAT_SMALLEST_POWER_OF_TEN (-65)
+#define STRING_FLOAT_LARGEST_POWER_OF_TEN 38
+#define STRING_FLOAT_MANTISSA_BITS 23
+#define STRING_FLOAT_MINIMUM_EXPONENT (-127)
+#define STRING_FLOAT_INFINITE_POWER 0xFF
+// Tokens up to this long are copied for strtof on the stack, longer ones on the heap
+#define STRING_FLOAT_FALLBACK_STACK 64
+#define STRING_MIN_NINETEEN_DIGIT_INTEGER 1000000000000000000ull
+
+//128 bit 5^q for q in [-65, 38], high bits first (generated with the table_generation.py script from fast_float)
+static const uint64_t stringPowersOfFive[][2] = {
+{0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull}, {0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull},
+  {0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull}, {0x83a3eeeef9153e89ull, 0x1953cf68300424acull},
+  {0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull}, {0xcdb02555653131b6ull, 0x3792f412cb06794dull},
+  {0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull}, {0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull},
+  {0xc8de047564d20a8bull, 0xf245825a5a445275ull}, {0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull},
+  {0x9ced737bb6c4183dull, 0x55464dd69685606bull}, {0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull},
+  {0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull}, {0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull},
+  {0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull}, {0xef73d256a5c0f77cull, 0x963e66858f6d4440ull},
+  {0x95a8637627989aadull, 0xdde7001379a44aa8ull}, {0xbb127c53b17ec159ull, 0x5560c018580d5d52ull},
+  {0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull}, {0x9226712162ab070dull, 0xcab3961304ca70e8ull},
+  {0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull}, {0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull},
+  {0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull}, {0xb267ed1940f1c61cull, 0x55f038b237591ed3ull},
+  {0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull}, {0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull},
+  {0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull}, {0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull},
+  {0x881cea14545c7575ull, 0x7e50d64177da2e54ull}, {0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull},
+  {0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull}, {0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull},
+  {0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull}, {0xcfb11ead453994baull, 0x67de18eda5814af2ull},
+  {0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull}, {0xa2425ff75e14fc31ull, 0xa1258379a94d028dull},
+  {0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull}, {0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull},
+  {0x9e74d1b791e07e48ull, 0x775ea264cf55347eull}, {0xc612062576589ddaull, 0x95364afe032a819eull},
+  {0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull}, {0x9abe14cd44753b52ull, 0xc4926a9672793543ull},
+  {0xc16d9a0095928a27ull, 0x75b7053c0f178294ull}, {0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull},
+  {0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull}, {0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull},
+  {0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull}, {0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull},
+  {0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull}, {0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull},
+  {0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull}, {0xb424dc35095cd80full, 0x538484c19ef38c95ull},
+  {0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull}, {0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull},
+  {0xafebff0bcb24aafeull, 0xf78f69a51539d749ull}, {0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull},
+  {0x89705f4136b4a597ull, 0x31680a88f8953031ull}, {0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull},
+  {0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull}, {0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull},
+  {0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull}, {0xd1b71758e219652bull, 0xd3c36113404ea4a9ull},
+  {0x83126e978d4fdf3bull, 0x645a1cac083126eaull}, {0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull},
+  {0xccccccccccccccccull, 0xcccccccccccccccdull}, {0x8000000000000000ull, 0x0000000000000000ull},
+  {0xa000000000000000ull, 0x0000000000000000ull}, {0xc800000000000000ull, 0x0000000000000000ull},
+  {0xfa00000000000000ull, 0x0000000000000000ull}, {0x9c40000000000000ull, 0x0000000000000000ull},
+  {0xc350000000000000ull, 0x0000000000000000ull}, {0xf424000000000000ull, 0x0000000000000000ull},
+  {0x9896800000000000ull, 0x0000000000000000ull}, {0xbebc200000000000ull, 0x0000000000000000ull},
+  {0xee6b280000000000ull, 0x0000000000000000ull}, {0x9502f90000000000ull, 0x0000000000000000ull},
+  {0xba43b74000000000ull, 0x0000000000000000ull}, {0xe8d4a51000000000ull, 0x0000000000000000ull},
+  {0x9184e72a00000000ull, 0x0000000000000000ull}, {0xb5e620f480000000ull, 0x0000000000000000ull},
+  {0xe35fa931a0000000ull, 0x0000000000000000ull}, {0x8e1bc9bf04000000ull, 0x0000000000000000ull},
+  {0xb1a2bc2ec5000000ull, 0x0000000000000000ull}, {0xde0b6b3a76400000ull, 0x0000000000000000ull},
+  {0x8ac7230489e80000ull, 0x0000000000000000ull}, {0xad78ebc5ac620000ull, 0x0000000000000000ull},
+  {0xd8d726b7177a8000ull, 0x0000000000000000ull}, {0x878678326eac9000ull, 0x0000000000000000ull},
+  {0xa968163f0a57b400ull, 0x0000000000000000ull}, {0xd3c21bcecceda100ull, 0x0000000000000000ull},
+  {0x84595161401484a0ull, 0x0000000000000000ull}, {0xa56fa5b99019a5c8ull, 0x0000000000000000ull},
+  {0xcecb8f27f4200f3aull, 0x0000000000000000ull}, {0x813f3978f8940984ull, 0x4000000000000000ull},
+  {0xa18f07d736b90be5ull, 0x5000000000000000ull}, {0xc9f2c9cd04674edeull, 0xa400000000000000ull},
+  {0xfc6f7c4045812296ull, 0x4d00000000000000ull}, {0x9dc5ada82b70b59dull, 0xf020000000000000ull},
+  {0xc5371912364ce305ull, 0x6c28000000000000ull}, {0xf684df56c3e01bc6ull, 0xc732000000000000ull},
+  {0x9a130b963a6c115cull, 0x3c7f400000000000ull}, {0xc097ce7bc90715b3ull, 0x4b9f100000000000ull},
+  {0xf0bdc21abb48db20ull, 0x1e86d40000000000ull}, {0x96769950b50d88f4ull, 0x1314448000000000ull},
+};
+
+static const float stringExactPowersOfTen[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+typedef struct {
+  uint64_t mantissa;
+  int64_t exponent;
+  const char* end;
+  bool negative;
+  bool tooManyDigits;
+} ParsedDecimal;
+
+static inline bool string_is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+static inline bool string_is_digit(char c) { return (uint8_t)(c - '0') < 10; }
+
+static inline uint64_t string_read8(const char* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+//SWAR check that all 8 bytes are '0'-'9'
+static inline bool string_is_eight_digits(uint64_t v) {
+  return !(((v + 0x4646464646464646ull) | (v - 0x3030303030303030ull)) & 0x8080808080808080ull);
+}
+
+static inline uint32_t string_parse_eight_digits(uint64_t v) {
+  const uint64_t mask = 0x000000FF000000FFull;
+  const uint64_t mul1 = 0x000F424000000064ull; // 100 + (1000000 << 32)
+  const uint64_t mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+  v -= 0x3030303030303030ull;
+  v = (v * 10) + (v >> 8);
+  v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+  return (uint32_t)v;
+}
+#endif
+
+static inline const char* string_parse_digits(const char* p, const char* end, uint64_t* value) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  static const uint64_t powersOfTen[8] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+  while(end - p >= 8) {
+    uint64_t v = string_read8(p);
+    uint64_t nonDigits = ((v + 0x4646464646464646ull) | (v - 0x3030303030303030ull)) & 0x8080808080808080ull;
+    if(!nonDigits) {
+      *value = *value * 100000000 + string_parse_eight_digits(v);
+      p += 8;
+      continue;
+    }
+    //less than 8 digits left, shift them up and pad with '0' so they can be parsed without a loop
+    uint32_t n = __builtin_ctzll(nonDigits) >> 3;
+    if(n) {
+      v = (v << (64 - 8*n)) | (0x3030303030303030ull >> (8*n));
+      *value = *value * powersOfTen[n] + string_parse_eight_digits(v);
+    }
+    return p + n;
+  }
+#endif
+  for(; p < end && string_is_digit(*p); p++) *value = *value * 10 + (uint64_t)(*p - '0');
+  return p;
+}
+
+//Reads [+-]digits[.digits][(e|E)[+-]digits], returns false when there are no digits
+static bool string_parse_decimal(const char* p, const char* end, ParsedDecimal* decimal) {
+  *decimal = (ParsedDecimal){0};
+  if(p < end && (*p == '-' || *p == '+')) {
+    decimal->negative = *p == '-';
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  const char* integerBegin = p;
+  p = string_parse_digits(p, end, &mantissa);
+  const char* integerEnd = p;
+  int64_t digitCount = integerEnd - integerBegin;
+
+  const char* fractionBegin = p;
+  const char* fractionEnd = p;
+  int64_t exponent = 0;
+  if(p < end && *p == '.') {
+    fractionBegin = ++p;
+    p = string_parse_digits(p, end, &mantissa);
+    fractionEnd = p;
+    exponent = fractionBegin - fractionEnd;
+    digitCount -= exponent;
+  }
+  if(digitCount == 0) return false;
+
+  int64_t explicitExponent = 0;
+  if(p < end && (*p == 'e' || *p == 'E')) {
+    const char* exponentBegin = p++;
+    bool negativeExponent = false;
+    if(p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+    if(p < end && string_is_digit(*p)) {
+      //clamp big exponents, anything that big is 0 or infinity anyway
+      for(; p < end && string_is_digit(*p); p++) {
+        if(explicitExponent < 0x10000000) explicitExponent = explicitExponent * 10 + (*p - '0');
+      }
+      if(negativeExponent) explicitExponent = -explicitExponent;
+      exponent += explicitExponent;
+    }
+    else p = exponentBegin; //"1e" is just 1 followed by an e
+  }
+
+  //the mantissa overflowed, keep the first 19 digits and remember that the rest was cut off
+  if(digitCount > 19) {
+    for(const char* s = integerBegin; s < fractionEnd && (*s == '0' || *s == '.'); s++) {
+      if(*s == '0') digitCount--;
+    }
+    if(digitCount > 19) {
+      decimal->tooManyDigits = true;
+      mantissa = 0;
+      const char* s = integerBegin;
+      for(; mantissa < STRING_MIN_NINETEEN_DIGIT_INTEGER && s < integerEnd; s++) mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+      if(mantissa >= STRING_MIN_NINETEEN_DIGIT_INTEGER) {
+        exponent = integerEnd - s + explicitExponent;
+      }
+      else {
+        for(s = fractionBegin; mantissa < STRING_MIN_NINETEEN_DIGIT_INTEGER && s < fractionEnd; s++) mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+        exponent = fractionBegin - s + explicitExponent;
+      }
     }
-    return x * y;
+  }
+
+  decimal->mantissa = mantissa;
+  decimal->exponent = exponent;
+  decimal->end = p;
+  return true;
 }
 
+//Returns the bits of the float closest to w * 10^q (without the sign)
+static uint32_t string_compute_float(int64_t q, uint64_t w) {
+  if(w == 0 || q < STRING_FLOAT_SMALLEST_POWER_OF_TEN) return 0;
+  if(q > STRING_FLOAT_LARGEST_POWER_OF_TEN) return STRING_FLOAT_INFINITE_POWER << STRING_FLOAT_MANTISSA_BITS;
+
+  int leadingZeros = __builtin_clzll(w);
+  w <<= leadingZeros;
+
+  //only the top MANTISSA_BITS + 3 bits of the product matter, the low half of the power is needed when they could carry
+  const uint64_t* power = stringPowersOfFive[q - STRING_FLOAT_SMALLEST_POWER_OF_TEN];
+  __uint128_t product = (__uint128_t)w * power[0];
+  uint64_t precisionMask = UINT64_MAX >> (STRING_FLOAT_MANTISSA_BITS + 3);
+  if(((uint64_t)(product >> 64) & precisionMask) == precisionMask) product += ((__uint128_t)w * power[1]) >> 64;
+  uint64_t productHigh = product >> 64;
+  uint64_t productLow = (uint64_t)product;
+
+  int upperBit = productHigh >> 63;
+  int shift = upperBit + 64 - STRING_FLOAT_MANTISSA_BITS - 3;
+  uint64_t mantissa = productHigh >> shift;
+  int32_t power2 = (int32_t)((((152170 + 65536) * q) >> 16) + 63) + upperBit - leadingZeros - STRING_FLOAT_MINIMUM_EXPONENT;
+
+  //subnormal
+  if(power2 <= 0) {
+    if(-power2 + 1 >= 64) return 0;
+    mantissa >>= -power2 + 1;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    power2 = mantissa < ((uint64_t)1 << STRING_FLOAT_MANTISSA_BITS) ? 0 : 1;
+    return ((uint32_t)power2 << STRING_FLOAT_MANTISSA_BITS) | (uint32_t)(mantissa & (((uint64_t)1 << STRING_FLOAT_MANTISSA_BITS) - 1));
+  }
+
+  //exactly halfway between two floats, round to even (only possible for small q)
+  if(productLow <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1 && (mantissa << shift) == productHigh) mantissa &= ~(uint64_t)1;
+
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+  if(mantissa >= ((uint64_t)2 << STRING_FLOAT_MANTISSA_BITS)) {
+    mantissa = (uint64_t)1 << STRING_FLOAT_MANTISSA_BITS;
+    power2++;
+  }
+  mantissa &= ~((uint64_t)1 << STRING_FLOAT_MANTISSA_BITS);
+  if(power2 >= STRING_FLOAT_INFINITE_POWER) return STRING_FLOAT_INFINITE_POWER << STRING_FLOAT_MANTISSA_BITS;
+  return ((uint32_t)power2 << STRING_FLOAT_MANTISSA_BITS) | (uint32_t)mantissa;
+}
+
+/* strtof on the token at begin, which ends at the next whitespace or comma (or end).
+ * The whole token is copied so every digit counts for the rounding, only the token is copied and not the rest of the input
+*/
+__attribute__((noinline)) static float string_fallback_float(const char* begin, const char* end, const char** parsedEnd) {
+  const char* tokenEnd = begin;
+  for(; tokenEnd < end && !string_is_space(*tokenEnd) && *tokenEnd != ','; tokenEnd++);
+  size_t len = tokenEnd - begin;
+  char stackString[STRING_FLOAT_FALLBACK_STACK + 1];
+  char* cString = len <= STRING_FLOAT_FALLBACK_STACK ? stackString : malloc(len + 1);
+  if(!cString) {
+    fprintf(stderr, "Failed to allocate memory");
+    fflush(stderr);
+    abort();
+  }
+  memcpy(cString, begin, len);
+  cString[len] = '\0';
+  char* cEnd;
+  float value = strtof(cString, &cEnd);
+  *parsedEnd = begin + (cEnd - cString);
+  if(cString != stackString) free(cString);
+  return value;
+}
+
+/* Parses the float at the start of the string (leading whitespace is skipped)
+ * returns how many chars were used or 0 when the string doesn't start with a float
+*/
+size_t string_parse_float(String string, float* value) {
+  const char* begin = string.data;
+  const char* end = string.data + string.len;
+  const char* p = begin;
+  for(; p < end && string_is_space(*p); p++);
+
+  ParsedDecimal decimal;
+  if(!string_parse_decimal(p, end, &decimal)) {
+    //inf, nan and other spellings strtof knows
+    const char* parsedEnd;
+    *value = string_fallback_float(p, end, &parsedEnd);
+    return parsedEnd == p ? 0 : parsedEnd - begin;
+  }
+
+  //Clinger's fast path, both w and 10^q are exact floats so a single multiply or divide rounds correctly
+  if(!decimal.tooManyDigits && decimal.mantissa <= ((uint64_t)1 << 24) && decimal.exponent >= -10 && decimal.exponent <= 10) {
+    float result = (float)decimal.mantissa;
+    result = decimal.exponent < 0 ? result / stringExactPowersOfTen[-decimal.exponent] : result * stringExactPowersOfTen[decimal.exponent];
+    *value = decimal.negative ? -result : result;
+    return decimal.end - begin;
+  }
+
+  uint32_t bits = string_compute_float(decimal.exponent, decimal.mantissa);
+  if(decimal.tooManyDigits && bits != string_compute_float(decimal.exponent, decimal.mantissa + 1)) {
+    const char* parsedEnd;
+    *value = string_fallback_float(p, decimal.end, &parsedEnd);
+    return decimal.end - begin;
+  }
+  bits |= (uint32_t)decimal.negative << 31;
+  memcpy(value, &bits, sizeof(float));
+  return decimal.end - begin;
+}
+
+//The whole string has to be a float, whitespace around it is allowed
 float string_to_float(const String string) {
   float value = 0.0f;
-  float sign = 1.0f;
-  float exp = 0.0f;
-  for(size_t i = 0; i < string.len; i++) {
-    switch(string.data[i]) {
-      case '+': break;
-      case '-': sign = -1; break;
-      case '.': exp = 1; break;
-      case 'E':
-      case 'e': 
-        exp = exp ? exp : 1.0f;
-        exp *= exp10i(string_to_int8(string_span(string.data+i+1, string.data + string.len)));
-        i = string.len;
-        break;
-      case '0':
-      case '1':
-      case '2':
-      case '3':
-      case '4':
-      case '5':
-      case '6':
-      case '7':
-      case '8':
-      case '9':
-        value = 10.0f*value + (float)(string.data[i] - '0');
-        exp *= 0.1f;
-        break;
-      default:
-        #ifdef STRING_ERROR 
-        fprintf(stderr, "An Invalid value was given to be parsed into an int");
-        fflush(stderr);
-        abort();
-        #else
-        return 0;
-        #endif
-        break;
-    }
+  size_t used = string_parse_float(string, &value);
+  const char* p = string.data + used;
+  for(; p < string.data + string.len && string_is_space(*p); p++);
+  if(used && p == string.data + string.len) return value;
+
+  #ifdef STRING_ERROR 
+  fprintf(stderr, "An Invalid value was given to be parsed into a float");
+  fflush(stderr);
+  abort();
+  #else
+  return 0;
+  #endif
+}
+
+/* Parses up to count floats separated by whitespace or commas straight into values
+ * returns how many were parsed, parsing stops at the first thing that isn't a float
+*/
+size_t string_parse_floats(String string, float* values, size_t count) {
+  size_t parsed = 0;
+  while(parsed < count) {
+    for(; string.len && *string.data == ','; string.data++, string.len--);
+    size_t used = string_parse_float(string, &values[parsed]);
+    if(!used) break;
+    parsed++;
+    string.data += used;
+    string.len -= used;
+    for(; string.len && (string_is_space(*string.data) || *string.data == ','); string.data++, string.len--);
   }
-  return sign * value * (exp ? exp : 1.0f);
+  return parsed;
 }
 
+//vec2/vec3 are float arrays so a whole array of them can be parsed at once, n is the number of vectors
+#define string_parse_vec2_array(string, vectors, n) (string_parse_floats(string, (float*)(vectors), 2*(n)) / 2)
+#define string_parse_vec3_array(string, vectors, n) (string_parse_floats(string, (float*)(vectors), 3*(n)) / 3)
+#define string_parse_vec4_array(string, vectors, n) (string_parse_floats(string, (float*)(vectors), 4*(n)) / 4)
+
 typedef struct {
   String head;
   String tail;
@@ -349,10 +868,16 @@ Cut string_cut(String string, const char c) {
   if(string.len == 0) return (Cut){0};
   const char* begin = string.data;
   const char* end = begin + string.len;
-  const char* cutPtr = begin;
-  for(; cutPtr<end && *cutPtr!=c; cutPtr++);
+  const char* cutPtr = string_scan_byte(begin, end, c);
   Cut cut = (Cut){ .found=cutPtr<end, .head=string_span(begin, cutPtr), .tail=string_span(cutPtr+(cutPtr<end), end)};
   return cut;
 }
 
+//Cuts off the first line, the head doesn't include the line ending ("\n" or "\r\n")
+Cut string_cut_line(String string) {
+  Cut cut = string_cut(string, '\n');
+  if(cut.head.len && cut.head.data[cut.head.len-1] == '\r') cut.head.len--;
+  return cut;
+}
+
 #endif
@@ -14,8 +14,23 @@ static mat4 captureProjection;
 
 static GLuint cubeMapVAO;
 
+//uniform names are interned once in setup_environment_map
+static struct {
+  InternedString environmentMap;
+  InternedString projectionMatrix;
+  InternedString viewMatrix;
+  InternedString maxMipMap;
+  InternedString mipMap;
+} captureUniforms;
+
 //Sets up the values and objects used for environment mapping
 void setup_environment_map(void) { 
+  captureUniforms.environmentMap = intern_string_literal("environmentMap");
+  captureUniforms.projectionMatrix = intern_string_literal("projectionMatrix");
+  captureUniforms.viewMatrix = intern_string_literal("viewMatrix");
+  captureUniforms.maxMipMap = intern_string_literal("maxMipMap");
+  captureUniforms.mipMap = intern_string_literal("mipMap");
+
   glGenFramebuffers(1, &captureFbo);
   glGenRenderbuffers(1, &captureRbo);
   //view matrices
@@ -147,16 +162,16 @@ GLuint create_reflection_probe_env_mip_map(uint16_t length, Texture envMap, Mate
 
   glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-  material_set_texture(captureMaterial, create_string_from_literal("environmentMap"), envMap);
-  material_set_mat4(captureMaterial, create_string_from_literal("projectionMatrix"), captureProjection);
+  material_set_texture(captureMaterial, captureUniforms.environmentMap, envMap);
+  material_set_mat4(captureMaterial, captureUniforms.projectionMatrix, captureProjection);
   glUseProgram(captureMaterial->shaderProgram->id);
 
-  if(material_contains_uniform(captureMaterial, create_string_from_literal("maxMipMap"))) {
-    material_set_int(captureMaterial, create_string_from_literal("maxMipMap"), maxMipMap);
+  if(material_contains_uniform(captureMaterial, captureUniforms.maxMipMap)) {
+    material_set_int(captureMaterial, captureUniforms.maxMipMap, maxMipMap);
   }
   for(int mip = 0; mip < maxMipMap; mip++) {
-    if(material_contains_uniform(captureMaterial, create_string_from_literal("mipMap"))) {
-      material_set_int(captureMaterial, create_string_from_literal("mipMap"), mip);
+    if(material_contains_uniform(captureMaterial, captureUniforms.mipMap)) {
+      material_set_int(captureMaterial, captureUniforms.mipMap, mip);
     }
 
     uint16_t mipMapLength = length  >> mip;
@@ -168,7 +183,7 @@ GLuint create_reflection_probe_env_mip_map(uint16_t length, Texture envMap, Mate
     for(unsigned i = 0; i < 6; i++) {
       glBindTexture(GL_TEXTURE_CUBE_MAP, probeMap);
       glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, probeMap, mip);
-      material_set_mat4(captureMaterial, create_string_from_literal("viewMatrix"), captureViews[i]);
+      material_set_mat4(captureMaterial, captureUniforms.viewMatrix, captureViews[i]);
       if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         fprintf(stderr, "Framebuffer incomplete!");
         fflush(stderr);
@@ -208,8 +223,8 @@ GLuint create_reflection_probe_env(uint16_t length, Texture envMap, Material* ca
     glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, length, length, 0, GL_RGB, GL_FLOAT, NULL);
   }
 
-  material_set_texture(captureMaterial, create_string_from_literal("environmentMap"), envMap);
-  material_set_mat4(captureMaterial, create_string_from_literal("projectionMatrix"), captureProjection);
+  material_set_texture(captureMaterial, captureUniforms.environmentMap, envMap);
+  material_set_mat4(captureMaterial, captureUniforms.projectionMatrix, captureProjection);
   glUseProgram(captureMaterial->shaderProgram->id);
   glViewport(0, 0, length, length);
 
@@ -223,7 +238,7 @@ GLuint create_reflection_probe_env(uint16_t length, Texture envMap, Material* ca
       abort();
     }
 
-    material_set_mat4(captureMaterial, create_string_from_literal("viewMatrix"), captureViews[i]);
+    material_set_mat4(captureMaterial, captureUniforms.viewMatrix, captureViews[i]);
     material_push_uniform_values(captureMaterial);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -0,0 +1,74 @@
+#ifndef FRAME_ALLOCATOR_IMPL
+#define FRAME_ALLOCATOR_IMPL
+
+#include <glad/glad.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "data_types/arena.c"
+
+// How many frames can be in flight before the cpu has to wait on the gpu
+#ifndef FRAME_ARENA_COUNT
+#define FRAME_ARENA_COUNT 3
+#endif //FRAME_ARENA_COUNT
+
+/* Transient memory for everything that only lives for one frame (draw lists, sort keys, culling results ...)
+ * Every frame gets its own arena, the arenas are used in rotation and reset when they come back around.
+ * A fence is placed at the end of each frame so an arena is only reset once the gpu is done with that frame
+*/
+typedef struct {
+  Arena arenas[FRAME_ARENA_COUNT];
+  GLsync fences[FRAME_ARENA_COUNT];
+  uint8_t current;
+  uint64_t frameIndex;
+} FrameAllocator;
+
+FrameAllocator create_frame_allocator(size_t reservePerFrame) {
+  FrameAllocator frameAllocator = {0};
+  for(uint8_t i = 0; i < FRAME_ARENA_COUNT; i++) {
+    frameAllocator.arenas[i] = create_virtual_arena(reservePerFrame);
+    arena_set_memory_tag(&frameAllocator.arenas[i], MEMORY_TAG_FRAME);
+  }
+  return frameAllocator;
+}
+
+//Waits until the gpu has finished the frame that last used the arena, then resets it
+void frame_allocator_begin_frame(FrameAllocator* frameAllocator) {
+  uint8_t current = frameAllocator->frameIndex % FRAME_ARENA_COUNT;
+  GLsync fence = frameAllocator->fences[current];
+
+  if(fence) {
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while(result == GL_TIMEOUT_EXPIRED) {
+      result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+    if(result == GL_WAIT_FAILED) {
+      fprintf(stderr, "Failed to wait on the frame fence\n");
+      fflush(stderr);
+    }
+    glDeleteSync(fence);
+    frameAllocator->fences[current] = 0;
+  }
+
+  frameAllocator->current = current;
+  arena_clear(&frameAllocator->arenas[current]);
+}
+
+void frame_allocator_end_frame(FrameAllocator* frameAllocator) {
+  frameAllocator->fences[frameAllocator->current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frameAllocator->frameIndex++;
+}
+
+Arena* frame_arena(FrameAllocator* frameAllocator) { return &frameAllocator->arenas[frameAllocator->current]; }
+
+void free_frame_allocator(FrameAllocator* frameAllocator) {
+  for(uint8_t i = 0; i < FRAME_ARENA_COUNT; i++) {
+    if(frameAllocator->fences[i]) glDeleteSync(frameAllocator->fences[i]);
+    free_arena(&frameAllocator->arenas[i]);
+  }
+}
+
+#define frame_alloc(frameAllocator, n) arena_alloc(frame_arena(frameAllocator), n)
+#define frame_alloc_array(frameAllocator, type, n) arena_alloc_array(frame_arena(frameAllocator), type, n)
+
+#endif
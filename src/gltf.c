@@ -0,0 +1,983 @@
+// glTF 2.0 json parsing, nothing in here touches GL so it can run on any thread
+#ifndef GLTF_IMPL
+#define GLTF_IMPL
+
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "data_types/arena.c"
+#include "data_types/array.c"
+#include "data_types/string.c"
+
+/* The json is read in a single pass and every object the engine uses is written straight into a typed table in the arena.
+ * Objects reference each other by index (accessor -> bufferView -> buffer, primitive -> material -> texture -> image),
+ * the tables keep those indices so resolving a reference is an array lookup instead of a walk through the json.
+ * Properties the engine has no use for (names, extensions, extras, animations, skins, ...) are skipped without being stored.
+ * Every reference is checked once the file is parsed, an index in the tables is either -1 (not there) or valid
+*/
+
+// same values as the GL enums
+typedef enum {
+  GLTF_COMPONENT_BYTE = 5120,
+  GLTF_COMPONENT_UNSIGNED_BYTE = 5121,
+  GLTF_COMPONENT_SHORT = 5122,
+  GLTF_COMPONENT_UNSIGNED_SHORT = 5123,
+  GLTF_COMPONENT_UNSIGNED_INT = 5125,
+  GLTF_COMPONENT_FLOAT = 5126,
+} GLTFComponentType;
+
+typedef enum {
+  GLTF_ATTRIBUTE_POSITION,
+  GLTF_ATTRIBUTE_NORMAL,
+  GLTF_ATTRIBUTE_TANGENT,
+  GLTF_ATTRIBUTE_TEXCOORD_0,
+  GLTF_ATTRIBUTE_TEXCOORD_1,
+  GLTF_ATTRIBUTE_COLOR_0,
+  GLTF_ATTRIBUTE_JOINTS_0,
+  GLTF_ATTRIBUTE_WEIGHTS_0,
+  GLTF_ATTRIBUTE_COUNT,
+} GLTFAttributeType;
+
+#define GLTF_NAME(name) {name, sizeof(name)-1}
+static const String gltfAttributeNames[GLTF_ATTRIBUTE_COUNT] = {
+  [GLTF_ATTRIBUTE_POSITION] = GLTF_NAME("POSITION"),
+  [GLTF_ATTRIBUTE_NORMAL] = GLTF_NAME("NORMAL"),
+  [GLTF_ATTRIBUTE_TANGENT] = GLTF_NAME("TANGENT"),
+  [GLTF_ATTRIBUTE_TEXCOORD_0] = GLTF_NAME("TEXCOORD_0"),
+  [GLTF_ATTRIBUTE_TEXCOORD_1] = GLTF_NAME("TEXCOORD_1"),
+  [GLTF_ATTRIBUTE_COLOR_0] = GLTF_NAME("COLOR_0"),
+  [GLTF_ATTRIBUTE_JOINTS_0] = GLTF_NAME("JOINTS_0"),
+  [GLTF_ATTRIBUTE_WEIGHTS_0] = GLTF_NAME("WEIGHTS_0"),
+};
+#undef GLTF_NAME
+
+typedef struct {
+  String uri;
+  size_t byteLength;
+} GLTFBuffer;
+
+typedef struct {
+  int32_t buffer;
+  uint32_t byteStride; // 0 when the elements are tightly packed
+  size_t byteOffset;
+  size_t byteLength;
+} GLTFBufferView;
+
+typedef struct {
+  int32_t bufferView; // -1 means every element is zero
+  uint32_t componentType;
+  size_t byteOffset;
+  size_t count;
+  uint8_t componentCount; // SCALAR 1, VEC2 2, VEC3 3, VEC4/MAT2 4, MAT3 9, MAT4 16
+  bool normalized;
+  // only the first 4 components of min and max are kept (enough for positions)
+  bool hasBounds;
+  float min[4];
+  float max[4];
+} GLTFAccessor;
+
+typedef struct {
+  String uri;
+  String mimeType;
+  int32_t bufferView;
+} GLTFImage;
+
+typedef struct {
+  int32_t magFilter;
+  int32_t minFilter;
+  int32_t wrapS;
+  int32_t wrapT;
+} GLTFSampler;
+
+typedef struct {
+  int32_t source;
+  int32_t sampler;
+} GLTFTexture;
+
+typedef struct {
+  int32_t index; // texture index, -1 when the material doesn't have the texture
+  uint32_t texCoord;
+  float scale; // normalTexture scale or occlusionTexture strength
+} GLTFTextureInfo;
+
+typedef enum {
+  GLTF_ALPHA_OPAQUE,
+  GLTF_ALPHA_MASK,
+  GLTF_ALPHA_BLEND,
+} GLTFAlphaMode;
+
+typedef struct {
+  float baseColorFactor[4];
+  float metallicFactor;
+  float roughnessFactor;
+  float emissiveFactor[3];
+  GLTFTextureInfo baseColorTexture;
+  GLTFTextureInfo metallicRoughnessTexture;
+  GLTFTextureInfo normalTexture;
+  GLTFTextureInfo occlusionTexture;
+  GLTFTextureInfo emissiveTexture;
+  GLTFAlphaMode alphaMode;
+  float alphaCutoff;
+  bool doubleSided;
+} GLTFMaterial;
+
+typedef struct {
+  int32_t attributes[GLTF_ATTRIBUTE_COUNT]; // accessor indices
+  int32_t indices;
+  int32_t material;
+  uint32_t mode;
+} GLTFPrimitive;
+
+typedef struct {
+  uint32_t firstPrimitive;
+  uint32_t primitiveCount;
+} GLTFMesh;
+
+// children of nodes and root nodes of scenes are ranges of GLTF.nodeIndices
+typedef uint32_t GLTFNodeIndex;
+
+typedef struct {
+  int32_t mesh;
+  uint32_t firstChild;
+  uint32_t childCount;
+  // either the matrix or translation, rotation and scale is used
+  bool hasMatrix;
+  float matrix[16];
+  float translation[3];
+  float rotation[4];
+  float scale[3];
+} GLTFNode;
+
+typedef struct {
+  uint32_t firstNode;
+  uint32_t nodeCount;
+} GLTFScene;
+
+DEFINE_ARRAY(GLTFBuffer)
+DEFINE_ARRAY(GLTFBufferView)
+DEFINE_ARRAY(GLTFAccessor)
+DEFINE_ARRAY(GLTFImage)
+DEFINE_ARRAY(GLTFSampler)
+DEFINE_ARRAY(GLTFTexture)
+DEFINE_ARRAY(GLTFMaterial)
+DEFINE_ARRAY(GLTFPrimitive)
+DEFINE_ARRAY(GLTFMesh)
+DEFINE_ARRAY(GLTFNodeIndex)
+DEFINE_ARRAY(GLTFNode)
+DEFINE_ARRAY(GLTFScene)
+
+DEFINE_DYNAMIC_ARRAY(GLTFBuffer)
+DEFINE_DYNAMIC_ARRAY(GLTFBufferView)
+DEFINE_DYNAMIC_ARRAY(GLTFAccessor)
+DEFINE_DYNAMIC_ARRAY(GLTFImage)
+DEFINE_DYNAMIC_ARRAY(GLTFSampler)
+DEFINE_DYNAMIC_ARRAY(GLTFTexture)
+DEFINE_DYNAMIC_ARRAY(GLTFMaterial)
+DEFINE_DYNAMIC_ARRAY(GLTFPrimitive)
+DEFINE_DYNAMIC_ARRAY(GLTFMesh)
+DEFINE_DYNAMIC_ARRAY(GLTFNodeIndex)
+DEFINE_DYNAMIC_ARRAY(GLTFNode)
+DEFINE_DYNAMIC_ARRAY(GLTFScene)
+
+typedef struct {
+  Array(GLTFBuffer) buffers;
+  Array(GLTFBufferView) bufferViews;
+  Array(GLTFAccessor) accessors;
+  Array(GLTFImage) images;
+  Array(GLTFSampler) samplers;
+  Array(GLTFTexture) textures;
+  Array(GLTFMaterial) materials;
+  Array(GLTFPrimitive) primitives;
+  Array(GLTFMesh) meshes;
+  Array(GLTFNodeIndex) nodeIndices;
+  Array(GLTFNode) nodes;
+  Array(GLTFScene) scenes;
+  int32_t scene;
+} GLTF;
+
+//------------------------------------------
+// Json reading
+//------------------------------------------
+
+typedef struct {
+  const char* begin;
+  const char* p;
+  const char* end;
+  Arena* arena;
+  const char* error;
+  size_t errorOffset;
+} GLTFParser;
+
+#define gltf_key(key, literal) string_equals(key, create_string_from_literal(literal))
+
+// Only the first error is kept, the parser jumps to the end of the input so every read after it fails straight away
+static void gltf_fail(GLTFParser* parser, const char* error) {
+  if(!parser->error) {
+    parser->error = error;
+    parser->errorOffset = parser->p - parser->begin;
+  }
+  parser->p = parser->end;
+}
+
+// Skips whitespace and returns the next char without consuming it, 0 at the end of the input
+static inline char gltf_peek(GLTFParser* parser) {
+  const char* p = parser->p;
+  while(p < parser->end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+  parser->p = p;
+  return p < parser->end ? *p : 0;
+}
+
+static inline bool gltf_consume(GLTFParser* parser, char c) {
+  if(gltf_peek(parser) != c) {
+    gltf_fail(parser, "unexpected character");
+    return false;
+  }
+  parser->p++;
+  return true;
+}
+
+// The contents of a string without the quotes, escapes are left as they are
+static String gltf_parse_raw_string(GLTFParser* parser, bool* escaped) {
+  *escaped = false;
+  if(!gltf_consume(parser, '"')) return (String){0};
+  const char* begin = parser->p;
+  const char* p = begin;
+  for(;;) {
+    p = string_scan_byte(p, parser->end, '"');
+    if(p == parser->end) {
+      gltf_fail(parser, "unterminated string");
+      return (String){0};
+    }
+    //the quote is escaped when there is an odd number of backslashes before it
+    const char* slash = p;
+    while(slash > begin && slash[-1] == '\\') slash--;
+    if((p - slash) % 2 == 0) break;
+    p++;
+  }
+  *escaped = string_scan_byte(begin, p, '\\') != p;
+  parser->p = p + 1;
+  return string_span(begin, p);
+}
+
+static uint32_t gltf_parse_hex4(const char* p) {
+  uint32_t value = 0;
+  for(int i = 0; i < 4; i++) {
+    char c = p[i];
+    uint32_t digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+    if(digit == 16) return UINT32_MAX;
+    value = value << 4 | digit;
+  }
+  return value;
+}
+
+// Copies the string into the arena with the escapes resolved (the json source doesn't outlive the parse)
+static String gltf_parse_string(GLTFParser* parser) {
+  bool escaped;
+  String raw = gltf_parse_raw_string(parser, &escaped);
+  if(!raw.len) return (String){0};
+  char* data = arena_alloc(parser->arena, raw.len);
+  if(!escaped) {
+    memcpy(data, raw.data, raw.len);
+    return (String){data, raw.len};
+  }
+
+  //escapes only ever make the string shorter
+  size_t len = 0;
+  for(size_t i = 0; i < raw.len; i++) {
+    char c = raw.data[i];
+    if(c != '\\') {
+      data[len++] = c;
+      continue;
+    }
+    if(++i == raw.len) break;
+    switch(raw.data[i]) {
+      case 'b': data[len++] = '\b'; break;
+      case 'f': data[len++] = '\f'; break;
+      case 'n': data[len++] = '\n'; break;
+      case 'r': data[len++] = '\r'; break;
+      case 't': data[len++] = '\t'; break;
+      case 'u': {
+        uint32_t codePoint = i + 4 < raw.len ? gltf_parse_hex4(raw.data + i + 1) : UINT32_MAX;
+        if(codePoint == UINT32_MAX) {
+          gltf_fail(parser, "invalid \\u escape");
+          return (String){0};
+        }
+        i += 4;
+        //surrogate pair
+        if(codePoint >= 0xD800 && codePoint < 0xDC00 && i + 6 < raw.len && raw.data[i+1] == '\\' && raw.data[i+2] == 'u') {
+          uint32_t low = gltf_parse_hex4(raw.data + i + 3);
+          if(low >= 0xDC00 && low < 0xE000) {
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+            i += 6;
+          }
+        }
+        if(codePoint < 0x80) data[len++] = codePoint;
+        else if(codePoint < 0x800) {
+          data[len++] = 0xC0 | codePoint >> 6;
+          data[len++] = 0x80 | (codePoint & 0x3F);
+        }
+        else if(codePoint < 0x10000) {
+          data[len++] = 0xE0 | codePoint >> 12;
+          data[len++] = 0x80 | (codePoint >> 6 & 0x3F);
+          data[len++] = 0x80 | (codePoint & 0x3F);
+        }
+        else {
+          data[len++] = 0xF0 | codePoint >> 18;
+          data[len++] = 0x80 | (codePoint >> 12 & 0x3F);
+          data[len++] = 0x80 | (codePoint >> 6 & 0x3F);
+          data[len++] = 0x80 | (codePoint & 0x3F);
+        }
+      }
+        break;
+      default: data[len++] = raw.data[i]; break;
+    }
+  }
+  return (String){data, len};
+}
+
+static inline bool gltf_is_number_char(char c) { return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; }
+
+// The chars of the number at the parser, empty (and a failed parse) when there isn't one
+static String gltf_number_span(GLTFParser* parser) {
+  gltf_peek(parser);
+  const char* begin = parser->p;
+  const char* p = begin;
+  while(p < parser->end && gltf_is_number_char(*p)) p++;
+  if(p == begin) gltf_fail(parser, "expected a number");
+  return string_span(begin, p);
+}
+
+static float gltf_parse_float(GLTFParser* parser) {
+  String number = gltf_number_span(parser);
+  float value = 0.0f;
+  if(!number.len) return value;
+  if(string_parse_float(number, &value) != number.len) gltf_fail(parser, "invalid number");
+  else parser->p += number.len;
+  return value;
+}
+
+// Integers written with a fraction or exponent (1.0, 1e3) are accepted too
+static int64_t gltf_parse_integer(GLTFParser* parser) {
+  String number = gltf_number_span(parser);
+  if(!number.len) return 0;
+  const char* p = number.data;
+  const char* end = p + number.len;
+  bool negative = *p == '-';
+  p += negative;
+  int64_t value = 0;
+  for(; p < end && *p >= '0' && *p <= '9'; p++) {
+    if(value > (INT64_MAX - 9) / 10) {
+      gltf_fail(parser, "number is too large");
+      return 0;
+    }
+    value = value * 10 + (*p - '0');
+  }
+  if(p != end) {
+    float floatValue;
+    if(string_parse_float(number, &floatValue) != number.len) {
+      gltf_fail(parser, "invalid number");
+      return 0;
+    }
+    //the cast is undefined for values an int64_t can't hold (1e30, inf, nan)
+    if(!isfinite(floatValue) || floatValue < -9223372036854775808.0f || floatValue >= 9223372036854775808.0f) {
+      gltf_fail(parser, "number is too large");
+      return 0;
+    }
+    parser->p = end;
+    return (int64_t)floatValue;
+  }
+  parser->p = end;
+  return negative ? -value : value;
+}
+
+// For indices and sizes, which can't be negative
+static int64_t gltf_parse_unsigned(GLTFParser* parser, int64_t max) {
+  int64_t value = gltf_parse_integer(parser);
+  if(value < 0 || value > max) {
+    gltf_fail(parser, "value out of range");
+    return 0;
+  }
+  return value;
+}
+
+#define gltf_parse_index(parser) ((int32_t)gltf_parse_unsigned(parser, INT32_MAX))
+#define gltf_parse_size(parser) ((size_t)gltf_parse_unsigned(parser, INT64_MAX))
+
+static bool gltf_parse_bool(GLTFParser* parser) {
+  gltf_peek(parser);
+  size_t left = parser->end - parser->p;
+  if(left >= 4 && memcmp(parser->p, "true", 4) == 0) {
+    parser->p += 4;
+    return true;
+  }
+  if(left >= 5 && memcmp(parser->p, "false", 5) == 0) {
+    parser->p += 5;
+    return false;
+  }
+  gltf_fail(parser, "expected true or false");
+  return false;
+}
+
+/* Iterates over the keys of an object, call with index 0 at the '{' and count up
+ * returns false once the '}' is consumed, otherwise the parser is left at the value of key
+*/
+static bool gltf_object_next(GLTFParser* parser, size_t index, String* key) {
+  if(index == 0 && !gltf_consume(parser, '{')) return false;
+  char c = gltf_peek(parser);
+  if(c == '}') {
+    parser->p++;
+    return false;
+  }
+  if(index != 0 && !gltf_consume(parser, ',')) return false;
+  bool escaped;
+  *key = gltf_parse_raw_string(parser, &escaped);
+  return gltf_consume(parser, ':');
+}
+
+// Same as gltf_object_next for the elements of an array
+static bool gltf_array_next(GLTFParser* parser, size_t index) {
+  if(index == 0 && !gltf_consume(parser, '[')) return false;
+  char c = gltf_peek(parser);
+  if(c == ']') {
+    parser->p++;
+    return false;
+  }
+  return index == 0 || gltf_consume(parser, ',');
+}
+
+// Skips any value, skipped values are only checked for balanced brackets
+static void gltf_skip_value(GLTFParser* parser) {
+  size_t depth = 0;
+  do {
+    bool escaped;
+    char c = gltf_peek(parser);
+    switch(c) {
+      case '{':
+      case '[':
+        depth++;
+        parser->p++;
+        break;
+      case '}':
+      case ']':
+      case ',':
+      case ':':
+        if(depth == 0) {
+          gltf_fail(parser, "expected a value");
+          return;
+        }
+        if(c == '}' || c == ']') depth--;
+        parser->p++;
+        break;
+      case '"':
+        gltf_parse_raw_string(parser, &escaped);
+        break;
+      case 0:
+        gltf_fail(parser, "unexpected end of file");
+        return;
+      default: {
+        //numbers, true, false and null
+        const char* p = parser->p;
+        while(p < parser->end && ((*p >= 'a' && *p <= 'z') || gltf_is_number_char(*p))) p++;
+        if(p == parser->p) {
+          gltf_fail(parser, "unexpected character");
+          return;
+        }
+        parser->p = p;
+      }
+        break;
+    }
+  } while(depth && !parser->error);
+}
+
+// Reads up to count floats of an array, extra elements are skipped, returns how many were read
+static size_t gltf_parse_floats(GLTFParser* parser, float* values, size_t count) {
+  size_t i = 0;
+  for(; gltf_array_next(parser, i); i++) {
+    if(i < count) values[i] = gltf_parse_float(parser);
+    else gltf_skip_value(parser);
+  }
+  return i < count ? i : count;
+}
+
+//------------------------------------------
+// glTF objects
+//------------------------------------------
+
+typedef struct {
+  DynamicArray(GLTFBuffer) buffers;
+  DynamicArray(GLTFBufferView) bufferViews;
+  DynamicArray(GLTFAccessor) accessors;
+  DynamicArray(GLTFImage) images;
+  DynamicArray(GLTFSampler) samplers;
+  DynamicArray(GLTFTexture) textures;
+  DynamicArray(GLTFMaterial) materials;
+  DynamicArray(GLTFPrimitive) primitives;
+  DynamicArray(GLTFMesh) meshes;
+  DynamicArray(GLTFNodeIndex) nodeIndices;
+  DynamicArray(GLTFNode) nodes;
+  DynamicArray(GLTFScene) scenes;
+} GLTFTables;
+
+static void gltf_parse_buffer(GLTFParser* parser, GLTFTables* tables) {
+  GLTFBuffer buffer = {0};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "uri")) buffer.uri = gltf_parse_string(parser);
+    else if(gltf_key(key, "byteLength")) buffer.byteLength = gltf_parse_size(parser);
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFBuffer, &tables->buffers, &buffer);
+}
+
+static void gltf_parse_buffer_view(GLTFParser* parser, GLTFTables* tables) {
+  GLTFBufferView bufferView = {.buffer=-1};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "buffer")) bufferView.buffer = gltf_parse_index(parser);
+    else if(gltf_key(key, "byteOffset")) bufferView.byteOffset = gltf_parse_size(parser);
+    else if(gltf_key(key, "byteLength")) bufferView.byteLength = gltf_parse_size(parser);
+    else if(gltf_key(key, "byteStride")) bufferView.byteStride = gltf_parse_unsigned(parser, 252);
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFBufferView, &tables->bufferViews, &bufferView);
+}
+
+static uint8_t gltf_component_count(String type) {
+  if(gltf_key(type, "SCALAR")) return 1;
+  if(gltf_key(type, "VEC2")) return 2;
+  if(gltf_key(type, "VEC3")) return 3;
+  if(gltf_key(type, "VEC4")) return 4;
+  if(gltf_key(type, "MAT2")) return 4;
+  if(gltf_key(type, "MAT3")) return 9;
+  if(gltf_key(type, "MAT4")) return 16;
+  return 0;
+}
+
+static void gltf_parse_accessor(GLTFParser* parser, GLTFTables* tables) {
+  GLTFAccessor accessor = {.bufferView=-1};
+  String key;
+  bool escaped;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "bufferView")) accessor.bufferView = gltf_parse_index(parser);
+    else if(gltf_key(key, "byteOffset")) accessor.byteOffset = gltf_parse_size(parser);
+    else if(gltf_key(key, "componentType")) accessor.componentType = gltf_parse_unsigned(parser, UINT32_MAX);
+    else if(gltf_key(key, "count")) accessor.count = gltf_parse_size(parser);
+    else if(gltf_key(key, "type")) accessor.componentCount = gltf_component_count(gltf_parse_raw_string(parser, &escaped));
+    else if(gltf_key(key, "normalized")) accessor.normalized = gltf_parse_bool(parser);
+    else if(gltf_key(key, "min")) accessor.hasBounds |= gltf_parse_floats(parser, accessor.min, 4) != 0;
+    else if(gltf_key(key, "max")) accessor.hasBounds |= gltf_parse_floats(parser, accessor.max, 4) != 0;
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFAccessor, &tables->accessors, &accessor);
+}
+
+static void gltf_parse_image(GLTFParser* parser, GLTFTables* tables) {
+  GLTFImage image = {.bufferView=-1};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "uri")) image.uri = gltf_parse_string(parser);
+    else if(gltf_key(key, "mimeType")) image.mimeType = gltf_parse_string(parser);
+    else if(gltf_key(key, "bufferView")) image.bufferView = gltf_parse_index(parser);
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFImage, &tables->images, &image);
+}
+
+static void gltf_parse_sampler(GLTFParser* parser, GLTFTables* tables) {
+  //wrap defaults to GL_REPEAT, the filters are left up to the loader
+  GLTFSampler sampler = {.magFilter=-1, .minFilter=-1, .wrapS=10497, .wrapT=10497};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "magFilter")) sampler.magFilter = gltf_parse_index(parser);
+    else if(gltf_key(key, "minFilter")) sampler.minFilter = gltf_parse_index(parser);
+    else if(gltf_key(key, "wrapS")) sampler.wrapS = gltf_parse_index(parser);
+    else if(gltf_key(key, "wrapT")) sampler.wrapT = gltf_parse_index(parser);
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFSampler, &tables->samplers, &sampler);
+}
+
+static void gltf_parse_texture(GLTFParser* parser, GLTFTables* tables) {
+  GLTFTexture texture = {.source=-1, .sampler=-1};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "source")) texture.source = gltf_parse_index(parser);
+    else if(gltf_key(key, "sampler")) texture.sampler = gltf_parse_index(parser);
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFTexture, &tables->textures, &texture);
+}
+
+static GLTFTextureInfo gltf_parse_texture_info(GLTFParser* parser) {
+  GLTFTextureInfo textureInfo = {.index=-1, .scale=1.0f};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "index")) textureInfo.index = gltf_parse_index(parser);
+    else if(gltf_key(key, "texCoord")) textureInfo.texCoord = gltf_parse_index(parser);
+    else if(gltf_key(key, "scale") || gltf_key(key, "strength")) textureInfo.scale = gltf_parse_float(parser);
+    else gltf_skip_value(parser);
+  }
+  return textureInfo;
+}
+
+static void gltf_parse_material(GLTFParser* parser, GLTFTables* tables) {
+  GLTFTextureInfo noTexture = {.index=-1, .scale=1.0f};
+  GLTFMaterial material = {
+    .baseColorFactor={1.0f, 1.0f, 1.0f, 1.0f},
+    .metallicFactor=1.0f,
+    .roughnessFactor=1.0f,
+    .baseColorTexture=noTexture,
+    .metallicRoughnessTexture=noTexture,
+    .normalTexture=noTexture,
+    .occlusionTexture=noTexture,
+    .emissiveTexture=noTexture,
+    .alphaCutoff=0.5f,
+  };
+  String key;
+  bool escaped;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "pbrMetallicRoughness")) {
+      String pbrKey;
+      for(size_t j = 0; gltf_object_next(parser, j, &pbrKey); j++) {
+        if(gltf_key(pbrKey, "baseColorFactor")) gltf_parse_floats(parser, material.baseColorFactor, 4);
+        else if(gltf_key(pbrKey, "metallicFactor")) material.metallicFactor = gltf_parse_float(parser);
+        else if(gltf_key(pbrKey, "roughnessFactor")) material.roughnessFactor = gltf_parse_float(parser);
+        else if(gltf_key(pbrKey, "baseColorTexture")) material.baseColorTexture = gltf_parse_texture_info(parser);
+        else if(gltf_key(pbrKey, "metallicRoughnessTexture")) material.metallicRoughnessTexture = gltf_parse_texture_info(parser);
+        else gltf_skip_value(parser);
+      }
+    }
+    else if(gltf_key(key, "normalTexture")) material.normalTexture = gltf_parse_texture_info(parser);
+    else if(gltf_key(key, "occlusionTexture")) material.occlusionTexture = gltf_parse_texture_info(parser);
+    else if(gltf_key(key, "emissiveTexture")) material.emissiveTexture = gltf_parse_texture_info(parser);
+    else if(gltf_key(key, "emissiveFactor")) gltf_parse_floats(parser, material.emissiveFactor, 3);
+    else if(gltf_key(key, "alphaCutoff")) material.alphaCutoff = gltf_parse_float(parser);
+    else if(gltf_key(key, "doubleSided")) material.doubleSided = gltf_parse_bool(parser);
+    else if(gltf_key(key, "alphaMode")) {
+      String mode = gltf_parse_raw_string(parser, &escaped);
+      if(gltf_key(mode, "MASK")) material.alphaMode = GLTF_ALPHA_MASK;
+      else if(gltf_key(mode, "BLEND")) material.alphaMode = GLTF_ALPHA_BLEND;
+    }
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFMaterial, &tables->materials, &material);
+}
+
+static void gltf_parse_primitive(GLTFParser* parser, GLTFTables* tables) {
+  //mode 4 is triangles
+  GLTFPrimitive primitive = {.indices=-1, .material=-1, .mode=4};
+  for(uint8_t i = 0; i < GLTF_ATTRIBUTE_COUNT; i++) primitive.attributes[i] = -1;
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "attributes")) {
+      String attributeKey;
+      for(size_t j = 0; gltf_object_next(parser, j, &attributeKey); j++) {
+        uint8_t attribute = 0;
+        for(; attribute < GLTF_ATTRIBUTE_COUNT && !string_equals(attributeKey, gltfAttributeNames[attribute]); attribute++);
+        if(attribute < GLTF_ATTRIBUTE_COUNT) primitive.attributes[attribute] = gltf_parse_index(parser);
+        else gltf_skip_value(parser);
+      }
+    }
+    else if(gltf_key(key, "indices")) primitive.indices = gltf_parse_index(parser);
+    else if(gltf_key(key, "material")) primitive.material = gltf_parse_index(parser);
+    else if(gltf_key(key, "mode")) primitive.mode = gltf_parse_unsigned(parser, 6);
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFPrimitive, &tables->primitives, &primitive);
+}
+
+static void gltf_parse_mesh(GLTFParser* parser, GLTFTables* tables) {
+  GLTFMesh mesh = {.firstPrimitive=tables->primitives.length};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "primitives")) {
+      for(size_t j = 0; gltf_array_next(parser, j); j++) gltf_parse_primitive(parser, tables);
+    }
+    else gltf_skip_value(parser);
+  }
+  mesh.primitiveCount = tables->primitives.length - mesh.firstPrimitive;
+  dynamic_array_append(GLTFMesh, &tables->meshes, &mesh);
+}
+
+// Appends the node indices of an array to nodeIndices, returns how many there were
+static uint32_t gltf_parse_node_indices(GLTFParser* parser, GLTFTables* tables) {
+  uint32_t count = 0;
+  for(size_t i = 0; gltf_array_next(parser, i); i++, count++) {
+    GLTFNodeIndex index = gltf_parse_index(parser);
+    dynamic_array_append(GLTFNodeIndex, &tables->nodeIndices, &index);
+  }
+  return count;
+}
+
+static void gltf_parse_node(GLTFParser* parser, GLTFTables* tables) {
+  GLTFNode node = {
+    .mesh=-1,
+    .matrix={1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1},
+    .rotation={0.0f, 0.0f, 0.0f, 1.0f},
+    .scale={1.0f, 1.0f, 1.0f},
+  };
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "mesh")) node.mesh = gltf_parse_index(parser);
+    else if(gltf_key(key, "children")) {
+      //children is a flat list of indices so its range in nodeIndices is contiguous
+      node.firstChild = tables->nodeIndices.length;
+      node.childCount = gltf_parse_node_indices(parser, tables);
+    }
+    else if(gltf_key(key, "matrix")) node.hasMatrix = gltf_parse_floats(parser, node.matrix, 16) == 16;
+    else if(gltf_key(key, "translation")) gltf_parse_floats(parser, node.translation, 3);
+    else if(gltf_key(key, "rotation")) gltf_parse_floats(parser, node.rotation, 4);
+    else if(gltf_key(key, "scale")) gltf_parse_floats(parser, node.scale, 3);
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFNode, &tables->nodes, &node);
+}
+
+static void gltf_parse_scene(GLTFParser* parser, GLTFTables* tables) {
+  GLTFScene scene = {0};
+  String key;
+  for(size_t i = 0; gltf_object_next(parser, i, &key); i++) {
+    if(gltf_key(key, "nodes")) {
+      scene.firstNode = tables->nodeIndices.length;
+      scene.nodeCount = gltf_parse_node_indices(parser, tables);
+    }
+    else gltf_skip_value(parser);
+  }
+  dynamic_array_append(GLTFScene, &tables->scenes, &scene);
+}
+
+//------------------------------------------
+// Validation
+//------------------------------------------
+
+static inline bool gltf_index_valid(int32_t index, size_t length) { return index >= 0 && (size_t)index < length; }
+static inline bool gltf_optional_index_valid(int32_t index, size_t length) { return index == -1 || gltf_index_valid(index, length); }
+
+static size_t gltf_component_size(uint32_t componentType) {
+  switch(componentType) {
+    case GLTF_COMPONENT_BYTE:
+    case GLTF_COMPONENT_UNSIGNED_BYTE:
+      return 1;
+    case GLTF_COMPONENT_SHORT:
+    case GLTF_COMPONENT_UNSIGNED_SHORT:
+      return 2;
+    case GLTF_COMPONENT_UNSIGNED_INT:
+    case GLTF_COMPONENT_FLOAT:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+// Size of one element of an accessor (without the padding of a stride)
+size_t gltf_accessor_element_size(const GLTFAccessor* accessor) { return gltf_component_size(accessor->componentType) * accessor->componentCount; }
+
+// Distance between elements of an accessor in its buffer view
+size_t gltf_accessor_stride(const GLTF* gltf, const GLTFAccessor* accessor) {
+  const GLTFBufferView* bufferView = array_index(GLTFBufferView, &gltf->bufferViews, accessor->bufferView);
+  return bufferView->byteStride ? bufferView->byteStride : gltf_accessor_element_size(accessor);
+}
+
+static bool gltf_texture_info_valid(const GLTFTextureInfo* textureInfo, size_t textureCount) { return gltf_optional_index_valid(textureInfo->index, textureCount); }
+
+// Returns what is wrong with the tables or NULL, after this every index and byte range in them can be used without checks
+static const char* gltf_validate(const GLTF* gltf) {
+  for(size_t i = 0; i < gltf->bufferViews.length; i++) {
+    const GLTFBufferView* bufferView = &gltf->bufferViews.data[i];
+    if(!gltf_index_valid(bufferView->buffer, gltf->buffers.length)) return "bufferView.buffer is out of range";
+    size_t bufferLength = gltf->buffers.data[bufferView->buffer].byteLength;
+    if(bufferView->byteOffset > bufferLength || bufferView->byteLength > bufferLength - bufferView->byteOffset) return "bufferView is outside of its buffer";
+  }
+  for(size_t i = 0; i < gltf->accessors.length; i++) {
+    const GLTFAccessor* accessor = &gltf->accessors.data[i];
+    size_t elementSize = gltf_accessor_element_size(accessor);
+    if(!elementSize) return "accessor has an invalid componentType or type";
+    if(!gltf_optional_index_valid(accessor->bufferView, gltf->bufferViews.length)) return "accessor.bufferView is out of range";
+    if(accessor->bufferView == -1 || accessor->count == 0) continue;
+    size_t viewLength = gltf->bufferViews.data[accessor->bufferView].byteLength;
+    size_t available = accessor->byteOffset <= viewLength ? viewLength - accessor->byteOffset : 0;
+    if(elementSize > available || accessor->count - 1 > (available - elementSize) / gltf_accessor_stride(gltf, accessor)) return "accessor is outside of its bufferView";
+  }
+  for(size_t i = 0; i < gltf->images.length; i++) {
+    if(!gltf_optional_index_valid(gltf->images.data[i].bufferView, gltf->bufferViews.length)) return "image.bufferView is out of range";
+  }
+  for(size_t i = 0; i < gltf->textures.length; i++) {
+    const GLTFTexture* texture = &gltf->textures.data[i];
+    if(!gltf_optional_index_valid(texture->source, gltf->images.length)) return "texture.source is out of range";
+    if(!gltf_optional_index_valid(texture->sampler, gltf->samplers.length)) return "texture.sampler is out of range";
+  }
+  for(size_t i = 0; i < gltf->materials.length; i++) {
+    const GLTFMaterial* material = &gltf->materials.data[i];
+    size_t textureCount = gltf->textures.length;
+    if(!gltf_texture_info_valid(&material->baseColorTexture, textureCount) || !gltf_texture_info_valid(&material->metallicRoughnessTexture, textureCount) ||
+      !gltf_texture_info_valid(&material->normalTexture, textureCount) || !gltf_texture_info_valid(&material->occlusionTexture, textureCount) ||
+      !gltf_texture_info_valid(&material->emissiveTexture, textureCount)) return "material texture index is out of range";
+  }
+  for(size_t i = 0; i < gltf->primitives.length; i++) {
+    const GLTFPrimitive* primitive = &gltf->primitives.data[i];
+    for(uint8_t j = 0; j < GLTF_ATTRIBUTE_COUNT; j++) {
+      if(!gltf_optional_index_valid(primitive->attributes[j], gltf->accessors.length)) return "primitive attribute is out of range";
+    }
+    if(!gltf_optional_index_valid(primitive->indices, gltf->accessors.length)) return "primitive.indices is out of range";
+    if(!gltf_optional_index_valid(primitive->material, gltf->materials.length)) return "primitive.material is out of range";
+  }
+  for(size_t i = 0; i < gltf->nodeIndices.length; i++) {
+    if(gltf->nodeIndices.data[i] >= gltf->nodes.length) return "node index is out of range";
+  }
+  for(size_t i = 0; i < gltf->nodes.length; i++) {
+    if(!gltf_optional_index_valid(gltf->nodes.data[i].mesh, gltf->meshes.length)) return "node.mesh is out of range";
+  }
+  if(!gltf_optional_index_valid(gltf->scene, gltf->scenes.length)) return "scene is out of range";
+  return NULL;
+}
+
+//------------------------------------------
+// Parsing
+//------------------------------------------
+
+typedef void (*GLTFElementParser)(GLTFParser* parser, GLTFTables* tables);
+
+// The parser for the elements of a top level array
+static GLTFElementParser gltf_element_parser(String key) {
+  if(gltf_key(key, "buffers")) return gltf_parse_buffer;
+  if(gltf_key(key, "bufferViews")) return gltf_parse_buffer_view;
+  if(gltf_key(key, "accessors")) return gltf_parse_accessor;
+  if(gltf_key(key, "images")) return gltf_parse_image;
+  if(gltf_key(key, "samplers")) return gltf_parse_sampler;
+  if(gltf_key(key, "textures")) return gltf_parse_texture;
+  if(gltf_key(key, "materials")) return gltf_parse_material;
+  if(gltf_key(key, "meshes")) return gltf_parse_mesh;
+  if(gltf_key(key, "nodes")) return gltf_parse_node;
+  if(gltf_key(key, "scenes")) return gltf_parse_scene;
+  return NULL;
+}
+
+#define gltf_table_array(type, dynamicArray) create_array(type, (dynamicArray).data, (dynamicArray).length)
+
+/* Parses the json of a .gltf into the tables of result, everything is allocated in the arena.
+ * returns false and leaves the arena as it was when the json is invalid or references something that isn't there
+*/
+bool parse_gltf(Arena* arena, String json, GLTF* result) {
+  ScratchArena mark = create_scratch_arena(arena);
+  GLTFParser parser = {.begin=json.data, .p=json.data, .end=json.data + json.len, .arena=arena};
+  GLTFTables tables = {
+    create_arena_dynamic_array(GLTFBuffer, arena, 4),
+    create_arena_dynamic_array(GLTFBufferView, arena, 16),
+    create_arena_dynamic_array(GLTFAccessor, arena, 16),
+    create_arena_dynamic_array(GLTFImage, arena, 16),
+    create_arena_dynamic_array(GLTFSampler, arena, 4),
+    create_arena_dynamic_array(GLTFTexture, arena, 16),
+    create_arena_dynamic_array(GLTFMaterial, arena, 16),
+    create_arena_dynamic_array(GLTFPrimitive, arena, 16),
+    create_arena_dynamic_array(GLTFMesh, arena, 16),
+    create_arena_dynamic_array(GLTFNodeIndex, arena, 16),
+    create_arena_dynamic_array(GLTFNode, arena, 16),
+    create_arena_dynamic_array(GLTFScene, arena, 1),
+  };
+  int32_t scene = -1;
+
+  String key;
+  for(size_t i = 0; gltf_object_next(&parser, i, &key); i++) {
+    GLTFElementParser parse_element = gltf_element_parser(key);
+    if(parse_element) {
+      for(size_t j = 0; gltf_array_next(&parser, j); j++) parse_element(&parser, &tables);
+    }
+    else if(gltf_key(key, "scene")) scene = gltf_parse_index(&parser);
+    else gltf_skip_value(&parser);
+  }
+  if(!parser.error && gltf_peek(&parser) != 0) gltf_fail(&parser, "unexpected data after the json");
+
+  GLTF gltf = {
+    gltf_table_array(GLTFBuffer, tables.buffers),
+    gltf_table_array(GLTFBufferView, tables.bufferViews),
+    gltf_table_array(GLTFAccessor, tables.accessors),
+    gltf_table_array(GLTFImage, tables.images),
+    gltf_table_array(GLTFSampler, tables.samplers),
+    gltf_table_array(GLTFTexture, tables.textures),
+    gltf_table_array(GLTFMaterial, tables.materials),
+    gltf_table_array(GLTFPrimitive, tables.primitives),
+    gltf_table_array(GLTFMesh, tables.meshes),
+    gltf_table_array(GLTFNodeIndex, tables.nodeIndices),
+    gltf_table_array(GLTFNode, tables.nodes),
+    gltf_table_array(GLTFScene, tables.scenes),
+    scene,
+  };
+  const char* error = parser.error;
+  if(!error) error = gltf_validate(&gltf);
+  if(error) {
+    fprintf(stderr, "Invalid glTF: %s (byte %zu)\n", error, parser.error ? parser.errorOffset : json.len);
+    fflush(stderr);
+    release_scratch_arena(mark);
+    *result = (GLTF){.scene=-1};
+    return false;
+  }
+  *result = gltf;
+  return true;
+}
+
+//------------------------------------------
+// GLB
+//------------------------------------------
+
+/* A .glb is a 12 byte header (magic, version, length) followed by chunks, each one is a length, a type and the data.
+ * The first chunk is the json and the optional second one holds the binary buffer,
+ * the first buffer of the json without a uri refers to it
+*/
+#define GLB_MAGIC 0x46546C67 // "glTF"
+#define GLB_CHUNK_JSON 0x4E4F534A
+#define GLB_CHUNK_BIN 0x004E4942
+
+typedef struct {
+  String json;
+  String bin; // empty when the file doesn't have a binary chunk
+} GLBChunks;
+
+static uint32_t glb_read_u32(const char* data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+bool is_glb(String data) { return data.len >= 4 && glb_read_u32(data.data) == GLB_MAGIC; }
+
+// Finds the chunks of a .glb, they point into data. Returns false when data isn't a valid glb
+bool read_glb_chunks(String data, GLBChunks* chunks) {
+  *chunks = (GLBChunks){0};
+  if(data.len < 12 || glb_read_u32(data.data) != GLB_MAGIC) return false;
+  if(glb_read_u32(data.data + 4) != 2) {
+    fprintf(stderr, "Only version 2 glb files are supported\n");
+    fflush(stderr);
+    return false;
+  }
+  size_t length = glb_read_u32(data.data + 8);
+  if(length > data.len) {
+    fprintf(stderr, "The glb is smaller than its length\n");
+    fflush(stderr);
+    return false;
+  }
+
+  size_t offset = 12;
+  for(uint32_t i = 0; length - offset >= 8; i++) {
+    size_t chunkLength = glb_read_u32(data.data + offset);
+    uint32_t chunkType = glb_read_u32(data.data + offset + 4);
+    offset += 8;
+    if(chunkLength > length - offset) break;
+    String chunk = {data.data + offset, chunkLength};
+    offset += chunkLength;
+
+    //unknown chunks are skipped
+    if(i == 0 && chunkType == GLB_CHUNK_JSON) chunks->json = chunk;
+    else if(i == 1 && chunkType == GLB_CHUNK_BIN) chunks->bin = chunk;
+  }
+  if(!chunks->json.len) {
+    fprintf(stderr, "The glb doesn't start with a json chunk\n");
+    fflush(stderr);
+    return false;
+  }
+  return true;
+}
+
+#endif
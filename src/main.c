@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "data_types/arena.c"
+#include "data_types/jobs.c"
 #include "pbr.c"
 #include "data_types/array.c"
 #include "data_types/string.c"
@@ -23,6 +24,8 @@
 #include "render.c"
 #include "mesh.c"
 #include "post_process.c"
+#include "frame_allocator.c"
+#include "resource.c"
 
 GLFWwindow* window;
 static int windowWidth, windowHeight;
@@ -141,10 +144,12 @@ int main(void) {
 
   init_window(1000, 800);
 
-  char* data = malloc(1<<27);
-  Arena arena = create_arena(data, 1<<27);
+  //only the pages that are actually used get committed
+  Arena arena = create_virtual_arena((size_t)1<<34);
 
   //setup
+  //the main thread is worker 0, so it can start and wait on jobs
+  setup_job_system(0);
   setup_environment_map();
   setup_render(&arena);
   setup_material(&arena);
@@ -177,7 +182,7 @@ int main(void) {
   }
   
   //scene descriptions
-  ShaderProgram skyboxShader = create_shader_program();
+  ShaderProgram skyboxShader = create_shader_program(&arena);
   attach_shader_to_program(&arena, &skyboxShader, GL_VERTEX_SHADER, create_string_from_literal("res/shader/skyboxVertex.glsl"));
   attach_shader_to_program(&arena, &skyboxShader, GL_FRAGMENT_SHADER, create_string_from_literal("res/shader/skyboxFragment.glsl"));
   finalize_shader_program(&skyboxShader);
@@ -188,7 +193,7 @@ int main(void) {
   //Texture test = create_texture("res/skybox/right.jpg");
 
   setup_pbr(&arena, environmentMap);
-  material_set_texture(&skyBoxMaterial, create_string_from_literal("environmentMap"), environmentMap);
+  material_set_texture(&skyBoxMaterial, intern_string_literal("environmentMap"), environmentMap);
 
   Mesh* meshArrayData = arena_alloc_array(&arena, Mesh, 64);
   Array(Mesh) meshes =  create_array(Mesh, meshArrayData, 64);
@@ -215,18 +220,20 @@ int main(void) {
   Scene scene = (Scene){meshes, camera, skyBoxMaterial};
   
   // Post process
-  ShaderProgram bloomShaderProgram = create_shader_program();
+  ShaderProgram bloomShaderProgram = create_shader_program(&arena);
   attach_shader_to_program(&arena, &bloomShaderProgram, GL_COMPUTE_SHADER, create_string_from_literal("res/shader/bloom.glsl"));
   finalize_shader_program(&bloomShaderProgram);
   Material bloomMaterial = create_material(&arena, &bloomShaderProgram);
 
-  DynamicArray(Material) postProcessList = create_dynamic_array(Material, 1);
-  dynamic_array_append(Material, &postProcessList, &bloomMaterial);
+  SmallArray(Material) postProcessList = create_small_array(Material, &arena);
+  small_array_append(Material, &postProcessList, &bloomMaterial);
 
   /* renders */
+  FrameAllocator frameAllocator = create_frame_allocator((size_t)1<<30);
 
   double previousTime = 0;
   while (!glfwWindowShouldClose(window)) {
+    frame_allocator_begin_frame(&frameAllocator);
     double currentTime = glfwGetTime();
     float dt = (float)(currentTime - previousTime);
     previousTime = currentTime;
@@ -234,15 +241,19 @@ int main(void) {
     input(window, &(scene.camera), dt);
 
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    render_scene(&scene, windowWidth, windowHeight);
+    render_scene(&frameAllocator, &scene, windowWidth, windowHeight);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     Texture outputTexture = post_process(&postProcessList, frameTexture, windowWidth, windowHeight);
     render_texture(outputTexture);
     
+    frame_allocator_end_frame(&frameAllocator);
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
   
+  memory_report(stderr);
+  free_frame_allocator(&frameAllocator);
+  shutdown_job_system();
   glfwTerminate();
   free_arena(&arena);
 
@@ -8,28 +8,28 @@
 #include "scene_define.c"
 #include "shader_type.c"
 #include "opengl_utils.c"
+#include "texture_cache.c"
 
 Texture whiteTexture;
 
 void setup_material(Arena* arena) {
-  whiteTexture = create_texture("res/white.png");
+  whiteTexture = acquire_texture_literal("res/white.png");
 }
 
 Material create_material(Arena* arena, const ShaderProgram* shaderProgram) {
-  size_t uniformCapacity = 2*shaderProgram->uniforms.length;
-  KeyValue(String, UniformValue)* uniformData = arena_alloc_array(arena, KeyValue(String, UniformValue), uniformCapacity);
-  HashTable(String, UniformValue) uniformProperties = create_hash_table(String, UniformValue, uniformData, uniformCapacity);
+  memory_push_tag(MEMORY_TAG_MATERIAL);
+  size_t uniformCapacity = shaderProgram->uniforms.length;
+  HashTable(InternedString, UniformValue) uniformProperties = create_hash_table(InternedString, UniformValue, arena, uniformCapacity);
   
-  size_t samplerCapacity = 2*shaderProgram->uniforms.length;
-  KeyValue(String, SamplerValue)* samplerData = arena_alloc_array(arena, KeyValue(String, SamplerValue), samplerCapacity);
-  HashTable(String, SamplerValue) samplerProperties = create_hash_table(String, SamplerValue, samplerData, samplerCapacity);
+  size_t samplerCapacity = shaderProgram->uniforms.length;
+  HashTable(InternedString, SamplerValue) samplerProperties = create_hash_table(InternedString, SamplerValue, arena, samplerCapacity);
   
   Sampler sampler = 0;
   SamplerValue samplerValue;
 
   for(size_t i = 0; i < shaderProgram->uniforms.length; i++) {
     Uniform* uniform = dynamic_array_index(Uniform, &shaderProgram->uniforms, i);
-    String name = uniform->name;
+    InternedString name = uniform->name;
     switch(uniform->type) {
       case UNIFORM_TYPE_BOOL:
       case UNIFORM_TYPE_INT:
@@ -48,32 +48,47 @@ Material create_material(Arena* arena, const ShaderProgram* shaderProgram) {
       case UNIFORM_TYPE_UVEC2:
       case UNIFORM_TYPE_UVEC3:
       case UNIFORM_TYPE_UVEC4:
-        hash_table_set(String, UniformValue, &uniformProperties, name, (UniformValue){0});
+        hash_table_set(InternedString, UniformValue, &uniformProperties, name, (UniformValue){0});
         break;
       case UNIFORM_TYPE_SAMPLER1D:
       case UNIFORM_TYPE_SAMPLER2D:
       case UNIFORM_TYPE_SAMPLER3D:
       case UNIFORM_TYPE_SAMPLERCUBE:
       case UNIFORM_TYPE_IMAGE2D:
-        //populate the samplerTable
+        //populate the samplerTable, the material holds a reference to every texture it samples
         samplerValue = (SamplerValue){whiteTexture, sampler++};
-        hash_table_set(String, SamplerValue, &samplerProperties, name, samplerValue);
+        retain_texture(whiteTexture);
+        hash_table_set(InternedString, SamplerValue, &samplerProperties, name, samplerValue);
         break;
       }
   }
+  memory_pop_tag();
   return (Material){shaderProgram, uniformProperties, samplerProperties};
 }
 
 void material_push_uniform_values(const Material* material) {
   for(size_t i = 0; i < material->shaderProgram->uniforms.length; i++) {
     Uniform* uniform = dynamic_array_index(Uniform, &material->shaderProgram->uniforms, i);
-    String name = uniform->name;
+    InternedString name = uniform->name;
     int location = uniform->location;
 
     if(location == -1) continue;
 
-    UniformValue uniformValue = hash_table_get(String, UniformValue, &material->uniformProperties, name, (UniformValue){0});
-    SamplerValue samplerValue = hash_table_get(String, SamplerValue, &material->samplerProperties, name, (SamplerValue){0});
+    //only the table that can hold the uniform gets searched
+    UniformValue uniformValue = {0};
+    SamplerValue samplerValue = {0};
+    switch(uniform->type) {
+      case UNIFORM_TYPE_SAMPLER1D:
+      case UNIFORM_TYPE_SAMPLER2D:
+      case UNIFORM_TYPE_SAMPLER3D:
+      case UNIFORM_TYPE_SAMPLERCUBE:
+      case UNIFORM_TYPE_IMAGE2D:
+        samplerValue = hash_table_get(InternedString, SamplerValue, &material->samplerProperties, name, (SamplerValue){0});
+        break;
+      default:
+        uniformValue = hash_table_get(InternedString, UniformValue, &material->uniformProperties, name, (UniformValue){0});
+        break;
+    }
 
     switch(uniform->type) {
       case UNIFORM_TYPE_BOOL:
@@ -142,55 +157,80 @@ void material_push_uniform_values(const Material* material) {
   }
 }
 
-bool material_contains_uniform(Material* material, String uniformName) {
-  return hash_table_index(String, UniformValue, &material->uniformProperties, uniformName);
+bool material_contains_uniform(Material* material, InternedString uniformName) {
+  return hash_table_contains(InternedString, UniformValue, &material->uniformProperties, uniformName);
 }
 
-void material_set_mat4(Material* material, String uniformName, mat4 mat4Value) {
-  if(!hash_table_contains(String, UniformValue, &material->uniformProperties, uniformName)) {
-    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.len, uniformName.data);
+void material_set_mat4(Material* material, InternedString uniformName, mat4 mat4Value) {
+  UniformValue* uniformValue = hash_table_index(InternedString, UniformValue, &material->uniformProperties, uniformName);
+  if(!uniformValue) {
+    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.string.len, uniformName.string.data);
     fflush(stderr);
+    return;
   }
-  UniformValue* uniformValue = hash_table_index(String, UniformValue, &material->uniformProperties, uniformName);
   glm_mat4_copy(mat4Value, uniformValue->mat4Value);
 }
 
-void material_set_vec3(Material* material, String uniformName, const vec3 vec3Value) {
-  if(!hash_table_contains(String, UniformValue, &material->uniformProperties, uniformName)) {
-    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.len, uniformName.data);
+void material_set_vec3(Material* material, InternedString uniformName, const vec3 vec3Value) {
+  UniformValue* uniformValue = hash_table_index(InternedString, UniformValue, &material->uniformProperties, uniformName);
+  if(!uniformValue) {
+    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.string.len, uniformName.string.data);
     fflush(stderr);
+    return;
   }
-  UniformValue* uniformValue = hash_table_index(String, UniformValue, &material->uniformProperties, uniformName);
   uniformValue->vec3Value[0] = vec3Value[0];
   uniformValue->vec3Value[1] = vec3Value[1];
   uniformValue->vec3Value[2] = vec3Value[2];
 }
 
-void material_set_float(Material* material, String uniformName, float floatValue) {
-  if(!hash_table_contains(String, UniformValue, &material->uniformProperties, uniformName)) {
-    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.len, uniformName.data);
+void material_set_bool(Material* material, InternedString uniformName, bool boolValue) {
+  UniformValue* uniformValue = hash_table_index(InternedString, UniformValue, &material->uniformProperties, uniformName);
+  if(!uniformValue) {
+    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.string.len, uniformName.string.data);
     fflush(stderr);
+    return;
+  }
+  uniformValue->boolValue = boolValue;
+}
+
+void material_set_float(Material* material, InternedString uniformName, float floatValue) {
+  UniformValue* uniformValue = hash_table_index(InternedString, UniformValue, &material->uniformProperties, uniformName);
+  if(!uniformValue) {
+    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.string.len, uniformName.string.data);
+    fflush(stderr);
+    return;
   }
-  UniformValue* uniformValue = hash_table_index(String, UniformValue, &material->uniformProperties, uniformName);
   uniformValue->floatValue = floatValue;
 }
 
-void material_set_int(Material* material, String uniformName, int intValue) {
-  if(!hash_table_contains(String, UniformValue, &material->uniformProperties, uniformName)) {
-    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.len, uniformName.data);
+void material_set_int(Material* material, InternedString uniformName, int intValue) {
+  UniformValue* uniformValue = hash_table_index(InternedString, UniformValue, &material->uniformProperties, uniformName);
+  if(!uniformValue) {
+    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.string.len, uniformName.string.data);
     fflush(stderr);
+    return;
   }
-  UniformValue* uniformValue = hash_table_index(String, UniformValue, &material->uniformProperties, uniformName);
   uniformValue->intValue = intValue;
 }
 
-void material_set_texture(Material* material, String uniformName, Texture texture) {
-  if(!hash_table_contains(String, SamplerValue, &material->samplerProperties, uniformName)) {
-    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.len, uniformName.data);
+void material_set_texture(Material* material, InternedString uniformName, Texture texture) {
+  SamplerValue* samplerValue = hash_table_index(InternedString, SamplerValue, &material->samplerProperties, uniformName);
+  if(!samplerValue) {
+    fprintf(stderr, "Shader %d There is not uniform called %.*s\n", material->shaderProgram->id, (int)uniformName.string.len, uniformName.string.data);
     fflush(stderr);
+    return;
   }
-  SamplerValue* samplerValue = hash_table_index(String, SamplerValue, &material->samplerProperties, uniformName);
+  retain_texture(texture);
+  release_texture(samplerValue->texture);
   samplerValue->texture = texture;
 }
 
+// Drops the material's references to its textures, cached textures nothing else uses are deleted
+void release_material_textures(Material* material) {
+  hash_table_foreach(InternedString, SamplerValue, &material->samplerProperties, pair, {
+    release_texture(pair->value.texture);
+    pair->value.texture = 0;
+  })
+}
+
 #endif
@@ -7,7 +7,7 @@ Texture pbrBrdfTexture;
 void setup_material(Arena* arena) {
   whiteTexture = create_texture("res/white.png");
 
-  ShaderProgram brdfShader = create_shader_program();
+  ShaderProgram brdfShader = create_shader_program(arena);
   attach_shader_to_program(&arena, &brdfShader, GL_VERTEX_SHADER, create_string_from_literal("res/shader/vertex.glsl"));
   attach_shader_to_program(&arena, &brdfShader, GL_FRAGMENT_SHADER, create_string_from_literal("res/shader/fragment.glsl"));
   finalize_shader_program(&brdfShader);
@@ -11,20 +11,30 @@
 
 #include "data_types/array.c"
 #include "data_types/arena.c"
+#include "data_types/memory_stats.c"
 #include "scene_define.c"
+#include "vertex_pack.c"
+#include "mesh_optimize.c"
 
-RenderData generate_render_data(Arena* arena, const Geometry* geometry) {
-  //We assume that the position data is always present
-  uint32_t vertexCount = geometry->positions.length;
-  size_t indexCount = geometry->indices.length;
+// Build with -DVERTEX_COMPRESSION to upload every mesh in the compressed vertex layout (VERTEX_FORMAT_COMPRESSED)
+#ifndef VERTEX_COMPRESSION
+#define VERTEX_COMPRESSION 0
+#endif
 
-  uint16_t stride = 3*sizeof(float);
-  bool hasNormals = geometry->normals.length != 0;
-  bool hasTexCoord = geometry->textureCoordinates.length != 0;
+// 16 bit indices are used whenever they can address every vertex, they take half the memory and bandwidth of 32 bit ones
+GLenum index_type_for_vertex_count(size_t vertexCount) { return vertexCount <= (size_t)UINT16_MAX + 1 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
 
-  if(hasNormals) stride += 3*sizeof(float);
-  if(hasTexCoord) stride += 2*sizeof(float);
+size_t index_type_size(GLenum indexType) { return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
 
+/* Uploads vertices that are already interleaved in the layout of format and indices of indexType (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT).
+ * Nothing is copied on the cpu side, so the data can come straight from a file mapping.
+ * The position transform of a compressed format is set by the caller, it starts as the identity
+*/
+RenderData upload_render_data(const void* vertexData, uint32_t vertexCount, uint32_t format, const void* indices, size_t indexCount, GLenum indexType) {
+  uint32_t stride = vertex_format_stride(format);
+  size_t indexSize = index_type_size(indexType);
+
+  memory_push_tag(MEMORY_TAG_MESH);
   GLuint VBO, VAO, EBO;
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
@@ -33,70 +43,111 @@ RenderData generate_render_data(Arena* arena, const Geometry* geometry) {
   // then configure vertex attributes(s).
   glBindVertexArray(VAO);
 
-  ScratchArena scratch = create_scratch_arena(arena);
-  char* vertexData = arena_alloc(arena, vertexCount*stride);
-
-  size_t offset = 0;
-  for(size_t i = 0; i < vertexCount; i++) {
-    memcpy(vertexData + offset, geometry->positions.data + i, 3*sizeof(float));
-    offset += 3*sizeof(float);
-    if(hasNormals) {
-      memcpy(vertexData + offset, geometry->normals.data + i, 3*sizeof(float));
-      offset += 3*sizeof(float);
-    }
-    if(hasTexCoord) {
-      memcpy(vertexData + offset, geometry->textureCoordinates.data + i, 2*sizeof(float));
-      offset += 2*sizeof(float);
-    }
-  }
-/*
-  for(size_t i = 0; i < vertexCount; i++) {
-    char* vD = vertexData + (stride * i);
-    printf("pos: %f, %f, %f\n", *(float*)vD, *(float*)(vD+sizeof(float)), *(float*)(vD+2*sizeof(float)));
-    printf("normal: %f, %f, %f\n", *(float*)(vD + 3*sizeof(float)), *(float*)(vD+4*sizeof(float)), *(float*)(vD+5*sizeof(float)));
-    printf("texCoord: %f, %f\n--------------------------\n", *(float*)(vD + 6*sizeof(float)), *(float*)(vD+7*sizeof(float)));
-  }
-
-  for(size_t i = 0; i < indexCount; i++) {
-    printf("indices: %d\n", geometry->indices.data[i]);
-  }
-  fflush(stdout);
-
-  */
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, stride*vertexCount, vertexData,GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, (size_t)stride*vertexCount, vertexData, GL_STATIC_DRAW);
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * indexCount,geometry->indices.data, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * indexCount, indices, GL_STATIC_DRAW);
+  memory_track_alloc(MEMORY_TAG_GL_BUFFER, (size_t)stride*vertexCount);
+  memory_track_alloc(MEMORY_TAG_GL_BUFFER, indexSize * indexCount);
 
-  offset = 0;
+  size_t normalOffset = vertex_format_normal_offset(format);
+  size_t texCoordOffset = vertex_format_texcoord_offset(format);
+  bool compressed = format & VERTEX_FORMAT_COMPRESSED;
 
-  glVertexAttribPointer(0,3, GL_FLOAT, GL_FALSE, stride, (void *)offset);
+  if(compressed) glVertexAttribPointer(0,3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void *)0);
+  else glVertexAttribPointer(0,3, GL_FLOAT, GL_FALSE, stride, (void *)0);
   glEnableVertexAttribArray(0);
-  offset += 3*sizeof(float);
 
-  if(hasNormals) {
-    glVertexAttribPointer(1,3, GL_FLOAT, GL_FALSE, stride, (void *)offset);
+  if(format & VERTEX_FORMAT_NORMAL) {
+    if(compressed) glVertexAttribPointer(1,2, GL_SHORT, GL_TRUE, stride, (void *)normalOffset);
+    else glVertexAttribPointer(1,3, GL_FLOAT, GL_FALSE, stride, (void *)normalOffset);
     glEnableVertexAttribArray(1);
-    offset += 3*sizeof(float);
   }
 
-  if(hasTexCoord) {
-    glVertexAttribPointer(2,2, GL_FLOAT, GL_FALSE, stride, (void *)offset);
+  if(format & VERTEX_FORMAT_TEXCOORD) {
+    glVertexAttribPointer(2,2, compressed ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, stride, (void *)texCoordOffset);
     glEnableVertexAttribArray(2);
-    offset += 2*sizeof(float);
   }
 
-  release_scratch_arena(scratch);
+  memory_pop_tag();
+
+  return (RenderData){VAO, VBO, EBO ,indexCount, indexType, vertexCount, format, GLM_VEC3_ZERO_INIT, GLM_VEC3_ONE_INIT};
+}
+
+/* Prints the vertex and index buffer sizes of every mesh next to what they would take as float vertices with 32 bit indices.
+ * A draw reads every vertex and index of the mesh at least once, so the sizes are also the least bandwidth a draw of it takes
+*/
+void mesh_size_report(FILE* stream, const Array(Mesh)* meshes) {
+  fprintf(stream, "%-6s %10s %10s %8s %12s %12s %12s %12s\n", "mesh", "vertices", "indices", "B/vertex", "vertex B", "index B", "total B", "float/u32 B");
+  size_t total = 0;
+  size_t uncompressedTotal = 0;
+  for(size_t i = 0; i < meshes->length; i++) {
+    const RenderData* renderData = &array_index(Mesh, meshes, i)->renderData;
+    uint32_t stride = vertex_format_stride(renderData->vertexFormat);
+    size_t vertexBytes = (size_t)renderData->vertexCount*stride;
+    size_t indexBytes = renderData->indexCount*index_type_size(renderData->indexType);
+    size_t uncompressed = (size_t)renderData->vertexCount*vertex_format_stride(renderData->vertexFormat & ~VERTEX_FORMAT_COMPRESSED) + renderData->indexCount*sizeof(uint32_t);
+    fprintf(stream, "%-6zu %10u %10zu %8u %12zu %12zu %12zu %12zu\n", i, renderData->vertexCount, renderData->indexCount, stride, vertexBytes, indexBytes, vertexBytes + indexBytes, uncompressed);
+    total += vertexBytes + indexBytes;
+    uncompressedTotal += uncompressed;
+  }
+  fprintf(stream, "total %zu bytes, %.1f%% of %zu bytes\n", total, uncompressedTotal ? 100.0*total/uncompressedTotal : 100.0, uncompressedTotal);
+}
 
-  return (RenderData){VAO, VBO, EBO ,indexCount};
+// The transform that decodes the positions of a compressed format packed inside these bounds
+void render_data_set_position_bounds(RenderData* renderData, const vec3 boundsMin, const vec3 boundsMax) {
+  glm_vec3_copy((float*)boundsMin, renderData->positionOffset);
+  glm_vec3_sub((float*)boundsMax, (float*)boundsMin, renderData->positionScale);
+}
+
+RenderData generate_render_data(Arena* arena, const Geometry* geometry) {
+  //We assume that the position data is always present
+  uint32_t vertexCount = geometry->positions.length;
+
+  uint32_t format = 0;
+  if(geometry->normals.length != 0) format |= VERTEX_FORMAT_NORMAL;
+  if(geometry->textureCoordinates.length != 0) format |= VERTEX_FORMAT_TEXCOORD;
+  if(VERTEX_COMPRESSION) format |= VERTEX_FORMAT_COMPRESSED;
+  uint32_t stride = vertex_format_stride(format);
+
+  //the meshlets are kept with the render data, they are taken before the scratch so they can shrink in place once it's released
+  size_t meshletBound = meshlet_count_bound(geometry->indices.length);
+  Meshlet* meshlets = arena_alloc_array(arena, Meshlet, meshletBound);
+  ScratchArena scratch = create_scratch_arena(arena);
+  char* vertexData = arena_alloc(arena, (size_t)vertexCount*stride);
+
+  VertexStream positions = {geometry->positions.data, sizeof(vec3)};
+  VertexStream normals = {geometry->normals.data, sizeof(vec3)};
+  VertexStream texCoords = {geometry->textureCoordinates.data, sizeof(vec2)};
+  vec3 boundsMin, boundsMax;
+  pack_vertices(vertexData, format, positions, normals, texCoords, vertexCount, boundsMin, boundsMax);
+
+  GLenum indexType = index_type_for_vertex_count(vertexCount);
+  uint32_t* indices = arena_alloc_array(arena, uint32_t, geometry->indices.length);
+  memcpy(indices, geometry->indices.data, geometry->indices.length*sizeof(uint32_t));
+  MeshOptimizeStats stats = optimize_mesh(arena, indices, sizeof(uint32_t), geometry->indices.length, vertexData, stride, vertexCount, positions, meshlets);
+  const void* indexData = indices;
+  if(indexType == GL_UNSIGNED_SHORT) {
+    uint16_t* shortIndices = arena_alloc_array(arena, uint16_t, geometry->indices.length);
+    for(size_t i = 0; i < geometry->indices.length; i++) shortIndices[i] = indices[i];
+    indexData = shortIndices;
+  }
+
+  RenderData renderData = upload_render_data(vertexData, vertexCount, format, indexData, geometry->indices.length, indexType);
+  if(format & VERTEX_FORMAT_COMPRESSED) render_data_set_position_bounds(&renderData, boundsMin, boundsMax);
+  release_scratch_arena(scratch);
+  renderData.meshlets = arena_realloc(arena, meshlets, meshletBound*sizeof(Meshlet), stats.meshletCount*sizeof(Meshlet), _Alignof(Meshlet));
+  renderData.meshletCount = stats.meshletCount;
+  return renderData;
 }
 
 RenderData generate_quad(Arena* arena, vec3 horizontal, vec3 vertical, uint32_t subDivision) {
   size_t vertexCount = (subDivision + 2) * (subDivision + 2);
   size_t indexCount = 6 * (subDivision + 1) * (subDivision + 1);
   
-  ScratchArena scratchArena = create_scratch_arena(arena);
+  //the geometry is only needed until it's uploaded, the meshlets generate_render_data keeps in arena come after it
+  ScratchArena scratchArena = get_thread_scratch_arena(arena);
 
   vec3* positionData = arena_alloc_array(scratchArena.allocator, vec3, vertexCount);
   vec3* normalData = arena_alloc_array(scratchArena.allocator, vec3, vertexCount);
@@ -159,7 +210,7 @@ RenderData generate_icosphere(Arena* arena, uint32_t subDivision) {
   size_t vertexCount = 10 * (subDivision + 1) * (subDivision + 1) + 2;
   size_t indexCount = 60 * (subDivision + 1) * (subDivision + 1);
 
-  ScratchArena scratchArena = create_scratch_arena(arena);
+  ScratchArena scratchArena = get_thread_scratch_arena(arena);
 
   vec3* positionData = arena_alloc_array(scratchArena.allocator, vec3, vertexCount);
   vec3* normalData = arena_alloc_array(scratchArena.allocator, vec3, vertexCount);
@@ -0,0 +1,309 @@
+// The baked mesh cache format, nothing in here touches GL
+#ifndef MESH_CACHE_IMPL
+#define MESH_CACHE_IMPL
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "data_types/arena.c"
+#include "data_types/string.c"
+#include "vertex_pack.c"
+#include "meshlet.c"
+
+/* A cooked model is a single file that is mmapped and used in place:
+ *
+ *   header | dependencies | images | materials | primitives | nodes | strings | blob
+ *
+ * The blob holds the interleaved vertices (in the VertexFormat of the primitive, compressed positions are quantized inside
+ * the bounds of the primitive), the 16 or 32 bit indices and the meshlets of every primitive, each one starts on a
+ * MESH_CACHE_ALIGNMENT boundary so it can be given to glBufferData straight from the mapping.
+ * The indices are the triangles of the meshlets in order, a primitive that isn't a triangle list has no meshlets.
+ * Images that are stored inside the glTF (bufferView images of a .glb) are copied into the blob as they are encoded,
+ * they are decoded from the mapping too.
+ * Sections refer to each other with byte offsets from the start of the file (strings and blob data) or indices (images, materials).
+ * Paths are stored as they are written in the glTF, relative to the directory of the model.
+ * The primitives are sorted by mesh and the nodes of the default scene are flattened so parents come before their children.
+ * The cache is stale when the hash of the source json differs or one of the files it was cooked from
+ * (the .bin buffers) changed size or modification time. A cache with a different version is stale too, so bump
+ * MESH_CACHE_VERSION whenever anything in here, the vertex layout or the order the optimization passes write changes
+*/
+#define MESH_CACHE_MAGIC "GEBAKED"
+#define MESH_CACHE_VERSION 7
+#define MESH_CACHE_ALIGNMENT 64
+
+#ifndef MESH_CACHE_EXTENSION
+#define MESH_CACHE_EXTENSION ".baked"
+#endif //MESH_CACHE_EXTENSION
+
+typedef struct {
+  uint64_t offset;
+  uint64_t count;
+} MeshCacheSection;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t sourceHash;
+  uint64_t fileSize;
+  uint64_t meshCount;
+  MeshCacheSection dependencies;
+  MeshCacheSection images;
+  MeshCacheSection materials;
+  MeshCacheSection primitives;
+  MeshCacheSection nodes;
+  MeshCacheSection strings; // count is in bytes
+  MeshCacheSection blob;    // count is in bytes
+} MeshCacheHeader;
+
+typedef struct {
+  uint64_t pathOffset;
+  uint64_t pathLength;
+  int64_t size;
+  int64_t modifiedTime; // nanoseconds
+} MeshCacheDependency;
+
+// an image is either a file (pathLength isn't 0) or encoded data in the blob
+typedef struct {
+  uint64_t pathOffset;
+  uint64_t pathLength;
+  uint64_t blobOffset;
+  uint64_t blobLength;
+} MeshCacheImage;
+
+// image indices are -1 when the material doesn't have the texture
+typedef struct {
+  float baseColorFactor[4];
+  float emissiveFactor[3];
+  float metallicFactor;
+  float roughnessFactor;
+  int32_t baseColorImage;
+  int32_t metallicRoughnessImage;
+  int32_t normalImage;
+  int32_t emissiveImage;
+  uint32_t padding;
+} MeshCacheMaterial;
+
+typedef struct {
+  uint64_t vertexOffset;
+  uint64_t indexOffset;
+  uint64_t meshletOffset;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t indexSize; // 2 (vertexCount <= 65536) or 4 bytes per index
+  uint32_t vertexFormat; // VertexFormat flags
+  uint32_t vertexStride;
+  int32_t material; // -1 uses the default material
+  uint32_t mesh;    // the glTF mesh the primitive belongs to
+  uint32_t meshletCount;
+  float boundsMin[3];
+  float boundsMax[3];
+} MeshCachePrimitive;
+
+typedef struct {
+  int32_t parent; // -1 for roots
+  int32_t mesh;   // -1 when the node doesn't draw anything
+  float translation[3];
+  float rotation[4]; // quaternion x, y, z, w
+  float scale[3];
+} MeshCacheNode;
+
+typedef struct {
+  const char* data;
+  const MeshCacheHeader* header;
+  const MeshCacheDependency* dependencies;
+  const MeshCacheImage* images;
+  const MeshCacheMaterial* materials;
+  const MeshCachePrimitive* primitives;
+  const MeshCacheNode* nodes;
+} MeshCache;
+
+static inline size_t mesh_cache_align(size_t size) { return (size + MESH_CACHE_ALIGNMENT - 1) & ~(size_t)(MESH_CACHE_ALIGNMENT - 1); }
+
+static inline String mesh_cache_string(const MeshCache* cache, uint64_t offset, uint64_t length) { return (String){cache->data + offset, length}; }
+
+// The size and modification time of the file at directory/path, false when it can't be stat'ed
+bool mesh_cache_stat_file(String directory, String path, int64_t* size, int64_t* modifiedTime) {
+  char cPath[directory.len + path.len + 1];
+  if(directory.len) memcpy(cPath, directory.data, directory.len);
+  string_to_c_str(path, cPath + directory.len);
+  struct stat fileStat;
+  if(stat(cPath, &fileStat) != 0) return false;
+  *size = fileStat.st_size;
+  *modifiedTime = (int64_t)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+  return true;
+}
+
+static inline bool mesh_cache_range_valid(uint64_t offset, uint64_t size, uint64_t fileSize) { return offset <= fileSize && size <= fileSize - offset; }
+
+static bool mesh_cache_section_valid(MeshCacheSection section, size_t elementSize, uint64_t fileSize) {
+  if(section.offset % 8) return false;
+  if(elementSize && section.count > fileSize / elementSize) return false;
+  return mesh_cache_range_valid(section.offset, section.count * elementSize, fileSize);
+}
+
+/* Checks that every offset in the file stays inside it, so a truncated or corrupt cache is treated as stale instead of being read out of bounds.
+ * Fills in cache on success
+*/
+bool open_mesh_cache(const char* data, size_t len, MeshCache* cache) {
+  const MeshCacheHeader* header = (const MeshCacheHeader*)data;
+  if(len < sizeof(MeshCacheHeader) || memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) != 0) return false;
+  if(header->version != MESH_CACHE_VERSION || header->headerSize != sizeof(MeshCacheHeader) || header->fileSize != len) return false;
+
+  if(!mesh_cache_section_valid(header->dependencies, sizeof(MeshCacheDependency), len) ||
+    !mesh_cache_section_valid(header->images, sizeof(MeshCacheImage), len) ||
+    !mesh_cache_section_valid(header->materials, sizeof(MeshCacheMaterial), len) ||
+    !mesh_cache_section_valid(header->primitives, sizeof(MeshCachePrimitive), len) ||
+    !mesh_cache_section_valid(header->nodes, sizeof(MeshCacheNode), len) ||
+    !mesh_cache_section_valid(header->strings, 1, len) ||
+    !mesh_cache_section_valid(header->blob, 1, len)) return false;
+  //the loader allocates a mesh for each one, a corrupt count shouldn't be able to ask for more memory than the file is big
+  if(header->meshCount > len / sizeof(uint32_t)) return false;
+
+  *cache = (MeshCache){
+    data,
+    header,
+    (const MeshCacheDependency*)(data + header->dependencies.offset),
+    (const MeshCacheImage*)(data + header->images.offset),
+    (const MeshCacheMaterial*)(data + header->materials.offset),
+    (const MeshCachePrimitive*)(data + header->primitives.offset),
+    (const MeshCacheNode*)(data + header->nodes.offset),
+  };
+
+  const MeshCacheSection strings = header->strings;
+  for(uint64_t i = 0; i < header->dependencies.count; i++) {
+    const MeshCacheDependency* dependency = &cache->dependencies[i];
+    if(dependency->pathOffset < strings.offset || !mesh_cache_range_valid(dependency->pathOffset - strings.offset, dependency->pathLength, strings.count)) return false;
+  }
+  for(uint64_t i = 0; i < header->images.count; i++) {
+    const MeshCacheImage* image = &cache->images[i];
+    if(image->pathOffset < strings.offset || !mesh_cache_range_valid(image->pathOffset - strings.offset, image->pathLength, strings.count)) return false;
+    if(image->blobOffset < header->blob.offset || !mesh_cache_range_valid(image->blobOffset - header->blob.offset, image->blobLength, header->blob.count)) return false;
+  }
+  for(uint64_t i = 0; i < header->materials.count; i++) {
+    const MeshCacheMaterial* material = &cache->materials[i];
+    const int32_t images[] = {material->baseColorImage, material->metallicRoughnessImage, material->normalImage, material->emissiveImage};
+    for(uint8_t j = 0; j < 4; j++) {
+      if(images[j] < -1 || (images[j] >= 0 && (uint64_t)images[j] >= header->images.count)) return false;
+    }
+  }
+
+  const MeshCacheSection blob = header->blob;
+  for(uint64_t i = 0; i < header->primitives.count; i++) {
+    const MeshCachePrimitive* primitive = &cache->primitives[i];
+    if(primitive->mesh >= header->meshCount || (i && primitive->mesh < cache->primitives[i-1].mesh)) return false;
+    if(primitive->material < -1 || (primitive->material >= 0 && (uint64_t)primitive->material >= header->materials.count)) return false;
+    if(primitive->indexSize != sizeof(uint16_t) && primitive->indexSize != sizeof(uint32_t)) return false;
+    if(primitive->vertexFormat >= VERTEX_FORMAT_COMPRESSED << 1 || primitive->vertexStride != vertex_format_stride(primitive->vertexFormat)) return false;
+    if(primitive->vertexOffset < blob.offset || primitive->indexOffset < blob.offset || primitive->meshletOffset < blob.offset) return false;
+    if(primitive->vertexOffset % MESH_CACHE_ALIGNMENT || primitive->indexOffset % MESH_CACHE_ALIGNMENT || primitive->meshletOffset % MESH_CACHE_ALIGNMENT) return false;
+    //the counts are 32 bit, so the sizes can't overflow
+    if(!mesh_cache_range_valid(primitive->vertexOffset - blob.offset, (uint64_t)primitive->vertexCount * primitive->vertexStride, blob.count) ||
+      !mesh_cache_range_valid(primitive->indexOffset - blob.offset, (uint64_t)primitive->indexCount * primitive->indexSize, blob.count) ||
+      !mesh_cache_range_valid(primitive->meshletOffset - blob.offset, (uint64_t)primitive->meshletCount * sizeof(Meshlet), blob.count)) return false;
+    //the meshlets are drawn as index ranges, they have to stay inside the indices
+    const Meshlet* meshlets = (const Meshlet*)(data + primitive->meshletOffset);
+    for(uint32_t j = 0; j < primitive->meshletCount; j++) {
+      if(meshlets[j].firstIndex > primitive->indexCount || meshlets[j].triangleCount > (primitive->indexCount - meshlets[j].firstIndex)/3) return false;
+    }
+  }
+  for(uint64_t i = 0; i < header->nodes.count; i++) {
+    const MeshCacheNode* node = &cache->nodes[i];
+    if(node->parent < -1 || node->parent >= (int64_t)i) return false;
+    if(node->mesh < -1 || (node->mesh >= 0 && (uint64_t)node->mesh >= header->meshCount)) return false;
+  }
+  return true;
+}
+
+// False when a file the cache was cooked from is gone or has changed since, directory is the directory of the model
+bool mesh_cache_dependencies_current(const MeshCache* cache, String directory) {
+  for(uint64_t i = 0; i < cache->header->dependencies.count; i++) {
+    const MeshCacheDependency* dependency = &cache->dependencies[i];
+    int64_t size, modifiedTime;
+    String path = mesh_cache_string(cache, dependency->pathOffset, dependency->pathLength);
+    if(!mesh_cache_stat_file(directory, path, &size, &modifiedTime)) return false;
+    if(size != dependency->size || modifiedTime != dependency->modifiedTime) return false;
+  }
+  return true;
+}
+
+//------------------------------------------
+// Writing
+//------------------------------------------
+
+/* Lays out a cache file in memory, the counts and sizes have to be known up front:
+ *
+ *   MeshCacheWriter writer = create_mesh_cache_writer(arena, sourceHash, dependencyCount, imageCount, materialCount, primitiveCount, nodeCount, stringBytes, blobBytes);
+ *   writer.header->meshCount = meshCount;
+ *   ...fill writer.dependencies/images/materials/primitives/nodes, use mesh_cache_write_string and mesh_cache_write_blob for the data...
+ *   write_file(path, writer.data, writer.len);
+ *
+ * blobBytes has to include the padding of every blob allocation, mesh_cache_blob_size gives the padded size
+*/
+typedef struct {
+  char* data;
+  size_t len;
+  MeshCacheHeader* header;
+  MeshCacheDependency* dependencies;
+  MeshCacheImage* images;
+  MeshCacheMaterial* materials;
+  MeshCachePrimitive* primitives;
+  MeshCacheNode* nodes;
+  size_t stringUsed;
+  size_t blobUsed;
+} MeshCacheWriter;
+
+static inline size_t mesh_cache_blob_size(size_t size) { return mesh_cache_align(size); }
+
+MeshCacheWriter create_mesh_cache_writer(Arena* arena, uint64_t sourceHash, size_t dependencyCount, size_t imageCount, size_t materialCount, size_t primitiveCount, size_t nodeCount, size_t stringBytes, size_t blobBytes) {
+  MeshCacheHeader header = {.magic=MESH_CACHE_MAGIC, .version=MESH_CACHE_VERSION, .headerSize=sizeof(MeshCacheHeader), .sourceHash=sourceHash};
+  size_t offset = mesh_cache_align(sizeof(MeshCacheHeader));
+  header.dependencies = (MeshCacheSection){offset, dependencyCount};
+  offset = mesh_cache_align(offset + dependencyCount * sizeof(MeshCacheDependency));
+  header.images = (MeshCacheSection){offset, imageCount};
+  offset = mesh_cache_align(offset + imageCount * sizeof(MeshCacheImage));
+  header.materials = (MeshCacheSection){offset, materialCount};
+  offset = mesh_cache_align(offset + materialCount * sizeof(MeshCacheMaterial));
+  header.primitives = (MeshCacheSection){offset, primitiveCount};
+  offset = mesh_cache_align(offset + primitiveCount * sizeof(MeshCachePrimitive));
+  header.nodes = (MeshCacheSection){offset, nodeCount};
+  offset = mesh_cache_align(offset + nodeCount * sizeof(MeshCacheNode));
+  header.strings = (MeshCacheSection){offset, stringBytes};
+  offset = mesh_cache_align(offset + stringBytes);
+  header.blob = (MeshCacheSection){offset, blobBytes};
+  header.fileSize = offset + blobBytes;
+
+  char* data = arena_alloc_align(arena, header.fileSize, MESH_CACHE_ALIGNMENT);
+  memset(data, 0, header.fileSize);
+  memcpy(data, &header, sizeof(header));
+  return (MeshCacheWriter){
+    data,
+    header.fileSize,
+    (MeshCacheHeader*)data,
+    (MeshCacheDependency*)(data + header.dependencies.offset),
+    (MeshCacheImage*)(data + header.images.offset),
+    (MeshCacheMaterial*)(data + header.materials.offset),
+    (MeshCachePrimitive*)(data + header.primitives.offset),
+    (MeshCacheNode*)(data + header.nodes.offset),
+  };
+}
+
+// Copies the string into the string section, returns its offset
+uint64_t mesh_cache_write_string(MeshCacheWriter* writer, String string) {
+  uint64_t offset = writer->header->strings.offset + writer->stringUsed;
+  memcpy(writer->data + offset, string.data, string.len);
+  writer->stringUsed += string.len;
+  return offset;
+}
+
+// Reserves size bytes of the blob, returns the offset of the (aligned) space
+uint64_t mesh_cache_write_blob(MeshCacheWriter* writer, size_t size) {
+  uint64_t offset = writer->header->blob.offset + writer->blobUsed;
+  writer->blobUsed += mesh_cache_blob_size(size);
+  return offset;
+}
+
+#endif
@@ -0,0 +1,521 @@
+#ifndef MESH_OPTIMIZE_IMPL
+#define MESH_OPTIMIZE_IMPL
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "data_types/arena.c"
+#include "vertex_pack.c"
+#include "meshlet.c"
+
+/* Reordering of triangle lists for the GPU, it runs once when a mesh is cooked into the mesh cache or generated.
+ * - optimize_vertex_cache: Tipsify (Sander, Nehab, Barczak 2007). Triangles are emitted in fans around one vertex at a time and the next
+ *   vertex is picked from the last fan so its vertices are still in the post transform cache
+ * - optimize_overdraw: the vertex cache order is cut into clusters where the cache is cold anyway and the clusters that face
+ *   outward are drawn first, so the front of a convex-ish mesh fills the depth buffer before the triangles behind it are shaded
+ * - optimize_vertex_fetch_remap: the vertices are renumbered in the order the indices first use them, so the vertex fetch
+ *   reads the vertex buffer close to linearly
+ * Every pass is deterministic: nothing depends on addresses or hash order and the cluster sort has a total order.
+ * Build with -DMESH_OPTIMIZATION=0 to keep the indices in the order they come in, apart from grouping them into meshlets
+*/
+#ifndef MESH_OPTIMIZATION
+#define MESH_OPTIMIZATION 1
+#endif
+
+// The FIFO the passes optimize for, current GPUs batch vertices in groups of a similar size
+#ifndef MESH_OPTIMIZE_CACHE_SIZE
+#define MESH_OPTIMIZE_CACHE_SIZE 16
+#endif
+
+// How much worse the ACMR of a cluster may get when it's split for the overdraw order, 1.05 is 5%
+#ifndef MESH_OPTIMIZE_OVERDRAW_THRESHOLD
+#define MESH_OPTIMIZE_OVERDRAW_THRESHOLD 1.05f
+#endif
+
+// The vertex fetch is modelled as a FIFO of this many 64 byte lines
+#define MESH_OPTIMIZE_FETCH_LINE_SIZE 64
+#define MESH_OPTIMIZE_FETCH_CACHE_LINES 64
+
+// The overdraw is measured on 6 orthographic views of this many pixels squared
+#define MESH_OPTIMIZE_OVERDRAW_RESOLUTION 256
+
+/* A FIFO cache of vertices with a timestamp per vertex instead of a queue: a vertex is in the cache when it was added
+ * less than size additions ago. Flushing moves the time past every entry
+*/
+typedef struct {
+  uint32_t* times;
+  uint32_t time;
+  uint32_t size;
+} VertexFifo;
+
+static VertexFifo create_vertex_fifo(Arena* arena, uint32_t vertexCount, uint32_t size) {
+  VertexFifo fifo = {arena_alloc_array(arena, uint32_t, vertexCount), size + 1, size};
+  memset(fifo.times, 0, vertexCount*sizeof(uint32_t));
+  return fifo;
+}
+
+static inline bool vertex_fifo_contains(const VertexFifo* fifo, uint32_t vertex) { return fifo->time - fifo->times[vertex] <= fifo->size; }
+
+// 1 when the vertex had to be transformed
+static inline uint32_t vertex_fifo_add(VertexFifo* fifo, uint32_t vertex) {
+  if(vertex_fifo_contains(fifo, vertex)) return 0;
+  fifo->times[vertex] = fifo->time++;
+  return 1;
+}
+
+static inline void vertex_fifo_flush(VertexFifo* fifo) { fifo->time += fifo->size + 1; }
+
+//------------------------------------------
+// Analysis
+//------------------------------------------
+
+typedef struct {
+  float acmr; // vertices transformed per triangle, 3 is the worst and a large regular grid can get close to 0.5
+  float atvr; // vertices transformed per vertex the indices use, 1 is the best
+} VertexCacheStats;
+
+VertexCacheStats analyze_vertex_cache(Arena* arena, const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize) {
+  if(indexCount < 3) return (VertexCacheStats){0.0f, 0.0f};
+  ScratchArena scratch = create_scratch_arena(arena);
+  VertexFifo fifo = create_vertex_fifo(arena, vertexCount, cacheSize);
+  size_t transformed = 0;
+  for(size_t i = 0; i < indexCount; i++) transformed += vertex_fifo_add(&fifo, indices[i]);
+  //every vertex that was used has a time, the first one is cacheSize + 1
+  size_t used = 0;
+  for(uint32_t i = 0; i < vertexCount; i++) used += fifo.times[i] != 0;
+  release_scratch_arena(scratch);
+  return (VertexCacheStats){(float)transformed / (indexCount/3), (float)transformed / used};
+}
+
+/* Bytes read from the vertex buffer per byte of it (1 is the best), the vertices that miss the post transform cache
+ * are fetched in whole lines through a FIFO of lines
+*/
+float analyze_vertex_fetch(Arena* arena, const uint32_t* indices, size_t indexCount, uint32_t vertexCount, size_t vertexStride, uint32_t cacheSize) {
+  if(!indexCount || !vertexCount) return 0.0f;
+  ScratchArena scratch = create_scratch_arena(arena);
+  VertexFifo vertexFifo = create_vertex_fifo(arena, vertexCount, cacheSize);
+  uint32_t lineCount = (vertexCount*vertexStride + MESH_OPTIMIZE_FETCH_LINE_SIZE - 1) / MESH_OPTIMIZE_FETCH_LINE_SIZE;
+  VertexFifo lineFifo = create_vertex_fifo(arena, lineCount, MESH_OPTIMIZE_FETCH_CACHE_LINES);
+  size_t fetched = 0;
+  for(size_t i = 0; i < indexCount; i++) {
+    if(!vertex_fifo_add(&vertexFifo, indices[i])) continue;
+    size_t first = indices[i]*vertexStride / MESH_OPTIMIZE_FETCH_LINE_SIZE;
+    size_t last = ((indices[i] + 1)*vertexStride - 1) / MESH_OPTIMIZE_FETCH_LINE_SIZE;
+    for(size_t line = first; line <= last; line++) fetched += vertex_fifo_add(&lineFifo, line);
+  }
+  release_scratch_arena(scratch);
+  return (float)(fetched*MESH_OPTIMIZE_FETCH_LINE_SIZE) / (vertexCount*vertexStride);
+}
+
+/* Pixels shaded per pixel covered (1 is no overdraw), averaged over orthographic views from both sides of the three axes.
+ * Back faces are culled and the depth test is the usual less, so the order of the triangles is what changes the result
+*/
+float analyze_overdraw(Arena* arena, const uint32_t* indices, size_t indexCount, VertexStream position, uint32_t vertexCount) {
+  const uint32_t resolution = MESH_OPTIMIZE_OVERDRAW_RESOLUTION;
+  ScratchArena scratch = create_scratch_arena(arena);
+  float boundsMin[3], boundsMax[3];
+  vertex_position_bounds(position, vertexCount, boundsMin, boundsMax);
+  float extent = fmaxf(fmaxf(boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1]), boundsMax[2] - boundsMin[2]);
+  float scale = extent > 0.0f ? (resolution - 1) / extent : 0.0f;
+  float* depth = arena_alloc_array(arena, float, resolution*resolution);
+
+  size_t shaded = 0, covered = 0;
+  for(uint8_t view = 0; view < 6; view++) {
+    for(uint32_t i = 0; i < resolution*resolution; i++) depth[i] = FLT_MAX;
+    /* Looking down -axis the image is (axis + 1, axis + 2) and the nearest point has the largest coordinate on the axis.
+     * From the other side swapping the image axes mirrors it, which keeps the front faces counter clockwise
+    */
+    uint8_t axis = view >> 1;
+    bool flip = view & 1;
+    uint8_t uAxis = (axis + (flip ? 2 : 1)) % 3;
+    uint8_t vAxis = (axis + (flip ? 1 : 2)) % 3;
+    for(size_t i = 0; i + 2 < indexCount; i += 3) {
+      float u[3], v[3], z[3];
+      for(uint8_t j = 0; j < 3; j++) {
+        float p[3];
+        load_position(position, indices[i + j], p);
+        u[j] = (p[uAxis] - boundsMin[uAxis])*scale;
+        v[j] = (p[vAxis] - boundsMin[vAxis])*scale;
+        z[j] = flip ? p[axis] : -p[axis];
+      }
+      float area = (u[1] - u[0])*(v[2] - v[0]) - (u[2] - u[0])*(v[1] - v[0]);
+      if(area <= 0.0f) continue;
+
+      int32_t minX = (int32_t)fmaxf(floorf(fminf(fminf(u[0], u[1]), u[2])), 0.0f);
+      int32_t minY = (int32_t)fmaxf(floorf(fminf(fminf(v[0], v[1]), v[2])), 0.0f);
+      int32_t maxX = (int32_t)fminf(ceilf(fmaxf(fmaxf(u[0], u[1]), u[2])), resolution - 1);
+      int32_t maxY = (int32_t)fminf(ceilf(fmaxf(fmaxf(v[0], v[1]), v[2])), resolution - 1);
+      for(int32_t y = minY; y <= maxY; y++) {
+        for(int32_t x = minX; x <= maxX; x++) {
+          float weights[3];
+          bool inside = true;
+          for(uint8_t edge = 0; edge < 3 && inside; edge++) {
+            uint8_t a = (edge + 1) % 3, b = (edge + 2) % 3;
+            float dx = u[b] - u[a], dy = v[b] - v[a];
+            weights[edge] = dx*(y - v[a]) - dy*(x - u[a]);
+            //a pixel exactly on an edge belongs to one of the two triangles that share it
+            inside = weights[edge] > 0.0f || (weights[edge] == 0.0f && (dy > 0.0f || (dy == 0.0f && dx < 0.0f)));
+          }
+          if(!inside) continue;
+          float d = (weights[0]*z[0] + weights[1]*z[1] + weights[2]*z[2]) / area;
+          float* pixel = &depth[y*resolution + x];
+          if(d >= *pixel) continue;
+          covered += *pixel == FLT_MAX;
+          *pixel = d;
+          shaded++;
+        }
+      }
+    }
+  }
+  release_scratch_arena(scratch);
+  return covered ? (float)shaded / covered : 0.0f;
+}
+
+//------------------------------------------
+// Vertex cache
+//------------------------------------------
+
+// The next vertex with triangles left from the dead end stack (the most recent vertices first) or else the next one in index order, -1 when every triangle is out
+static int64_t tipsify_skip_dead_end(const uint32_t* liveTriangles, const uint32_t* deadEnd, size_t* deadEndLength, uint32_t* cursor, uint32_t vertexCount) {
+  while(*deadEndLength) {
+    uint32_t vertex = deadEnd[--*deadEndLength];
+    if(liveTriangles[vertex]) return vertex;
+  }
+  for(; *cursor < vertexCount; (*cursor)++) {
+    if(liveTriangles[*cursor]) return *cursor;
+  }
+  return -1;
+}
+
+// Writes the triangles in the Tipsify order to destination (which can't be indices)
+void optimize_vertex_cache(Arena* arena, uint32_t* destination, const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize) {
+  size_t triangleCount = indexCount/3;
+  if(!triangleCount) return;
+  ScratchArena scratch = create_scratch_arena(arena);
+
+  //the triangles of every vertex, the triangles of vertex v are adjacency[offsets[v]..offsets[v + 1]]
+  uint32_t* liveTriangles = arena_alloc_array(arena, uint32_t, vertexCount);
+  uint32_t* offsets = arena_alloc_array(arena, uint32_t, vertexCount + 1);
+  uint32_t* adjacency = arena_alloc_array(arena, uint32_t, triangleCount*3);
+  memset(liveTriangles, 0, vertexCount*sizeof(uint32_t));
+  for(size_t i = 0; i < triangleCount*3; i++) liveTriangles[indices[i]]++;
+  offsets[0] = 0;
+  for(uint32_t i = 0; i < vertexCount; i++) offsets[i + 1] = offsets[i] + liveTriangles[i];
+  uint32_t* fill = arena_alloc_array(arena, uint32_t, vertexCount);
+  memcpy(fill, offsets, vertexCount*sizeof(uint32_t));
+  for(size_t i = 0; i < triangleCount*3; i++) adjacency[fill[indices[i]]++] = i/3;
+
+  VertexFifo fifo = create_vertex_fifo(arena, vertexCount, cacheSize);
+  bool* emitted = arena_alloc_array(arena, bool, triangleCount);
+  memset(emitted, 0, triangleCount*sizeof(bool));
+  //every vertex of an emitted triangle is pushed once, so both are bounded by the index count
+  uint32_t* deadEnd = arena_alloc_array(arena, uint32_t, triangleCount*3);
+  uint32_t* candidates = arena_alloc_array(arena, uint32_t, triangleCount*3);
+  size_t deadEndLength = 0;
+  uint32_t cursor = 0;
+  size_t outputLength = 0;
+
+  int64_t fan = tipsify_skip_dead_end(liveTriangles, deadEnd, &deadEndLength, &cursor, vertexCount);
+  while(fan >= 0) {
+    size_t candidateCount = 0;
+    for(uint32_t i = offsets[fan]; i < offsets[fan + 1]; i++) {
+      uint32_t triangle = adjacency[i];
+      if(emitted[triangle]) continue;
+      emitted[triangle] = true;
+      for(uint8_t j = 0; j < 3; j++) {
+        uint32_t vertex = indices[triangle*3 + j];
+        destination[outputLength++] = vertex;
+        deadEnd[deadEndLength++] = vertex;
+        candidates[candidateCount++] = vertex;
+        liveTriangles[vertex]--;
+        vertex_fifo_add(&fifo, vertex);
+      }
+    }
+
+    /* The next fan is around a vertex of this one that will still be in the cache after all of its triangles are emitted
+     * (each one adds at most 2 vertices), the one that has been in the cache the longest first. Vertices that won't stay are
+     * only picked when there is no other, before jumping away
+    */
+    int64_t next = -1;
+    int64_t bestPriority = -1;
+    for(size_t i = 0; i < candidateCount; i++) {
+      uint32_t vertex = candidates[i];
+      if(!liveTriangles[vertex]) continue;
+      int64_t priority = 0;
+      uint32_t age = fifo.time - fifo.times[vertex];
+      if(age + 2*liveTriangles[vertex] <= cacheSize) priority = age;
+      if(priority > bestPriority) {
+        bestPriority = priority;
+        next = vertex;
+      }
+    }
+    if(next < 0) next = tipsify_skip_dead_end(liveTriangles, deadEnd, &deadEndLength, &cursor, vertexCount);
+    fan = next;
+  }
+  release_scratch_arena(scratch);
+}
+
+//------------------------------------------
+// Overdraw
+//------------------------------------------
+
+typedef struct {
+  float key;
+  uint32_t cluster;
+} OverdrawCluster;
+
+// Larger keys first, the cluster index makes the order total so equal keys can't come out differently
+static int compare_overdraw_clusters(const void* a, const void* b) {
+  const OverdrawCluster* first = a;
+  const OverdrawCluster* second = b;
+  if(first->key != second->key) return first->key > second->key ? -1 : 1;
+  return first->cluster < second->cluster ? -1 : first->cluster > second->cluster;
+}
+
+/* Reorders triangles that are in vertex cache order (what optimize_vertex_cache wrote) into destination (which can't be indices).
+ * The order is cut where a triangle misses the cache with all 3 vertices, the mesh went somewhere new and nothing is lost by
+ * drawing the two sides apart. Those clusters are split again wherever their ACMR so far is within threshold of the ACMR of
+ * the whole cluster, every piece pays for one cold cache and no more.
+ * The pieces are sorted by how far they face away from the center of the mesh, dot(centroid - mesh centroid, normal), largest
+ * first so the outside is drawn before what it hides (Sander et al. 2007)
+*/
+void optimize_overdraw(Arena* arena, uint32_t* destination, const uint32_t* indices, size_t indexCount, VertexStream position, uint32_t vertexCount, uint32_t cacheSize, float threshold) {
+  size_t triangleCount = indexCount/3;
+  if(!triangleCount) return;
+  ScratchArena scratch = create_scratch_arena(arena);
+  VertexFifo fifo = create_vertex_fifo(arena, vertexCount, cacheSize);
+  uint32_t* clusters = arena_alloc_array(arena, uint32_t, triangleCount);
+  size_t clusterCount = 0;
+  for(size_t i = 0; i < triangleCount; i++) {
+    uint32_t misses = vertex_fifo_add(&fifo, indices[i*3]) + vertex_fifo_add(&fifo, indices[i*3 + 1]) + vertex_fifo_add(&fifo, indices[i*3 + 2]);
+    if(i == 0 || misses == 3) clusters[clusterCount++] = i;
+  }
+  //the first triangle of every piece plus the end
+  uint32_t* pieces = arena_alloc_array(arena, uint32_t, triangleCount + 1);
+  size_t pieceCount = 0;
+  for(size_t i = 0; i < clusterCount; i++) {
+    uint32_t start = clusters[i];
+    uint32_t end = i + 1 < clusterCount ? clusters[i + 1] : triangleCount;
+    vertex_fifo_flush(&fifo);
+    uint32_t misses = 0;
+    for(uint32_t j = start*3; j < end*3; j++) misses += vertex_fifo_add(&fifo, indices[j]);
+    float clusterThreshold = threshold*misses / (end - start);
+
+    vertex_fifo_flush(&fifo);
+    pieces[pieceCount++] = start;
+    uint32_t pieceMisses = 0;
+    uint32_t pieceStart = start;
+    for(uint32_t j = start; j + 1 < end; j++) {
+      for(uint8_t k = 0; k < 3; k++) pieceMisses += vertex_fifo_add(&fifo, indices[j*3 + k]);
+      if(pieceMisses > clusterThreshold*(j + 1 - pieceStart)) continue;
+      pieceStart = j + 1;
+      pieces[pieceCount++] = pieceStart;
+      pieceMisses = 0;
+      vertex_fifo_flush(&fifo);
+    }
+  }
+  pieces[pieceCount] = triangleCount;
+
+  //area weighted centroids and normals, the length of the cross product is twice the area
+  float (*centroids)[3] = arena_alloc_array(arena, float[3], pieceCount);
+  float (*normals)[3] = arena_alloc_array(arena, float[3], pieceCount);
+  float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+  float meshArea = 0.0f;
+  for(size_t i = 0; i < pieceCount; i++) {
+    float centroid[3] = {0.0f, 0.0f, 0.0f}, normal[3] = {0.0f, 0.0f, 0.0f};
+    float area = 0.0f;
+    for(uint32_t j = pieces[i]; j < pieces[i + 1]; j++) {
+      float p0[3], p1[3], p2[3];
+      load_position(position, indices[j*3], p0);
+      load_position(position, indices[j*3 + 1], p1);
+      load_position(position, indices[j*3 + 2], p2);
+      float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      float n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+      float triangleArea = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+      for(uint8_t k = 0; k < 3; k++) {
+        centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * triangleArea;
+        normal[k] += n[k];
+      }
+      area += triangleArea;
+    }
+    for(uint8_t k = 0; k < 3; k++) {
+      meshCentroid[k] += centroid[k];
+      centroids[i][k] = area > 0.0f ? centroid[k] / area : 0.0f;
+    }
+    meshArea += area;
+    float length = sqrtf(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+    for(uint8_t k = 0; k < 3; k++) normals[i][k] = length > 0.0f ? normal[k] / length : 0.0f;
+  }
+  for(uint8_t k = 0; k < 3; k++) meshCentroid[k] = meshArea > 0.0f ? meshCentroid[k] / meshArea : 0.0f;
+
+  OverdrawCluster* order = arena_alloc_array(arena, OverdrawCluster, pieceCount);
+  for(size_t i = 0; i < pieceCount; i++) {
+    float key = 0.0f;
+    for(uint8_t k = 0; k < 3; k++) key += (centroids[i][k] - meshCentroid[k])*normals[i][k];
+    order[i] = (OverdrawCluster){key, i};
+  }
+  qsort(order, pieceCount, sizeof(OverdrawCluster), compare_overdraw_clusters);
+
+  size_t outputLength = 0;
+  for(size_t i = 0; i < pieceCount; i++) {
+    uint32_t piece = order[i].cluster;
+    size_t length = (pieces[piece + 1] - pieces[piece])*3;
+    memcpy(destination + outputLength, indices + pieces[piece]*3, length*sizeof(uint32_t));
+    outputLength += length;
+  }
+  release_scratch_arena(scratch);
+}
+
+//------------------------------------------
+// Vertex fetch
+//------------------------------------------
+
+/* The new place of every vertex: the vertices the indices use in the order they first use them, then the unused ones in their old order.
+ * Returns how many vertices are used
+*/
+uint32_t optimize_vertex_fetch_remap(uint32_t* remap, const uint32_t* indices, size_t indexCount, uint32_t vertexCount) {
+  for(uint32_t i = 0; i < vertexCount; i++) remap[i] = UINT32_MAX;
+  uint32_t next = 0;
+  for(size_t i = 0; i < indexCount; i++) {
+    if(remap[indices[i]] == UINT32_MAX) remap[indices[i]] = next++;
+  }
+  uint32_t used = next;
+  for(uint32_t i = 0; i < vertexCount; i++) {
+    if(remap[i] == UINT32_MAX) remap[i] = next++;
+  }
+  return used;
+}
+
+void remap_indices(uint32_t* indices, size_t indexCount, const uint32_t* remap) {
+  for(size_t i = 0; i < indexCount; i++) indices[i] = remap[indices[i]];
+}
+
+// destination can't be vertices
+void remap_vertices(void* destination, const void* vertices, uint32_t vertexCount, size_t vertexStride, const uint32_t* remap) {
+  for(uint32_t i = 0; i < vertexCount; i++) memcpy((char*)destination + remap[i]*vertexStride, (const char*)vertices + i*vertexStride, vertexStride);
+}
+
+//------------------------------------------
+// Meshlet order
+//------------------------------------------
+
+/* build_meshlets writes the triangles of a meshlet in the order it grew, which isn't a good one for the vertex cache.
+ * The triangles of every meshlet are put back into Tipsify order on their own, with the vertices of the meshlet numbered
+ * 0..vertexCount so the per vertex arrays of the pass stay small. The meshlets don't move, only the triangles inside them
+*/
+void optimize_meshlet_vertex_cache(Arena* arena, uint32_t* indices, const Meshlet* meshlets, size_t meshletCount, uint32_t vertexCount, uint32_t cacheSize) {
+  ScratchArena scratch = create_scratch_arena(arena);
+  uint32_t* localIndex = arena_alloc_array(arena, uint32_t, vertexCount);
+  memset(localIndex, 0xFF, vertexCount*sizeof(uint32_t));
+  uint32_t globalIndex[MESHLET_MAX_VERTICES];
+  uint32_t local[MESHLET_MAX_TRIANGLES*3], reordered[MESHLET_MAX_TRIANGLES*3];
+  for(size_t i = 0; i < meshletCount; i++) {
+    uint32_t* meshletIndices = indices + meshlets[i].firstIndex;
+    size_t indexCount = meshlets[i].triangleCount*3;
+    uint32_t localCount = 0;
+    for(size_t j = 0; j < indexCount; j++) {
+      uint32_t vertex = meshletIndices[j];
+      if(localIndex[vertex] == UINT32_MAX) {
+        localIndex[vertex] = localCount;
+        globalIndex[localCount++] = vertex;
+      }
+      local[j] = localIndex[vertex];
+    }
+    optimize_vertex_cache(arena, reordered, local, indexCount, localCount, cacheSize);
+    for(size_t j = 0; j < indexCount; j++) meshletIndices[j] = globalIndex[reordered[j]];
+    for(uint32_t j = 0; j < localCount; j++) localIndex[globalIndex[j]] = UINT32_MAX;
+  }
+  release_scratch_arena(scratch);
+}
+
+//------------------------------------------
+// All passes
+//------------------------------------------
+
+typedef struct {
+  VertexCacheStats before;
+  VertexCacheStats after;
+  size_t meshletCount;
+} MeshOptimizeStats;
+
+static void read_mesh_indices(uint32_t* destination, const void* indices, size_t indexSize, size_t indexCount) {
+  if(indexSize == sizeof(uint16_t)) {
+    const uint16_t* shortIndices = indices;
+    for(size_t i = 0; i < indexCount; i++) destination[i] = shortIndices[i];
+  }
+  else memcpy(destination, indices, indexCount*sizeof(uint32_t));
+}
+
+/* Runs the three passes (when MESH_OPTIMIZATION is on) on a triangle list in place.
+ * indices are indexSize (2 or 4) bytes each and vertexData is the interleaved vertices that are moved with the remap.
+ * position is the float positions of the vertices in the order they have before the call, the overdraw order is decided on them.
+ * When meshlets isn't NULL (room for meshlet_count_bound(indexCount)) the triangles are grouped into meshlets before the
+ * vertex fetch remap, so the vertices of a meshlet end up next to each other too.
+ * The ACMR never ends up worse than the input's: when it would (the input was optimized before it was exported) the meshlets are
+ * built from the input order instead, and when even that is worse the input order is kept without meshlets.
+ * Lists that aren't whole triangles or use vertices that don't exist are left as they are, without meshlets
+*/
+MeshOptimizeStats optimize_mesh(Arena* arena, void* indices, size_t indexSize, size_t indexCount, void* vertexData, size_t vertexStride, uint32_t vertexCount, VertexStream position, Meshlet* meshlets) {
+  MeshOptimizeStats stats = {0};
+  if(!indexCount || indexCount % 3) return stats;
+  ScratchArena scratch = create_scratch_arena(arena);
+  uint32_t* source = arena_alloc_array(arena, uint32_t, indexCount);
+  uint32_t* result = arena_alloc_array(arena, uint32_t, indexCount);
+  read_mesh_indices(source, indices, indexSize, indexCount);
+  //the passes keep arrays per vertex, an index past the vertices (a broken file) would write outside them
+  for(size_t i = 0; i < indexCount; i++) {
+    if(source[i] < vertexCount) continue;
+    release_scratch_arena(scratch);
+    return stats;
+  }
+  stats.before = analyze_vertex_cache(arena, source, indexCount, vertexCount, MESH_OPTIMIZE_CACHE_SIZE);
+
+  if(MESH_OPTIMIZATION) {
+    optimize_vertex_cache(arena, result, source, indexCount, vertexCount, MESH_OPTIMIZE_CACHE_SIZE);
+    optimize_overdraw(arena, source, result, indexCount, position, vertexCount, MESH_OPTIMIZE_CACHE_SIZE, MESH_OPTIMIZE_OVERDRAW_THRESHOLD);
+  }
+  if(meshlets) {
+    stats.meshletCount = build_meshlets(arena, meshlets, result, source, indexCount, position, vertexCount);
+    memcpy(source, result, indexCount*sizeof(uint32_t));
+    if(MESH_OPTIMIZATION) optimize_meshlet_vertex_cache(arena, source, meshlets, stats.meshletCount, vertexCount, MESH_OPTIMIZE_CACHE_SIZE);
+  }
+
+  if(MESH_OPTIMIZATION && analyze_vertex_cache(arena, source, indexCount, vertexCount, MESH_OPTIMIZE_CACHE_SIZE).acmr > stats.before.acmr) {
+    read_mesh_indices(source, indices, indexSize, indexCount);
+    stats.meshletCount = 0;
+    if(meshlets) {
+      size_t meshletCount = build_meshlets(arena, meshlets, result, source, indexCount, position, vertexCount);
+      optimize_meshlet_vertex_cache(arena, result, meshlets, meshletCount, vertexCount, MESH_OPTIMIZE_CACHE_SIZE);
+      if(analyze_vertex_cache(arena, result, indexCount, vertexCount, MESH_OPTIMIZE_CACHE_SIZE).acmr <= stats.before.acmr) {
+        memcpy(source, result, indexCount*sizeof(uint32_t));
+        stats.meshletCount = meshletCount;
+      }
+    }
+  }
+
+  if(MESH_OPTIMIZATION) {
+    uint32_t* remap = arena_alloc_array(arena, uint32_t, vertexCount);
+    optimize_vertex_fetch_remap(remap, source, indexCount, vertexCount);
+    remap_indices(source, indexCount, remap);
+    void* vertexCopy = arena_alloc(arena, vertexCount*vertexStride);
+    memcpy(vertexCopy, vertexData, vertexCount*vertexStride);
+    remap_vertices(vertexData, vertexCopy, vertexCount, vertexStride, remap);
+  }
+  stats.after = analyze_vertex_cache(arena, source, indexCount, vertexCount, MESH_OPTIMIZE_CACHE_SIZE);
+
+  if(indexSize == sizeof(uint16_t)) {
+    uint16_t* shortIndices = indices;
+    for(size_t i = 0; i < indexCount; i++) shortIndices[i] = source[i];
+  }
+  else memcpy(indices, source, indexCount*sizeof(uint32_t));
+  release_scratch_arena(scratch);
+  return stats;
+}
+
+#endif
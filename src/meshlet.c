@@ -0,0 +1,309 @@
+#ifndef MESHLET_IMPL
+#define MESHLET_IMPL
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "data_types/arena.c"
+#include "data_types/string.c"
+#include "vertex_pack.c"
+
+/* Meshlets are small groups of the triangles of a mesh with their own bounds, so the parts of a large mesh that can't be seen
+ * are skipped instead of drawing the whole mesh: a bounding sphere (and box) for the frustum and a cone around the directions
+ * the triangles face, a meshlet whose triangles all face away from the camera is culled like a back face is.
+ * The triangles of a meshlet are a range of the index buffer and keep indexing the whole vertex buffer, a meshlet is drawn as an
+ * index range with the usual vertex pipeline. The limits are the ones mesh shaders are usually built for, so the same meshlets
+ * can be given to a mesh shader later
+*/
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+/* Triangles are picked by how close they are to the meshlet, scaled by 1 + weight * (1 - dot(normal, meshlet normal)) so the
+ * triangles of a meshlet also face about the same way and its cone culls more often. Larger weights trade frustum culling for cone culling
+*/
+#ifndef MESHLET_CONE_WEIGHT
+#define MESHLET_CONE_WEIGHT 1.0f
+#endif
+
+// A cone with triangles that face further apart than this (about 84 degrees from the axis) would almost never cull anything
+#define MESHLET_CONE_MIN_DOT 0.1f
+
+typedef struct {
+  uint32_t firstIndex; // the triangles are indices[firstIndex..firstIndex + triangleCount*3]
+  uint32_t triangleCount;
+  uint32_t vertexCount;
+  float center[3]; // bounding sphere
+  float radius;
+  float boundsMin[3];
+  float boundsMax[3];
+  /* Every triangle faces away from a camera for which dot(normalize(coneApex - camera), coneAxis) > coneCutoff.
+   * coneCutoff is 1 when the triangles face too many ways, nothing passes the test then
+  */
+  float coneApex[3];
+  float coneAxis[3];
+  float coneCutoff;
+} Meshlet;
+
+/* How many meshlets build_meshlets can write for indexCount indices at most.
+ * A meshlet is only closed when it's full or a triangle with at most 3 new vertices doesn't fit, so every meshlet but the
+ * last has at least MESHLET_MAX_VERTICES - 2 vertices, which take at least as many indices
+*/
+static inline size_t meshlet_count_bound(size_t indexCount) { return indexCount / (MESHLET_MAX_VERTICES - 2) + 1; }
+
+/* canonical[v] is the first vertex with the same position as v. Triangles that only share a position (across a uv or
+ * normal seam) are neighbours for the meshlets even though they don't share a vertex
+*/
+static void meshlet_position_classes(Arena* arena, uint32_t* canonical, VertexStream position, uint32_t vertexCount) {
+  ScratchArena scratch = create_scratch_arena(arena);
+  size_t tableSize = 1;
+  while(tableSize < (size_t)vertexCount*2) tableSize <<= 1;
+  uint32_t* table = arena_alloc_array(arena, uint32_t, tableSize);
+  memset(table, 0xff, tableSize*sizeof(uint32_t));
+  for(uint32_t i = 0; i < vertexCount; i++) {
+    float p[3];
+    load_position(position, i, p);
+    size_t slot = wyhash(p, sizeof(p), 0) & (tableSize - 1);
+    while(table[slot] != UINT32_MAX) {
+      float other[3];
+      load_position(position, table[slot], other);
+      if(!memcmp(p, other, sizeof(p))) break;
+      slot = (slot + 1) & (tableSize - 1);
+    }
+    if(table[slot] == UINT32_MAX) table[slot] = i;
+    canonical[i] = table[slot];
+  }
+  release_scratch_arena(scratch);
+}
+
+static void compute_meshlet_bounds(Meshlet* meshlet, const uint32_t* indices, VertexStream position) {
+  const uint32_t* triangles = indices + meshlet->firstIndex;
+  size_t indexCount = meshlet->triangleCount*3;
+  for(uint8_t k = 0; k < 3; k++) {
+    meshlet->boundsMin[k] = FLT_MAX;
+    meshlet->boundsMax[k] = -FLT_MAX;
+  }
+  for(size_t i = 0; i < indexCount; i++) {
+    float p[3];
+    load_position(position, triangles[i], p);
+    for(uint8_t k = 0; k < 3; k++) {
+      meshlet->boundsMin[k] = fminf(meshlet->boundsMin[k], p[k]);
+      meshlet->boundsMax[k] = fmaxf(meshlet->boundsMax[k], p[k]);
+    }
+  }
+  //the sphere is around the center of the box, it's a little bigger than the smallest one but never far off for a compact meshlet
+  float radius = 0.0f;
+  for(uint8_t k = 0; k < 3; k++) meshlet->center[k] = (meshlet->boundsMin[k] + meshlet->boundsMax[k])*0.5f;
+  for(size_t i = 0; i < indexCount; i++) {
+    float p[3];
+    load_position(position, triangles[i], p);
+    float dx = p[0] - meshlet->center[0], dy = p[1] - meshlet->center[1], dz = p[2] - meshlet->center[2];
+    radius = fmaxf(radius, dx*dx + dy*dy + dz*dz);
+  }
+  meshlet->radius = sqrtf(radius);
+
+  //the axis is the average of the unit normals, zero area triangles are never drawn and don't count
+  float normals[MESHLET_MAX_TRIANGLES][3];
+  float centroids[MESHLET_MAX_TRIANGLES][3];
+  uint32_t normalCount = 0;
+  float axis[3] = {0.0f, 0.0f, 0.0f};
+  for(uint32_t i = 0; i < meshlet->triangleCount; i++) {
+    float p0[3], p1[3], p2[3];
+    load_position(position, triangles[i*3], p0);
+    load_position(position, triangles[i*3 + 1], p1);
+    load_position(position, triangles[i*3 + 2], p2);
+    float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    float n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+    float length = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    if(length == 0.0f) continue;
+    for(uint8_t k = 0; k < 3; k++) {
+      normals[normalCount][k] = n[k] / length;
+      centroids[normalCount][k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+      axis[k] += normals[normalCount][k];
+    }
+    normalCount++;
+  }
+  float axisLength = sqrtf(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+  float minDot = 1.0f;
+  for(uint8_t k = 0; k < 3; k++) axis[k] = axisLength > 0.0f ? axis[k] / axisLength : 0.0f;
+  for(uint32_t i = 0; i < normalCount; i++) minDot = fminf(minDot, axis[0]*normals[i][0] + axis[1]*normals[i][1] + axis[2]*normals[i][2]);
+
+  memcpy(meshlet->coneApex, meshlet->center, sizeof(meshlet->coneApex));
+  memcpy(meshlet->coneAxis, axis, sizeof(meshlet->coneAxis));
+  meshlet->coneCutoff = 1.0f;
+  if(!normalCount || axisLength == 0.0f || minDot <= MESHLET_CONE_MIN_DOT) return;
+
+  /* The apex is moved back along the axis until it's behind the plane of every triangle. A camera inside the cone (opening away
+   * from the axis with the half angle acos(cutoff)) then looks at every triangle from behind its plane
+  */
+  float offset = 0.0f;
+  for(uint32_t i = 0; i < normalCount; i++) {
+    float toCenter = 0.0f, axisDot = 0.0f;
+    for(uint8_t k = 0; k < 3; k++) {
+      toCenter += (meshlet->center[k] - centroids[i][k])*normals[i][k];
+      axisDot += axis[k]*normals[i][k];
+    }
+    offset = fmaxf(offset, toCenter / axisDot);
+  }
+  for(uint8_t k = 0; k < 3; k++) meshlet->coneApex[k] = meshlet->center[k] - axis[k]*offset;
+  meshlet->coneCutoff = sqrtf(1.0f - minDot*minDot);
+}
+
+/* Groups the triangles into meshlets, the triangles are written to destination (which can't be indices) in meshlet order and
+ * the meshlets (at most meshlet_count_bound) to meshlets. Returns how many meshlets there are, every index has to be below vertexCount.
+ * A meshlet grows by the triangle next to it that adds the fewest vertices, on a tie the one closest to the center of its vertices
+ * (and facing its way, MESHLET_CONE_WEIGHT) so it stays round and its sphere small. When nothing is next to it the next triangle in
+ * the order of indices starts the meshlet. The triangles of a meshlet are written in the order it grew, which is bad for the vertex cache,
+ * optimize_meshlet_vertex_cache puts them in a cache order again
+*/
+size_t build_meshlets(Arena* arena, Meshlet* meshlets, uint32_t* destination, const uint32_t* indices, size_t indexCount, VertexStream position, uint32_t vertexCount) {
+  size_t triangleCount = indexCount/3;
+  if(!triangleCount) return 0;
+  ScratchArena scratch = create_scratch_arena(arena);
+
+  //the triangles around every position, the triangles of position v are adjacency[offsets[v]..offsets[v + 1]]
+  uint32_t* canonical = arena_alloc_array(arena, uint32_t, vertexCount);
+  meshlet_position_classes(arena, canonical, position, vertexCount);
+  uint32_t* offsets = arena_alloc_array(arena, uint32_t, vertexCount + 1);
+  uint32_t* adjacency = arena_alloc_array(arena, uint32_t, triangleCount*3);
+  memset(offsets, 0, (vertexCount + 1)*sizeof(uint32_t));
+  for(size_t i = 0; i < triangleCount*3; i++) offsets[canonical[indices[i]] + 1]++;
+  for(uint32_t i = 0; i < vertexCount; i++) offsets[i + 1] += offsets[i];
+  uint32_t* fill = arena_alloc_array(arena, uint32_t, vertexCount);
+  memcpy(fill, offsets, vertexCount*sizeof(uint32_t));
+  for(size_t i = 0; i < triangleCount*3; i++) adjacency[fill[canonical[indices[i]]]++] = i/3;
+
+  //both are the number of the meshlet plus one for what is in the meshlet that is being built
+  uint32_t* vertexMeshlet = arena_alloc_array(arena, uint32_t, vertexCount);
+  uint32_t* candidateMeshlet = arena_alloc_array(arena, uint32_t, triangleCount);
+  memset(vertexMeshlet, 0, vertexCount*sizeof(uint32_t));
+  memset(candidateMeshlet, 0, triangleCount*sizeof(uint32_t));
+  bool* emitted = arena_alloc_array(arena, bool, triangleCount);
+  memset(emitted, 0, triangleCount*sizeof(bool));
+  uint32_t* candidates = arena_alloc_array(arena, uint32_t, triangleCount);
+  size_t candidateCount = 0;
+  float (*centroids)[3] = arena_alloc_array(arena, float[3], triangleCount);
+  float (*normals)[3] = arena_alloc_array(arena, float[3], triangleCount);
+  for(size_t i = 0; i < triangleCount; i++) {
+    float p0[3], p1[3], p2[3];
+    load_position(position, indices[i*3], p0);
+    load_position(position, indices[i*3 + 1], p1);
+    load_position(position, indices[i*3 + 2], p2);
+    float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    float n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+    float length = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    for(uint8_t k = 0; k < 3; k++) {
+      centroids[i][k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+      normals[i][k] = length > 0.0f ? n[k] / length : 0.0f;
+    }
+  }
+  size_t cursor = 0;
+  size_t outputLength = 0;
+
+  size_t meshletCount = 0;
+  Meshlet* meshlet = &meshlets[0];
+  *meshlet = (Meshlet){0};
+  float vertexSum[3] = {0.0f, 0.0f, 0.0f};
+  float normalSum[3] = {0.0f, 0.0f, 0.0f};
+  for(size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+    uint32_t stamp = meshletCount + 1;
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    for(uint8_t k = 0; k < 3 && meshlet->vertexCount; k++) center[k] = vertexSum[k] / meshlet->vertexCount;
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    float normalLength = sqrtf(normalSum[0]*normalSum[0] + normalSum[1]*normalSum[1] + normalSum[2]*normalSum[2]);
+    for(uint8_t k = 0; k < 3 && normalLength > 0.0f; k++) axis[k] = normalSum[k] / normalLength;
+
+    int64_t best = -1;
+    uint32_t bestNew = 4;
+    float bestDistance = FLT_MAX;
+    size_t live = 0;
+    for(size_t i = 0; i < candidateCount; i++) {
+      uint32_t triangle = candidates[i];
+      if(emitted[triangle]) continue;
+      candidates[live++] = triangle;
+      const uint32_t* v = indices + triangle*3;
+      uint32_t newVertices = (vertexMeshlet[v[0]] != stamp) + (vertexMeshlet[v[1]] != stamp && v[1] != v[0]) +
+        (vertexMeshlet[v[2]] != stamp && v[2] != v[0] && v[2] != v[1]);
+      if(newVertices > bestNew) continue;
+      float distance = 0.0f, spread = 1.0f;
+      for(uint8_t k = 0; k < 3; k++) {
+        float d = centroids[triangle][k] - center[k];
+        distance += d*d;
+        spread -= normals[triangle][k]*axis[k];
+      }
+      distance *= 1.0f + MESHLET_CONE_WEIGHT*spread;
+      //candidates are in the order they were found, the triangle index decides between equal ones
+      if(newVertices < bestNew || distance < bestDistance || (distance == bestDistance && triangle < best)) {
+        best = triangle;
+        bestNew = newVertices;
+        bestDistance = distance;
+      }
+    }
+    candidateCount = live;
+    if(best < 0) {
+      while(emitted[cursor]) cursor++;
+      best = cursor;
+      const uint32_t* v = indices + best*3;
+      bestNew = (vertexMeshlet[v[0]] != stamp) + (vertexMeshlet[v[1]] != stamp && v[1] != v[0]) +
+        (vertexMeshlet[v[2]] != stamp && v[2] != v[0] && v[2] != v[1]);
+    }
+
+    if(meshlet->triangleCount == MESHLET_MAX_TRIANGLES || meshlet->vertexCount + bestNew > MESHLET_MAX_VERTICES) {
+      compute_meshlet_bounds(meshlet, destination, position);
+      meshlet = &meshlets[++meshletCount];
+      *meshlet = (Meshlet){.firstIndex=outputLength};
+      memset(vertexSum, 0, sizeof(vertexSum));
+      memset(normalSum, 0, sizeof(normalSum));
+      //the triangle that didn't fit starts the next meshlet, it's next to the last one
+      stamp = meshletCount + 1;
+      candidateCount = 0;
+    }
+
+    emitted[best] = true;
+    meshlet->triangleCount++;
+    for(uint8_t k = 0; k < 3; k++) normalSum[k] += normals[best][k];
+    for(uint8_t j = 0; j < 3; j++) {
+      uint32_t vertex = indices[best*3 + j];
+      destination[outputLength++] = vertex;
+      if(vertexMeshlet[vertex] != stamp) {
+        vertexMeshlet[vertex] = stamp;
+        meshlet->vertexCount++;
+        float p[3];
+        load_position(position, vertex, p);
+        for(uint8_t k = 0; k < 3; k++) vertexSum[k] += p[k];
+      }
+      uint32_t around = canonical[vertex];
+      for(uint32_t i = offsets[around]; i < offsets[around + 1]; i++) {
+        uint32_t triangle = adjacency[i];
+        if(emitted[triangle] || candidateMeshlet[triangle] == stamp) continue;
+        candidateMeshlet[triangle] = stamp;
+        candidates[candidateCount++] = triangle;
+      }
+    }
+  }
+  compute_meshlet_bounds(meshlet, destination, position);
+  release_scratch_arena(scratch);
+  return meshletCount + 1;
+}
+
+/* False when the meshlet is outside one of the planes (a, b, c, d with a normalized a, b, c, inside is a*x + b*y + c*z + d >= 0)
+ * or when it only has back faces from cameraPosition. Everything is in the space of the mesh, cameraPosition can be NULL to skip the cone
+*/
+bool meshlet_visible(const Meshlet* meshlet, float planes[6][4], const float* cameraPosition) {
+  for(uint8_t i = 0; i < 6; i++) {
+    float distance = planes[i][0]*meshlet->center[0] + planes[i][1]*meshlet->center[1] + planes[i][2]*meshlet->center[2] + planes[i][3];
+    if(distance < -meshlet->radius) return false;
+  }
+  if(!cameraPosition) return true;
+  float direction[3] = {meshlet->coneApex[0] - cameraPosition[0], meshlet->coneApex[1] - cameraPosition[1], meshlet->coneApex[2] - cameraPosition[2]};
+  float length = sqrtf(direction[0]*direction[0] + direction[1]*direction[1] + direction[2]*direction[2]);
+  float axisDot = direction[0]*meshlet->coneAxis[0] + direction[1]*meshlet->coneAxis[1] + direction[2]*meshlet->coneAxis[2];
+  return axisDot <= meshlet->coneCutoff*length;
+}
+
+#endif
@@ -7,9 +7,11 @@
 #include "data_types/string.c"
 
 #include "data_types/io.c"
+#include "data_types/jobs.c"
+#include "data_types/memory_stats.c"
 
-GLuint create_texture(const char* filename) {
-  //texture
+// An empty 2D texture with the default sampling, the image can be uploaded into it later
+GLuint generate_texture(void) {
   GLuint texture;
   glGenTextures(1, &texture);
   glBindTexture(GL_TEXTURE_2D, texture);
@@ -17,21 +19,144 @@ GLuint create_texture(const char* filename) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
 
+static void upload_texture_rgba(GLuint texture, const unsigned char* texData, int width, int height) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  //the mip chain adds about a third on top of the base level
+  memory_track_alloc(MEMORY_TAG_GL_TEXTURE, (size_t)width * height * 4 * 4 / 3);
+}
+
+// Decodes an encoded image (png, jpg...) that is already in memory into texture, false (with stbi_failure_reason) when it can't be decoded
+bool load_texture_from_memory(GLuint texture, const void* data, size_t len) {
   int width, height, nrChannels;
-  unsigned char* texData = stbi_load(filename, &width, &height, &nrChannels, STBI_rgb_alpha);
-  if(texData) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
-  else {
-    printf("Failed to load Image");
+  unsigned char* texData = stbi_load_from_memory(data, len, &width, &height, &nrChannels, STBI_rgb_alpha);
+  if(!texData) return false;
+  upload_texture_rgba(texture, texData, width, height);
+  stbi_image_free(texData);
+  return true;
+}
+
+GLuint create_texture_from_memory(const void* data, size_t len) {
+  GLuint texture = generate_texture();
+  if(!load_texture_from_memory(texture, data, len)) {
+    fprintf(stderr, "Failed to decode an image (%s)\n", stbi_failure_reason());
+    fflush(stderr);
   }
+  return texture;
+}
+
+GLuint create_texture(const char* filename) {
+  GLuint texture = generate_texture();
+  int width, height, nrChannels;
+  unsigned char* texData = stbi_load(filename, &width, &height, &nrChannels, STBI_rgb_alpha);
+  if(texData) upload_texture_rgba(texture, texData, width, height);
+  else printf("Failed to load Image");
   stbi_image_free(texData);
-  glBindTexture(GL_TEXTURE_2D, 0);
   return texture;
 }
 
+//------------------------------------------
+// Texture Decode Queue
+//------------------------------------------
+
+/* Decodes images on the job system and uploads them on the GL thread.
+ * Every submitted image is decoded by a job, finished images are pushed onto a lock free list that the GL thread takes
+ * whole and uploads in the order the decodes completed. Encoded data passed to texture_decode_submit is owned (and freed) by the queue,
+ * texture_decode_submit_borrowed decodes from memory the caller keeps alive (a file mapping) until texture_decode_wait.
+ * Without a job system (or from a thread outside of it) the image is decoded right away on the calling thread
+*/
+typedef struct TextureDecode TextureDecode;
+typedef struct TextureDecodeQueue TextureDecodeQueue;
+
+struct TextureDecode {
+  TextureDecodeQueue* queue;
+  GLuint texture;
+  const unsigned char* encoded;
+  size_t encodedLen;
+  bool ownsEncoded;
+  unsigned char* pixels;
+  int width;
+  int height;
+  //stb_image keeps the reason per thread, it's copied out on the thread that decoded
+  const char* failureReason;
+  TextureDecode* next;
+};
+
+struct TextureDecodeQueue {
+  Arena* arena;
+  _Atomic(TextureDecode*) finished;
+  size_t pending;
+};
+
+TextureDecodeQueue create_texture_decode_queue(Arena* arena) { return (TextureDecodeQueue){.arena=arena}; }
+
+static void texture_decode_job(void* data) {
+  TextureDecode* decode = data;
+  int nrChannels;
+  decode->pixels = stbi_load_from_memory(decode->encoded, decode->encodedLen, &decode->width, &decode->height, &nrChannels, STBI_rgb_alpha);
+  if(!decode->pixels) decode->failureReason = stbi_failure_reason();
+  if(decode->ownsEncoded) free((void*)decode->encoded);
+  decode->encoded = NULL;
+
+  TextureDecode* head = atomic_load_explicit(&decode->queue->finished, memory_order_relaxed);
+  do decode->next = head;
+  while(!atomic_compare_exchange_weak_explicit(&decode->queue->finished, &head, decode, memory_order_release, memory_order_relaxed));
+}
+
+static void texture_decode_push(TextureDecodeQueue* queue, GLuint texture, const unsigned char* encoded, size_t len, bool ownsEncoded) {
+  TextureDecode* decode = arena_alloc_struct(queue->arena, TextureDecode);
+  *decode = (TextureDecode){.queue=queue, .texture=texture, .encoded=encoded, .encodedLen=len, .ownsEncoded=ownsEncoded};
+  queue->pending++;
+  if(job_worker_index() < job_worker_count()) run_job(texture_decode_job, decode, NULL);
+  else texture_decode_job(decode);
+}
+
+// Decodes the encoded image (png, jpg...) into texture, encoded has to be malloc'd and is freed by the queue
+void texture_decode_submit(TextureDecodeQueue* queue, GLuint texture, unsigned char* encoded, size_t len) { texture_decode_push(queue, texture, encoded, len, true); }
+
+// Decodes the encoded image into texture without taking it, encoded has to stay valid until texture_decode_wait returns
+void texture_decode_submit_borrowed(TextureDecodeQueue* queue, GLuint texture, const unsigned char* encoded, size_t len) { texture_decode_push(queue, texture, encoded, len, false); }
+
+// Uploads every image that has been decoded so far, returns how many were uploaded
+size_t texture_decode_upload_finished(TextureDecodeQueue* queue) {
+  TextureDecode* decode = atomic_exchange_explicit(&queue->finished, NULL, memory_order_acquire);
+  //the list is newest first
+  TextureDecode* ordered = NULL;
+  while(decode) {
+    TextureDecode* next = decode->next;
+    decode->next = ordered;
+    ordered = decode;
+    decode = next;
+  }
+
+  size_t uploaded = 0;
+  for(decode = ordered; decode; decode = decode->next, uploaded++) {
+    if(decode->pixels) upload_texture_rgba(decode->texture, decode->pixels, decode->width, decode->height);
+    else {
+      fprintf(stderr, "Failed to decode the image of texture %u (%s)\n", decode->texture, decode->failureReason);
+      fflush(stderr);
+    }
+    stbi_image_free(decode->pixels);
+    decode->pixels = NULL;
+  }
+  queue->pending -= uploaded;
+  return uploaded;
+}
+
+// Helps decoding and uploads the images until every submitted image is uploaded
+void texture_decode_wait(TextureDecodeQueue* queue) {
+  while(queue->pending) {
+    if(texture_decode_upload_finished(queue)) continue;
+    if(!run_queued_job()) sched_yield();
+  }
+}
+
 GLuint create_cubeMap(const char** const filenames) {
  unsigned int textureID;
   glGenTextures(1, &textureID);
@@ -42,6 +167,7 @@ GLuint create_cubeMap(const char** const filenames) {
   {
     data = stbi_load(filenames[i], &width, &height, &nrChannels, 4);
     glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    memory_track_alloc(MEMORY_TAG_GL_TEXTURE, (size_t)width * height * 4);
   }
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
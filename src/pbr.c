@@ -15,12 +15,39 @@ Texture pbrBrdfLUT;
 Texture preFilterMap;
 Texture irradianceMap;
 
+//uniform names are interned once in setup_pbr
+static struct {
+  InternedString albedoMap;
+  InternedString normalMap;
+  InternedString roughnessMetallicMap;
+  InternedString emissiveMap;
+  InternedString metallicFactor;
+  InternedString roughnessFactor;
+  InternedString albedoFactor;
+  InternedString emissiveFactor;
+  InternedString prefilterMap;
+  InternedString irradianceMap;
+  InternedString brdfLUT;
+} pbrUniforms;
+
 void setup_pbr(Arena* arena, Texture skybox) {
+  pbrUniforms.albedoMap = intern_string_literal("albedoMap");
+  pbrUniforms.normalMap = intern_string_literal("normalMap");
+  pbrUniforms.roughnessMetallicMap = intern_string_literal("roughnessMetallicMap");
+  pbrUniforms.emissiveMap = intern_string_literal("emissiveMap");
+  pbrUniforms.metallicFactor = intern_string_literal("metallicFactor");
+  pbrUniforms.roughnessFactor = intern_string_literal("roughnessFactor");
+  pbrUniforms.albedoFactor = intern_string_literal("albedoFactor");
+  pbrUniforms.emissiveFactor = intern_string_literal("emissiveFactor");
+  pbrUniforms.prefilterMap = intern_string_literal("prefilterMap");
+  pbrUniforms.irradianceMap = intern_string_literal("irradianceMap");
+  pbrUniforms.brdfLUT = intern_string_literal("brdfLUT");
+
   //pbrBrdfLUT
-  pbrBrdfLUT = create_texture("res/PBR/pbrBrdf.png");
+  pbrBrdfLUT = acquire_texture_literal("res/PBR/pbrBrdf.png");
 
   //preFilter
-  ShaderProgram preFilterShaderProgram = create_shader_program();
+  ShaderProgram preFilterShaderProgram = create_shader_program(arena);
   attach_shader_to_program(arena, &preFilterShaderProgram, GL_VERTEX_SHADER, create_string_from_literal("res/shader/skyboxVertex.glsl"));
   attach_shader_to_program(arena, &preFilterShaderProgram, GL_FRAGMENT_SHADER, create_string_from_literal("res/shader/prefilter.glsl"));
   finalize_shader_program(&preFilterShaderProgram);
@@ -29,7 +56,7 @@ void setup_pbr(Arena* arena, Texture skybox) {
   preFilterMap = create_reflection_probe_env_mip_map(128, skybox, &preFilterMaterial, 5);
 
   //irradiance map
-  ShaderProgram irradianceShaderProgram = create_shader_program();
+  ShaderProgram irradianceShaderProgram = create_shader_program(arena);
   attach_shader_to_program(arena, &irradianceShaderProgram, GL_VERTEX_SHADER, create_string_from_literal("res/shader/skyboxVertex.glsl"));
   attach_shader_to_program(arena, &irradianceShaderProgram, GL_FRAGMENT_SHADER, create_string_from_literal("res/shader/irradiance.glsl"));
   finalize_shader_program(&irradianceShaderProgram);
@@ -38,7 +65,7 @@ void setup_pbr(Arena* arena, Texture skybox) {
   irradianceMap = create_reflection_probe_env(128, skybox, &irradianceMaterial);
 
   //pbr shader
-  pbrShaderProgram = create_shader_program();
+  pbrShaderProgram = create_shader_program(arena);
   attach_shader_to_program(arena, &pbrShaderProgram, GL_VERTEX_SHADER, create_string_from_literal("res/shader/vertex.glsl"));
   attach_shader_to_program(arena, &pbrShaderProgram, GL_FRAGMENT_SHADER, create_string_from_literal("res/shader/fragment.glsl"));
   finalize_shader_program(&pbrShaderProgram);
@@ -46,19 +73,19 @@ void setup_pbr(Arena* arena, Texture skybox) {
 
 Material create_pbr_material_values(Arena* arena, vec3 albedo, float roughness, float metallic, vec3 emissive) {
   Material pbrMaterial = create_material(arena, &pbrShaderProgram);
-  material_set_texture(&pbrMaterial, create_string_from_literal("albedoMap"), whiteTexture);
-  //material_set_texture(&pbrMaterial, create_string_from_literal("normalMap"), whiteTexture);
-  material_set_texture(&pbrMaterial, create_string_from_literal("roughnessMetallicMap"), whiteTexture);
-  material_set_texture(&pbrMaterial, create_string_from_literal("emissiveMap"), whiteTexture);
+  material_set_texture(&pbrMaterial, pbrUniforms.albedoMap, whiteTexture);
+  //material_set_texture(&pbrMaterial, pbrUniforms.normalMap, whiteTexture);
+  material_set_texture(&pbrMaterial, pbrUniforms.roughnessMetallicMap, whiteTexture);
+  material_set_texture(&pbrMaterial, pbrUniforms.emissiveMap, whiteTexture);
 
-  material_set_float(&pbrMaterial, create_string_from_literal("metallicFactor"), metallic);
-  material_set_float(&pbrMaterial, create_string_from_literal("roughnessFactor"), roughness);
-  material_set_vec3(&pbrMaterial, create_string_from_literal("albedoFactor"), albedo);
-  material_set_vec3(&pbrMaterial, create_string_from_literal("emissiveFactor"), emissive);
+  material_set_float(&pbrMaterial, pbrUniforms.metallicFactor, metallic);
+  material_set_float(&pbrMaterial, pbrUniforms.roughnessFactor, roughness);
+  material_set_vec3(&pbrMaterial, pbrUniforms.albedoFactor, albedo);
+  material_set_vec3(&pbrMaterial, pbrUniforms.emissiveFactor, emissive);
 
-  material_set_texture(&pbrMaterial, create_string_from_literal("prefilterMap"), preFilterMap);
-  material_set_texture(&pbrMaterial, create_string_from_literal("irradianceMap"), irradianceMap);
-  material_set_texture(&pbrMaterial, create_string_from_literal("brdfLUT"), pbrBrdfLUT);
+  material_set_texture(&pbrMaterial, pbrUniforms.prefilterMap, preFilterMap);
+  material_set_texture(&pbrMaterial, pbrUniforms.irradianceMap, irradianceMap);
+  material_set_texture(&pbrMaterial, pbrUniforms.brdfLUT, pbrBrdfLUT);
 
   return pbrMaterial;
 }
@@ -66,19 +93,19 @@ Material create_pbr_material_values(Arena* arena, vec3 albedo, float roughness,
 Material create_pbr_material_textured(Arena* arena, Texture albedoMap, Texture roughnessMetallicMap, Texture normalMap, Texture emissiveMap) {
   vec3 white_vec = {1.0, 1.0, 1.0};
   Material pbrMaterial = create_material(arena, &pbrShaderProgram);
-  material_set_texture(&pbrMaterial, create_string_from_literal("albedoMap"), albedoMap);
-  //material_set_texture(&pbrMaterial, create_string_from_literal("normalMap"), normalMap);
-  material_set_texture(&pbrMaterial, create_string_from_literal("roughnessMetallicMap"), roughnessMetallicMap);
-  material_set_texture(&pbrMaterial, create_string_from_literal("emissiveMap"), emissiveMap);
+  material_set_texture(&pbrMaterial, pbrUniforms.albedoMap, albedoMap);
+  //material_set_texture(&pbrMaterial, pbrUniforms.normalMap, normalMap);
+  material_set_texture(&pbrMaterial, pbrUniforms.roughnessMetallicMap, roughnessMetallicMap);
+  material_set_texture(&pbrMaterial, pbrUniforms.emissiveMap, emissiveMap);
   
-  material_set_float(&pbrMaterial, create_string_from_literal("metallicFactor"), 1.0);
-  material_set_float(&pbrMaterial, create_string_from_literal("roughnessFactor"), 1.0);
-  material_set_vec3(&pbrMaterial, create_string_from_literal("albedoFactor"), white_vec);
-  material_set_vec3(&pbrMaterial, create_string_from_literal("emissiveFactor"), white_vec);
-
-  material_set_texture(&pbrMaterial, create_string_from_literal("prefilterMap"), preFilterMap);
-  material_set_texture(&pbrMaterial, create_string_from_literal("irradianceMap"), irradianceMap);
-  material_set_texture(&pbrMaterial, create_string_from_literal("brdfLUT"), pbrBrdfLUT);
+  material_set_float(&pbrMaterial, pbrUniforms.metallicFactor, 1.0);
+  material_set_float(&pbrMaterial, pbrUniforms.roughnessFactor, 1.0);
+  material_set_vec3(&pbrMaterial, pbrUniforms.albedoFactor, white_vec);
+  material_set_vec3(&pbrMaterial, pbrUniforms.emissiveFactor, white_vec);
+
+  material_set_texture(&pbrMaterial, pbrUniforms.prefilterMap, preFilterMap);
+  material_set_texture(&pbrMaterial, pbrUniforms.irradianceMap, irradianceMap);
+  material_set_texture(&pbrMaterial, pbrUniforms.brdfLUT, pbrBrdfLUT);
 
   return pbrMaterial;
 }
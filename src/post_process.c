@@ -3,11 +3,12 @@
 
 #include "data_types/array.c"
 #include "data_types/string.c"
+#include "data_types/memory_stats.c"
 #include "material.c"
 #include "shader_type.c"
 #include "scene_define.c"
 
-DEFINE_DYNAMIC_ARRAY(Material)
+DEFINE_SMALL_ARRAY(Material, 4)
 
 static uint16_t previousFrameWidth;
 static uint16_t previousFrameHeight;
@@ -33,9 +34,15 @@ void setup_post_process(uint16_t width, uint16_t height) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+
+  //2 RGBA16F textures
+  memory_track_alloc(MEMORY_TAG_GL_TEXTURE, (size_t)width * height * 8);
+  memory_track_alloc(MEMORY_TAG_GL_TEXTURE, (size_t)width * height * 8);
 }
 
 void resize_textures(uint16_t newFrameWidth, uint16_t newFrameHeight) {
+  memory_track_free(MEMORY_TAG_GL_TEXTURE, (size_t)previousFrameWidth * previousFrameHeight * 8 * 2);
+  memory_track_alloc(MEMORY_TAG_GL_TEXTURE, (size_t)newFrameWidth * newFrameHeight * 8 * 2);
   previousFrameWidth = newFrameWidth;
   previousFrameHeight = newFrameHeight;
 
@@ -46,7 +53,7 @@ void resize_textures(uint16_t newFrameWidth, uint16_t newFrameHeight) {
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, previousFrameWidth, previousFrameHeight, 0, GL_RGBA, GL_FLOAT, NULL);
 }
 
-Texture post_process(DynamicArray(Material)* postProcessList, Texture frameTexture, uint16_t frameWidth, uint16_t frameHeight) {
+Texture post_process(SmallArray(Material)* postProcessList, Texture frameTexture, uint16_t frameWidth, uint16_t frameHeight) {
   Texture inputTexture = frameTexture;
   Texture outputTexture = texture1;
 
@@ -55,10 +62,10 @@ Texture post_process(DynamicArray(Material)* postProcessList, Texture frameTextu
   }
 
   for(size_t i = 0; i < postProcessList->length; i++) {
-    Material* material = dynamic_array_index(Material, postProcessList, i);
+    Material* material = small_array_index(Material, postProcessList, i);
     glUseProgram(material->shaderProgram->id);
-    //material_set_texture(material, create_string_from_literal("inputImage"), frameTexture);
-    //material_set_texture(material, create_string_from_literal("outputImage"), outputTexture);
+    //material_set_texture(material, intern_string_literal("inputImage"), frameTexture);
+    //material_set_texture(material, intern_string_literal("outputImage"), outputTexture);
     //material_push_uniform_values(material);
 
     glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
@@ -8,11 +8,14 @@
 
 #include <stdint.h>
 
+#include "data_types/arena.c"
 #include "data_types/string.c"
 #include "material.c"
 #include "scene_define.c"
+#include "vertex_pack.c"
 #include "environment_map.c"
 #include "shader.c"
+#include "frame_allocator.c"
 
 static GLuint quadVAO;
 static Material quadMaterial;
@@ -20,7 +23,33 @@ static ShaderProgram quadShader;
 
 static mat4 projectionMatrix;
 
+// Build with -DMESHLET_CULLING=0 to draw every mesh whole instead of only the meshlets that can be seen
+#ifndef MESHLET_CULLING
+#define MESHLET_CULLING 1
+#endif
+
+//uniform names are interned once in setup_render
+static struct {
+  InternedString camPos;
+  InternedString viewMatrix;
+  InternedString projectionMatrix;
+  InternedString modelMatrix;
+  InternedString compressedVertices;
+  InternedString positionOffset;
+  InternedString positionScale;
+  InternedString screenTexture;
+} renderUniforms;
+
 void setup_render(Arena* arena) {
+  renderUniforms.camPos = intern_string_literal("camPos");
+  renderUniforms.viewMatrix = intern_string_literal("viewMatrix");
+  renderUniforms.projectionMatrix = intern_string_literal("projectionMatrix");
+  renderUniforms.modelMatrix = intern_string_literal("modelMatrix");
+  renderUniforms.compressedVertices = intern_string_literal("compressedVertices");
+  renderUniforms.positionOffset = intern_string_literal("positionOffset");
+  renderUniforms.positionScale = intern_string_literal("positionScale");
+  renderUniforms.screenTexture = intern_string_literal("screenTexture");
+
   float quadVertices[] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
         // positions   // texCoords
         -1.0f,  1.0f,  0.0f, 1.0f,
@@ -43,27 +72,73 @@ void setup_render(Arena* arena) {
   glEnableVertexAttribArray(1);
   glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 
-  quadShader = create_shader_program()
+  quadShader = create_shader_program(arena);
   attach_shader_to_program(arena, &quadShader, GL_VERTEX_SHADER, create_string_from_literal("res/shader/quadVertex.glsl"));
   attach_shader_to_program(arena, &quadShader, GL_FRAGMENT_SHADER, create_string_from_literal("res/shader/quadFragment.glsl"));
   finalize_shader_program(&quadShader);
   quadMaterial = create_material(arena, &quadShader);
 }
 
-void render_mesh(Mesh* mesh, const Camera* camera, mat4 viewMatrix) {
+/* Draws the meshlets of the mesh that are inside the frustum and have a front face towards the camera.
+ * The tests are done in the space of the mesh: the frustum planes come from projection * view * model and the camera is moved
+ * by the inverse of the model matrix. Meshlets that are next to each other in the index buffer are drawn as one range,
+ * the ranges live in the frame arena
+*/
+static void render_meshlets(FrameAllocator* frameAllocator, Mesh* mesh, const Camera* camera, mat4 viewMatrix) {
+  const RenderData* renderData = &mesh->renderData;
+  mat4 clipMatrix, inverseModel;
+  glm_mat4_mul(projectionMatrix, viewMatrix, clipMatrix);
+  glm_mat4_mul(clipMatrix, mesh->modelMatrix, clipMatrix);
+  vec4 planes[6];
+  glm_frustum_planes(clipMatrix, planes);
+  glm_mat4_inv(mesh->modelMatrix, inverseModel);
+  vec3 cameraPosition;
+  glm_mat4_mulv3(inverseModel, (float*)camera->position, 1.0f, cameraPosition);
+  //a mirroring model matrix turns the winding around, the cones would cull the side that is seen
+  mat3 linear;
+  glm_mat4_pick3(mesh->modelMatrix, linear);
+  const float* coneCamera = glm_mat3_det(linear) > 0.0f ? cameraPosition : NULL;
+
+  GLsizei* counts = frame_alloc_array(frameAllocator, GLsizei, renderData->meshletCount);
+  const void** offsets = frame_alloc_array(frameAllocator, const void*, renderData->meshletCount);
+  size_t indexSize = renderData->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+  GLsizei drawCount = 0;
+  uint32_t rangeEnd = UINT32_MAX;
+  for(uint32_t i = 0; i < renderData->meshletCount; i++) {
+    const Meshlet* meshlet = &renderData->meshlets[i];
+    if(!meshlet_visible(meshlet, planes, coneCamera)) continue;
+    if(meshlet->firstIndex == rangeEnd) counts[drawCount - 1] += meshlet->triangleCount*3;
+    else {
+      counts[drawCount] = meshlet->triangleCount*3;
+      offsets[drawCount] = (const void*)((uintptr_t)meshlet->firstIndex*indexSize);
+      drawCount++;
+    }
+    rangeEnd = meshlet->firstIndex + meshlet->triangleCount*3;
+  }
+  if(drawCount) glMultiDrawElements(GL_TRIANGLES, counts, renderData->indexType, offsets, drawCount);
+}
+
+void render_mesh(FrameAllocator* frameAllocator, Mesh* mesh, const Camera* camera, mat4 viewMatrix) {
   glUseProgram(mesh->material.shaderProgram->id);
-  material_set_vec3(&mesh->material, create_string_from_literal("camPos"), camera->position);
-  material_set_mat4(&mesh->material, create_string_from_literal("viewMatrix"), viewMatrix);
-  material_set_mat4(&mesh->material, create_string_from_literal("projectionMatrix"), projectionMatrix);
-  material_set_mat4(&mesh->material, create_string_from_literal("modelMatrix"), mesh->modelMatrix);
+  material_set_vec3(&mesh->material, renderUniforms.camPos, camera->position);
+  material_set_mat4(&mesh->material, renderUniforms.viewMatrix, viewMatrix);
+  material_set_mat4(&mesh->material, renderUniforms.projectionMatrix, projectionMatrix);
+  material_set_mat4(&mesh->material, renderUniforms.modelMatrix, mesh->modelMatrix);
+  bool compressed = mesh->renderData.vertexFormat & VERTEX_FORMAT_COMPRESSED;
+  material_set_bool(&mesh->material, renderUniforms.compressedVertices, compressed);
+  if(compressed) {
+    material_set_vec3(&mesh->material, renderUniforms.positionOffset, mesh->renderData.positionOffset);
+    material_set_vec3(&mesh->material, renderUniforms.positionScale, mesh->renderData.positionScale);
+  }
   material_push_uniform_values(&mesh->material);
   glBindVertexArray(mesh->renderData.vao);
-  glDrawElements(GL_TRIANGLES, mesh->renderData.indexCount, GL_UNSIGNED_INT, 0);
+  if(MESHLET_CULLING && mesh->renderData.meshletCount) render_meshlets(frameAllocator, mesh, camera, viewMatrix);
+  else glDrawElements(GL_TRIANGLES, mesh->renderData.indexCount, mesh->renderData.indexType, 0);
 }
 
 void render_texture(Texture texture) {
   glUseProgram(quadMaterial.shaderProgram->id);
-  material_set_texture(&quadMaterial, create_string_from_literal("screenTexture"), texture);
+  material_set_texture(&quadMaterial, renderUniforms.screenTexture, texture);
   material_push_uniform_values(&quadMaterial);
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -72,7 +147,7 @@ void render_texture(Texture texture) {
   glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
-void render_scene(Scene* scene, int windowWidth, int windowHeight) {
+void render_scene(FrameAllocator* frameAllocator, Scene* scene, int windowWidth, int windowHeight) {
   //perspective matrix
   glViewport(0, 0, windowWidth, windowHeight);
   glm_perspective(glm_rad(90.0f), (float)windowWidth/(float)windowHeight, 0.1f, 100.0f, projectionMatrix);
@@ -98,8 +173,8 @@ void render_scene(Scene* scene, int windowWidth, int windowHeight) {
   glDisable(GL_CULL_FACE);
   glUseProgram(scene->skyBoxMaterial.shaderProgram->id);
 
-  material_set_mat4(&scene->skyBoxMaterial, create_string_from_literal("viewMatrix"), skyboxViewMatrix);
-  material_set_mat4(&scene->skyBoxMaterial, create_string_from_literal("projectionMatrix"), projectionMatrix);
+  material_set_mat4(&scene->skyBoxMaterial, renderUniforms.viewMatrix, skyboxViewMatrix);
+  material_set_mat4(&scene->skyBoxMaterial, renderUniforms.projectionMatrix, projectionMatrix);
   material_push_uniform_values(&scene->skyBoxMaterial);
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -111,7 +186,7 @@ void render_scene(Scene* scene, int windowWidth, int windowHeight) {
 
   //render meshes
   for(size_t i = 0; i < scene->meshList.length; i++) {
-    render_mesh(&scene->meshList.data[i], &scene->camera, viewMatrix);
+    render_mesh(frameAllocator, &scene->meshList.data[i], &scene->camera, viewMatrix);
   }
 }
 
@@ -3,126 +3,47 @@
 #define RESOURCE_IMPL
 
 #include <glad/glad.h>
-#include <cglm/vec3.h>
+#include <cglm/cglm.h>
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
 #include "data_types/arena.c"
+#include "data_types/array.c"
 #include "data_types/string.c"
-#include <assert.h>
+#include "data_types/io.c"
+#include "data_types/async_io.c"
+#include "scene_define.c"
+#include "gltf.c"
+#include "opengl_utils.c"
+#include "mesh.c"
+#include "mesh_cache.c"
+#include "scene_graph.c"
+#include "pbr.c"
 
 //=====================================
-// stuff that will be used frequently (ex: quads, cubes, white texture, etc)
-
-static unsigned cubeMapVAO, quadVAO;
-void init_default_values(void) {
-  float cubeMapVertices[] = {
-        // positions          
--1.0f,  1.0f, -1.0f,
--1.0f, -1.0f, -1.0f,
- 1.0f, -1.0f, -1.0f,
- 1.0f, -1.0f, -1.0f,
- 1.0f,  1.0f, -1.0f,
--1.0f,  1.0f, -1.0f,
-
--1.0f, -1.0f,  1.0f,
--1.0f, -1.0f, -1.0f,
--1.0f,  1.0f, -1.0f,
--1.0f,  1.0f, -1.0f,
--1.0f,  1.0f,  1.0f,
--1.0f, -1.0f,  1.0f,
-
- 1.0f, -1.0f, -1.0f,
- 1.0f, -1.0f,  1.0f,
- 1.0f,  1.0f,  1.0f,
- 1.0f,  1.0f,  1.0f,
- 1.0f,  1.0f, -1.0f,
- 1.0f, -1.0f, -1.0f,
-
--1.0f, -1.0f,  1.0f,
--1.0f,  1.0f,  1.0f,
- 1.0f,  1.0f,  1.0f,
- 1.0f,  1.0f,  1.0f,
- 1.0f, -1.0f,  1.0f,
--1.0f, -1.0f,  1.0f,
-
--1.0f,  1.0f, -1.0f,
- 1.0f,  1.0f, -1.0f,
- 1.0f,  1.0f,  1.0f,
- 1.0f,  1.0f,  1.0f,
--1.0f,  1.0f,  1.0f,
--1.0f,  1.0f, -1.0f,
-
--1.0f, -1.0f, -1.0f,
--1.0f, -1.0f,  1.0f,
- 1.0f, -1.0f, -1.0f,
- 1.0f, -1.0f, -1.0f,
--1.0f, -1.0f,  1.0f,
- 1.0f, -1.0f,  1.0f
-  };
-
-  float quadVertices[] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
-        // positions   // texCoords
-        -1.0f,  1.0f,  0.0f, 1.0f,
-        -1.0f, -1.0f,  0.0f, 0.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-
-        -1.0f,  1.0f,  0.0f, 1.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-         1.0f,  1.0f,  1.0f, 1.0f
-  };
-
-  unsigned temp, cubeMapVBO, quadVBO;
-  glGenVertexArrays(1, &temp);
-  glGenBuffers(1, &cubeMapVBO);
-  glBindVertexArray(temp);
-  glBindBuffer(GL_ARRAY_BUFFER, cubeMapVBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeMapVertices), &cubeMapVertices, GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-  cubeMapVAO = temp;
-
-  glGenVertexArrays(1, &temp);
-  glGenBuffers(1, &quadVBO);
-  glBindVertexArray(temp);
-  glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-  quadVAO = temp;
-}
+// OBJ
+//=====================================
 
 //String handling
-void string_to_vec3(const String string, vec3* result) {
-  Cut cut = string_cut(string_trim_left(string), ' ');
-  (*result)[0] = string_to_float(cut.head);
-  cut = string_cut(string_trim_left(cut.tail), ' ');
-  (*result)[1] = string_to_float(cut.head);
-  cut = string_cut(string_trim_left(cut.tail), ' ');
-  (*result)[2] = string_to_float(cut.head);
-}
-
-void string_to_vec2(const String string, vec2* result) {
-  Cut cut = string_cut(string_trim_left(string), ' ');
-  (*result)[0] = string_to_float(cut.head);
-  cut = string_cut(string_trim_left(cut.tail), ' ');
-  (*result)[1] = string_to_float(cut.head);
-}
-
 void string_to_face(const String string, size_t positionCount, size_t normalCount, size_t uvCount, ivec3* positionIndex, ivec3* normalIndex, ivec3* uvIndex) {
+  const String whitespace = create_string_from_literal(" \t\r");
   Cut fields = {0};
   fields.tail = string;
   for(int i = 0; i < 3; i++) {
-    fields = string_cut(string_trim_left(fields.tail), ' ');
-    Cut element = string_cut(string_trim_left(fields.head), '/');
-    (*positionIndex)[i] = string_to_int(element.head);
-    element = string_cut(string_trim_left(element.tail), '/');
-    (*uvIndex)[i] = string_to_int(element.head);
-    element = string_cut(string_trim_left(element.tail), '/');
-    (*normalIndex)[i] = string_to_int(element.head);
-
-    if(positionIndex[i] < 0) (*positionIndex)[i] = (int32_t)((*positionIndex[i]) + 1 + positionCount);
-    if(uvIndex[i] < 0) (*uvIndex)[i] = (int32_t)((*uvIndex[i]) + 1 + uvCount);
-    if(normalIndex[i] < 0) (*normalIndex)[i] = (int32_t)((*normalIndex[i]) + 1 + normalCount);
+    fields = string_cut(string_trim_left(fields.tail, whitespace), ' ');
+    Cut element = string_cut(string_trim_left(fields.head, whitespace), '/');
+    (*positionIndex)[i] = string_to_int32(element.head);
+    element = string_cut(element.tail, '/');
+    (*uvIndex)[i] = string_to_int32(element.head);
+    element = string_cut(element.tail, '/');
+    (*normalIndex)[i] = string_to_int32(string_trim_right(element.head, whitespace));
+
+    if((*positionIndex)[i] < 0) (*positionIndex)[i] = (int32_t)((*positionIndex)[i] + 1 + positionCount);
+    if((*uvIndex)[i] < 0) (*uvIndex)[i] = (int32_t)((*uvIndex)[i] + 1 + uvCount);
+    if((*normalIndex)[i] < 0) (*normalIndex)[i] = (int32_t)((*normalIndex)[i] + 1 + normalCount);
   }
 }
 
@@ -146,14 +67,14 @@ ObjModel parse_obj(Arena* arena, const String objSource) {
 
   lines.tail = objSource;
   while(lines.tail.len) {
-    lines = string_cut(lines.tail, '\n');
-    Cut fields = string_cut(string_trim_right(lines.head, " "), ' ');
+    lines = string_cut_line(lines.tail);
+    Cut fields = string_cut(string_trim_right(lines.head, create_string_from_literal(" \t")), ' ');
     String type = fields.head;
 
-    if(string_equals(create_string("v"), type)) model.positionCount++;
-    else if(string_equals(create_string("vt"), type)) model.uvCount++;
-    else if(string_equals(create_string("vn"), type)) model.normalCount++;
-    else if(string_equals(create_string("f"), type)) model.faceCount++;
+    if(string_equals(create_string_from_literal("v"), type)) model.positionCount++;
+    else if(string_equals(create_string_from_literal("vt"), type)) model.uvCount++;
+    else if(string_equals(create_string_from_literal("vn"), type)) model.normalCount++;
+    else if(string_equals(create_string_from_literal("f"), type)) model.faceCount++;
   }
   model.positions = arena_alloc_array(arena, vec3, model.positionCount);
   model.normals = arena_alloc_array(arena, vec3, model.normalCount);
@@ -165,15 +86,15 @@ ObjModel parse_obj(Arena* arena, const String objSource) {
   model.positionCount = model.uvCount = model.normalCount = model.faceCount = 0;
   lines.tail = objSource;
   while(lines.tail.len) {
-    lines = string_cut(lines.tail, '\n');
-    Cut fields = string_cut(string_trim_right(lines.head, " "), ' ');
+    lines = string_cut_line(lines.tail);
+    Cut fields = string_cut(string_trim_right(lines.head, create_string_from_literal(" \t")), ' ');
     String type = fields.head;
-    String data = string_trim_left(fields.tail);
+    String data = string_trim_left(fields.tail, create_string_from_literal(" \t"));
     
-    if(string_equals(create_string("v"), type)) string_to_vec3(data, &model.positions[model.positionCount++]);
-    else if(string_equals(create_string("vt"), type)) string_to_vec2(data, &model.uvs[model.uvCount++]);   
-    else if(string_equals(create_string("vn"), type)) string_to_vec3(data, &model.normals[model.normalCount++]);   
-    else if(string_equals(create_string("f"), type))  {
+    if(string_equals(create_string_from_literal("v"), type)) string_parse_floats(data, model.positions[model.positionCount++], 3);
+    else if(string_equals(create_string_from_literal("vt"), type)) string_parse_floats(data, model.uvs[model.uvCount++], 2);   
+    else if(string_equals(create_string_from_literal("vn"), type)) string_parse_floats(data, model.normals[model.normalCount++], 3);   
+    else if(string_equals(create_string_from_literal("f"), type))  {
       string_to_face(
         data,
         model.positionCount,
@@ -189,18 +110,9 @@ ObjModel parse_obj(Arena* arena, const String objSource) {
   return model;
 }
 
-#include <glad/glad.h>
-#include <cJSON.h>
-
-#include <stdio.h>
-#include <string.h>
-
-#include "scene_define.c"
-
-#include "data_types/arena.c"
-#include "opengl_utils.c"
-#include "mesh.c"
-#include "cglm/mat4.h"
+//=====================================
+// GLTF
+//=====================================
 
 /* 
  * Base 64 decoder
@@ -251,6 +163,16 @@ int base64_decode(String string, unsigned char *out) {
 	return 1;
 }
 
+// The number of bytes string decodes to, SIZE_MAX when it isn't made of whole 4 char groups
+size_t base64_decoded_length(String string) {
+	if (string.len % 4)
+		return SIZE_MAX;
+	size_t padding = 0;
+	while (padding < 2 && padding < string.len && string.data[string.len-1-padding] == '=')
+		padding++;
+	return string.len/4*3 - padding;
+}
+
 //----------------------------
 //Parsing
 //----------------------------
@@ -261,12 +183,6 @@ typedef struct {
   size_t len;
 } Bytes;
 
-uint64_t mesh_hash(int value) {
-  return value;
-}
-
-bool int_is_equal(int a, int b) { return a == b; }
-
 DEFINE_ARRAY(Bytes)
 DEFINE_ARRAY(GLuint)
 
@@ -277,478 +193,726 @@ typedef struct {
   size_t count;
 } GLTFAttribute;
 
-GLTFAttribute load_attribute_from_gltf( Arena* arena, const Array(Bytes)* bufferArray, const cJSON* json, const cJSON* attribute, GLenum expectedComponentType, uint8_t expectedVecType) {
-  const cJSON* accessors = cJSON_GetObjectItemCaseSensitive(json, "accessors");
-  const cJSON* bufferViews = cJSON_GetObjectItemCaseSensitive(json, "bufferViews");
-
-  const cJSON* accessor = cJSON_GetArrayItem(accessors, attribute->valueint);
-
-  //accesors
-  const cJSON* buffViewIndex = cJSON_GetObjectItemCaseSensitive(accessor, "bufferView");
-  const cJSON* componentType = cJSON_GetObjectItemCaseSensitive(accessor, "componentType");
-  const cJSON* count = cJSON_GetObjectItemCaseSensitive(accessor, "count");
-  const cJSON* type = cJSON_GetObjectItemCaseSensitive(accessor, "type");
-  const cJSON* accessorOffset = cJSON_GetObjectItemCaseSensitive(accessor, "byteOffset");
-  size_t accessorOffsetValue = accessorOffset ? accessorOffset->valueint : 0;
-
-  //bufferView
-  const cJSON* buffView = cJSON_GetArrayItem(bufferViews, buffViewIndex->valueint);
-  const cJSON* bufferIndex = cJSON_GetObjectItemCaseSensitive(buffView, "buffer");
-  const cJSON* byteLength = cJSON_GetObjectItemCaseSensitive(buffView, "byteLength");
-  const cJSON* bufferOffset = cJSON_GetObjectItemCaseSensitive(buffView, "byteOffset");
-  const cJSON* stride = cJSON_GetObjectItemCaseSensitive(buffView, "byteStride");
-  size_t bufferOffsetValue = bufferOffset ? bufferOffset->valueint : 0;
-  
-  //putting data
-  Bytes buffer = array_get(Bytes, bufferArray, bufferIndex->valueint);
-  buffer.data += accessorOffsetValue + bufferOffsetValue;
-  buffer.len = byteLength->valueint;
+// An empty attribute when the accessor doesn't hold the expected type, its data can't be copied as is
+/* KHR_mesh_quantization lets attributes be stored as 8 or 16 bit integers (normalized or not),
+ * they are turned back into tight floats in the arena so every attribute can be cooked the same way
+*/
+static GLTFAttribute dequantize_gltf_attribute(Arena* arena, GLTFAttribute attribute, GLenum componentType, bool normalized, uint8_t componentCount) {
+  size_t componentTotal = attribute.count*componentCount;
+  float* values = arena_alloc_array(arena, float, componentTotal);
+
+  #define DEQUANTIZE_GLTF_COMPONENTS(type, maxValue)\
+    for(size_t i = 0; i < attribute.count; i++) {\
+      type components[4];\
+      memcpy(components, attribute.data + i*attribute.stride, componentCount*sizeof(type));\
+      for(uint8_t j = 0; j < componentCount; j++) {\
+        float value = components[j];\
+        values[i*componentCount + j] = normalized ? fmaxf(value / (maxValue), -1.0f) : value;\
+      }\
+    }
 
-  String typeStr;
-  typeStr.data = type->valuestring;
-  typeStr.len = strlen(type->valuestring);
+  switch(componentType) {
+    case GL_BYTE: DEQUANTIZE_GLTF_COMPONENTS(int8_t, INT8_MAX) break;
+    case GL_UNSIGNED_BYTE: DEQUANTIZE_GLTF_COMPONENTS(uint8_t, UINT8_MAX) break;
+    case GL_SHORT: DEQUANTIZE_GLTF_COMPONENTS(int16_t, INT16_MAX) break;
+    case GL_UNSIGNED_SHORT: DEQUANTIZE_GLTF_COMPONENTS(uint16_t, UINT16_MAX) break;
+  }
+  #undef DEQUANTIZE_GLTF_COMPONENTS
+
+  size_t elementSize = componentCount*sizeof(float);
+  return (GLTFAttribute){(byte*)values, elementSize, elementSize, attribute.count};
+}
 
-  if(componentType->valueint != expectedComponentType) {
-    fprintf(stderr, "Component Type doesn't match");
+// Float attributes are used where they are in the buffer, quantized ones are converted to floats in the arena
+GLTFAttribute load_attribute_from_gltf(Arena* arena, const Array(Bytes)* bufferArray, const GLTF* gltf, int32_t accessorIndex, uint8_t expectedVecType) {
+  const GLTFAccessor* accessor = array_index(GLTFAccessor, &gltf->accessors, accessorIndex);
+  if(accessor->bufferView == -1) {
+    fprintf(stderr, "Sparse and zero filled accessors aren't supported\n");
     fflush(stderr);
+    return (GLTFAttribute){0};
   }
+  const GLTFBufferView* bufferView = array_index(GLTFBufferView, &gltf->bufferViews, accessor->bufferView);
 
-  uint8_t vecType = 0;
-  if(string_equals(typeStr, create_string("SCALAR"))) vecType = 1;
-  else if(string_equals(typeStr, create_string("VEC2"))) vecType = 2;
-  else if(string_equals(typeStr, create_string("VEC3"))) vecType = 3;
-  else if(string_equals(typeStr, create_string("VEC4"))) vecType = 4;
-
-  if(vecType != expectedVecType) {
-    fprintf(stderr, "Vector Type doesn't match");
+  //putting data
+  Bytes buffer = *array_index(Bytes, bufferArray, bufferView->buffer);
+  buffer.data += accessor->byteOffset + bufferView->byteOffset;
+  buffer.len = bufferView->byteLength;
+
+  bool quantized = accessor->componentType == GL_BYTE || accessor->componentType == GL_UNSIGNED_BYTE ||
+    accessor->componentType == GL_SHORT || accessor->componentType == GL_UNSIGNED_SHORT;
+  if(accessor->componentType != GL_FLOAT && !quantized) {
+    fprintf(stderr, "Component Type doesn't match\n");
     fflush(stderr);
+    return (GLTFAttribute){0};
   }
 
-  size_t bytesPerElement = vecType;
-  switch(expectedComponentType) {
-    case GL_FLOAT:
-      bytesPerElement *= sizeof(float);
-      break;
-    case GL_UNSIGNED_BYTE:
-      bytesPerElement *= sizeof(unsigned char);
-      break;
-    case GL_UNSIGNED_SHORT:
-      bytesPerElement *= sizeof(unsigned short);
-      break;
-    case GL_UNSIGNED_INT:
-      bytesPerElement *= sizeof(unsigned int);
-      break;
+  if(accessor->componentCount != expectedVecType) {
+    fprintf(stderr, "Vector Type doesn't match\n");
+    fflush(stderr);
+    return (GLTFAttribute){0};
   }
-  size_t strideValue = stride ? stride->valueint : bytesPerElement;
-  return (GLTFAttribute){buffer.data, bytesPerElement, strideValue, count->valueint};
+
+  size_t bytesPerElement = gltf_accessor_element_size(accessor);
+  GLTFAttribute attribute = {buffer.data, bytesPerElement, gltf_accessor_stride(gltf, accessor), accessor->count};
+  if(quantized) return dequantize_gltf_attribute(arena, attribute, accessor->componentType, accessor->normalized, expectedVecType);
+  return attribute;
 }
 
 size_t get_attribute_size(const GLTFAttribute* attribute) {
   return attribute->bytesPerElement*attribute->count;
 }
 
-Mesh load_mesh_from_gltf(Arena* arena, const Array(Bytes)* bufferArray, const Array(GLuint)* imageArray, const cJSON* json, const cJSON* primitive) {
-  const cJSON* accessors = cJSON_GetObjectItemCaseSensitive(json, "accessors");
-  const cJSON* bufferViews = cJSON_GetObjectItemCaseSensitive(json, "bufferViews");
-  const cJSON* attributes = cJSON_GetObjectItemCaseSensitive(primitive, "attributes");
-
-  const cJSON* POSITION = cJSON_GetObjectItemCaseSensitive(attributes, "POSITION");
-  const cJSON* NORMAL = cJSON_GetObjectItemCaseSensitive(attributes, "NORMAL");
-  const cJSON* TEXCOORD_0 = cJSON_GetObjectItemCaseSensitive(attributes, "TEXCOORD_0");
+//----------------------------
+//Cooking
+//----------------------------
 
-  //We will assume that any gltf without a position is an invalid gltf
-  assert(primitive);
-  
-  GLTFAttribute position = load_attribute_from_gltf(arena, bufferArray, json, POSITION, GL_FLOAT, 3);
-
-  byte blank[1] = {0};
-  GLTFAttribute normal = {blank, 0, 0, position.count};
-  if(NORMAL) {
-    normal = load_attribute_from_gltf(arena, bufferArray, json, NORMAL, GL_FLOAT, 3);
-  }
-  GLTFAttribute texCoord = {blank, 0, 0, position.count};
-  if(TEXCOORD_0) {
-    texCoord = load_attribute_from_gltf(arena, bufferArray, json, TEXCOORD_0, GL_FLOAT, 2);
-  }
-
-  assert(position.count == normal.count && normal.count == texCoord.count);
-  size_t vertexCount = position.count;
-  size_t dataSize = get_attribute_size(&position) + get_attribute_size(&normal) + get_attribute_size(&texCoord);
-
-  byte* vertexData = (byte*)arena_alloc(arena, dataSize);
-
-  size_t offset = 0;
-  size_t positionOffset = 0;
-  size_t normalOffset = 0;
-  size_t texCoordOffset = 0;
-  for(size_t i = 0; i < vertexCount; i++) {
-    memcpy(vertexData+offset, position.data+positionOffset, position.bytesPerElement);
-    positionOffset += position.stride;
-    offset += position.bytesPerElement;
-
-    memcpy(vertexData+offset, normal.data+normalOffset, normal.bytesPerElement);
-    normalOffset += normal.stride;
-    offset += normal.bytesPerElement;
-
-    memcpy(vertexData+offset, texCoord.data+texCoordOffset, texCoord.bytesPerElement);
-    texCoordOffset += texCoord.stride;
-    offset += texCoord.bytesPerElement;
-  }
-
-  //index Buffer
-  const cJSON* indices = cJSON_GetObjectItemCaseSensitive(primitive, "indices");
-  const cJSON* indexAccessor = cJSON_GetArrayItem(accessors, indices->valueint);
-
-  //accessor
-  const cJSON* indexCount = cJSON_GetObjectItemCaseSensitive(indexAccessor, "count");
-  const cJSON* indexBufferViewIndex = cJSON_GetObjectItemCaseSensitive(indexAccessor, "bufferView");
-  const cJSON* indexAccOffset = cJSON_GetObjectItemCaseSensitive(indexAccessor, "byteOffset");
-  const cJSON* componentType = cJSON_GetObjectItemCaseSensitive(indexAccessor, "componentType");
-  const int indexAccOffsetValue = indexAccOffset ? indexAccOffset->valueint : 0;
-
-  //buffer view
-  const cJSON* indexBufferView = cJSON_GetArrayItem(bufferViews, indexBufferViewIndex->valueint);
-  const cJSON* indexLen = cJSON_GetObjectItemCaseSensitive(indexBufferView, "byteLength");
-  const cJSON* indexBuff = cJSON_GetObjectItemCaseSensitive(indexBufferView, "buffer");
-  const cJSON* indexBuffOffset = cJSON_GetObjectItemCaseSensitive(indexBufferView, "byteOffset");
-  const int indexBuffOffsetValue = indexBuffOffset ? indexBuffOffset->valueint : 0;
-  
-  Bytes indexBytes = array_get(Bytes, bufferArray, indexBuff->valueint);
-  indexBytes.data += indexBuffOffsetValue + indexAccOffsetValue;
-  indexBytes.len = indexLen->valueint;
-
-  size_t indexCountValue = indexCount->valueint;
-
-  uint32_t* indexData = arena_alloc_array(arena, uint32_t, indexCountValue);
-  switch(componentType->valueint) {
-    case GL_UNSIGNED_BYTE: {
-      unsigned char* indexList = (unsigned char*)indexBytes.data;
-      for(size_t i = 0; i < indexCountValue; i++) {
-        indexData[i] = indexList[i];
+/* Loads every buffer of the glTF, data: uris are decoded into the arena, .bin files are mapped
+ * and the buffer without a uri is the binary chunk of a .glb (used where it is, binChunk is empty for a .gltf).
+ * The mapped views have to be closed by the caller, returns false (with every view closed) when a buffer is missing or too small
+*/
+static bool load_gltf_buffers(Arena* arena, const GLTF* gltf, String parentPath, String binChunk, Bytes* bufferData, FileView* bufferViews) {
+  for(size_t i = 0; i < gltf->buffers.length; i++) {
+    const GLTFBuffer* buffer = array_index(GLTFBuffer, &gltf->buffers, i);
+    String uri = buffer->uri;
+
+    Bytes bytes = {0};
+    bufferViews[i] = (FileView){0};
+    if(!uri.len) {
+      if(i != 0 || binChunk.len < buffer->byteLength) {
+        fprintf(stderr, "Buffer %zu doesn't have a uri or a big enough glb binary chunk\n", i);
+        fflush(stderr);
+        for(size_t j = 0; j < i; j++) close_file_view(&bufferViews[j]);
+        return false;
       }
+      bytes = (Bytes){(byte*)binChunk.data, binChunk.len};
     }
-      break;
-    case GL_UNSIGNED_SHORT: {
-      unsigned short* indexList = (unsigned short*)indexBytes.data;
-      for(size_t i = 0; i < indexCountValue; i++) {
-        indexData[i] = indexList[i];
+    else if(string_find_substring(uri, create_string_from_literal("data:")) == 0) {
+      Cut cut = string_cut(uri, ';');
+      cut = string_cut(cut.tail, ',');
+      int base = string_to_int32(string_span(cut.head.data+4, cut.head.data+cut.head.len));
+      //the decoder writes as many bytes as the uri holds, so a uri that doesn't match byteLength is never decoded
+      const char* error = NULL;
+      byte* data = NULL;
+      if(base != 64) error = "isn't base64";
+      else if(base64_decoded_length(cut.tail) != buffer->byteLength) error = "doesn't decode to its byteLength";
+      else {
+        data = arena_alloc_array(arena, byte, buffer->byteLength);
+        if(!base64_decode(cut.tail, data)) error = "isn't valid base64";
       }
+      if(error) {
+        fprintf(stderr, "The data uri of buffer %zu %s\n", i, error);
+        fflush(stderr);
+        for(size_t j = 0; j < i; j++) close_file_view(&bufferViews[j]);
+        return false;
+      }
+      bytes = (Bytes){data, buffer->byteLength};
     }
-      break;
-    case GL_UNSIGNED_INT: {
-      unsigned int* indexList = (unsigned int*)indexBytes.data;
-      for(size_t i = 0; i < indexCountValue; i++) {
-        indexData[i] = indexList[i];
+    else {
+      char binFilePath[parentPath.len + uri.len + 1];
+      memcpy(binFilePath, parentPath.data, parentPath.len);
+      string_to_c_str(uri, binFilePath + parentPath.len);
+
+      bufferViews[i] = open_file_view((String){binFilePath, parentPath.len + uri.len}, FILE_VIEW_WILLNEED);
+      if(bufferViews[i].len < buffer->byteLength) {
+        //a file that couldn't be opened was already reported by io_open
+        if(bufferViews[i].data) {
+          fprintf(stderr, "The binary file %s is smaller than its byteLength\n", binFilePath);
+          fflush(stderr);
+        }
+        for(size_t j = 0; j <= i; j++) close_file_view(&bufferViews[j]);
+        return false;
       }
+      bytes = (Bytes){(byte*)bufferViews[i].data, bufferViews[i].len};
     }
+    bufferData[i] = bytes;
+  }
+  return true;
+}
+
+// A primitive that goes into the cache with the attributes it's cooked from
+typedef struct {
+  uint32_t mesh;
+  int32_t material;
+  uint32_t format;
+  GLTFAttribute position;
+  GLTFAttribute normal;
+  GLTFAttribute texCoord;
+  const GLTFAccessor* indices; // NULL when the primitive isn't indexed
+  uint32_t indexCount;
+  GLenum indexType; // what the indices are cooked to, it only depends on the vertex count
+  bool triangles; // points and lines keep their order
+} GLTFCookPrimitive;
+
+// False when the primitive can't be drawn by the engine
+static bool gather_gltf_primitive(Arena* arena, const Array(Bytes)* bufferArray, const GLTF* gltf, const GLTFPrimitive* primitive, uint32_t mesh, GLTFCookPrimitive* result) {
+  //We will assume that any gltf without a position is an invalid gltf
+  if(primitive->attributes[GLTF_ATTRIBUTE_POSITION] == -1) return false;
+  *result = (GLTFCookPrimitive){.mesh=mesh, .material=primitive->material, .triangles=primitive->mode == 4};
+  result->position = load_attribute_from_gltf(arena, bufferArray, gltf, primitive->attributes[GLTF_ATTRIBUTE_POSITION], 3);
+  if(!result->position.count) return false;
+  result->indexType = index_type_for_vertex_count(result->position.count);
+  if(VERTEX_COMPRESSION) result->format |= VERTEX_FORMAT_COMPRESSED;
+
+  if(primitive->attributes[GLTF_ATTRIBUTE_NORMAL] != -1) {
+    result->normal = load_attribute_from_gltf(arena, bufferArray, gltf, primitive->attributes[GLTF_ATTRIBUTE_NORMAL], 3);
+    if(result->normal.count == result->position.count) result->format |= VERTEX_FORMAT_NORMAL;
+  }
+  if(primitive->attributes[GLTF_ATTRIBUTE_TEXCOORD_0] != -1) {
+    result->texCoord = load_attribute_from_gltf(arena, bufferArray, gltf, primitive->attributes[GLTF_ATTRIBUTE_TEXCOORD_0], 2);
+    if(result->texCoord.count == result->position.count) result->format |= VERTEX_FORMAT_TEXCOORD;
+  }
+
+  //primitives without indices draw their vertices in order
+  if(primitive->indices == -1) {
+    result->indexCount = result->position.count;
+    return true;
+  }
+  const GLTFAccessor* indexAccessor = array_index(GLTFAccessor, &gltf->accessors, primitive->indices);
+  if(indexAccessor->bufferView == -1) return false;
+  switch(indexAccessor->componentType) {
+    case GL_UNSIGNED_BYTE:
+    case GL_UNSIGNED_SHORT:
+    case GL_UNSIGNED_INT:
       break;
     default:
-      fprintf(stderr, "NOT supported index type");
+      fprintf(stderr, "NOT supported index type\n");
       fflush(stderr);
+      return false;
+  }
+  result->indices = indexAccessor;
+  result->indexCount = indexAccessor->count;
+  return true;
+}
+
+// Interleaves the attributes straight from the glTF buffers and finds the bounds of the positions
+static void cook_gltf_vertices(const GLTFCookPrimitive* primitive, char* vertexData, float* boundsMin, float* boundsMax) {
+  VertexStream position = {primitive->position.data, primitive->position.stride};
+  VertexStream normal = {primitive->normal.data, primitive->normal.stride};
+  VertexStream texCoord = {primitive->texCoord.data, primitive->texCoord.stride};
+  pack_vertices(vertexData, primitive->format, position, normal, texCoord, primitive->position.count, boundsMin, boundsMax);
+}
+
+// Writes the indices of the primitive as its indexType, 8 bit indices are widened and the 32 bit indices of a small primitive are narrowed
+static void cook_gltf_indices(const Array(Bytes)* bufferArray, const GLTF* gltf, const GLTFCookPrimitive* primitive, void* indexData) {
+  uint16_t* shortIndices = indexData;
+  uint32_t* intIndices = indexData;
+  bool isShort = primitive->indexType == GL_UNSIGNED_SHORT;
+  const GLTFAccessor* indexAccessor = primitive->indices;
+  if(!indexAccessor) {
+    if(isShort) for(uint32_t i = 0; i < primitive->indexCount; i++) shortIndices[i] = i;
+    else for(uint32_t i = 0; i < primitive->indexCount; i++) intIndices[i] = i;
+    return;
+  }
+  const GLTFBufferView* indexBufferView = array_index(GLTFBufferView, &gltf->bufferViews, indexAccessor->bufferView);
+  const byte* indexBytes = array_index(Bytes, bufferArray, indexBufferView->buffer)->data + indexBufferView->byteOffset + indexAccessor->byteOffset;
+
+  switch(indexAccessor->componentType) {
+    case GL_UNSIGNED_BYTE:
+      if(isShort) for(size_t i = 0; i < primitive->indexCount; i++) shortIndices[i] = indexBytes[i];
+      else for(size_t i = 0; i < primitive->indexCount; i++) intIndices[i] = indexBytes[i];
+      break;
+    case GL_UNSIGNED_SHORT:
+      if(isShort) {
+        memcpy(shortIndices, indexBytes, primitive->indexCount*sizeof(uint16_t));
+        break;
+      }
+      for(size_t i = 0; i < primitive->indexCount; i++) {
+        uint16_t index;
+        memcpy(&index, indexBytes + i*sizeof(uint16_t), sizeof(uint16_t));
+        intIndices[i] = index;
+      }
+      break;
+    case GL_UNSIGNED_INT:
+      if(!isShort) {
+        memcpy(intIndices, indexBytes, primitive->indexCount*sizeof(uint32_t));
+        break;
+      }
+      for(size_t i = 0; i < primitive->indexCount; i++) {
+        uint32_t index;
+        memcpy(&index, indexBytes + i*sizeof(uint32_t), sizeof(uint32_t));
+        shortIndices[i] = index;
+      }
       break;
   }
-  
-  Attribute* attributeData = arena_alloc_array(arena, Attribute, 3);
-  Array(Attribute) attributeList = create_array(Attribute, attributeData, 3);
-  Attribute positonAttrib = (Attribute){GL_FLOAT, 3};
-  Attribute normalAttrib = (Attribute){GL_FLOAT, 3};
-  Attribute texCoordAttrib = (Attribute){GL_FLOAT, 2};
-  array_set(Attribute, &attributeList, 0, positonAttrib);
-  array_set(Attribute, &attributeList, 1, normalAttrib);
-  array_set(Attribute, &attributeList, 2, texCoordAttrib);
-  
-  Geometry geometry = generate_geometry(vertexData, vertexCount, &attributeList, indexData, indexCountValue);
-  const cJSON* materials = cJSON_GetObjectItemCaseSensitive(json, "materials");
-  const cJSON* textures = cJSON_GetObjectItemCaseSensitive(json, "textures");
-
-  Material material = (Material)DEFAULT_MATERIAL;
-  //materials
-  cJSON* materialIndex = cJSON_GetObjectItemCaseSensitive(primitive, "material");
-  if(!materialIndex) return (Mesh){geometry, material};
-  cJSON* materialJson = cJSON_GetArrayItem(materials, materialIndex->valueint);
-  
-  cJSON* pbr = cJSON_GetObjectItemCaseSensitive(materialJson, "pbrMetallicRoughness");
-  if(pbr) {
-    cJSON* colorFactor  = cJSON_GetObjectItemCaseSensitive(pbr, "baseColorFactor");
-    cJSON* colorTexture = cJSON_GetObjectItemCaseSensitive(pbr, "baseColorTexture");
-    cJSON* metallicRoughnessTexture = cJSON_GetObjectItemCaseSensitive(pbr, "metallicRoughnessTexture");
-    cJSON* metallicFactor = cJSON_GetObjectItemCaseSensitive(pbr, "metallicFactor");
-    cJSON* roughnessFactor = cJSON_GetObjectItemCaseSensitive(pbr, "rounghnessFactor");
-  
-    vec4 defaultColorFactor = {1.0, 1.0, 1.0, 1.0};
-    glm_vec4_copy(material.colorFactor, defaultColorFactor);
-    if(colorFactor) {
-      material.colorFactor[0] = cJSON_GetArrayItem(colorFactor, 0)->valuedouble; 
-      material.colorFactor[1] = cJSON_GetArrayItem(colorFactor, 1)->valuedouble; 
-      material.colorFactor[2] = cJSON_GetArrayItem(colorFactor, 2)->valuedouble; 
-    }
-    if(colorTexture) {
-      cJSON* index = cJSON_GetObjectItemCaseSensitive(colorTexture, "index");
-      cJSON* texture = cJSON_GetArrayItem(textures, index->valueint);
-      cJSON* source = cJSON_GetObjectItemCaseSensitive(texture, "source");
-      material.colorTexture = array_get(GLuint, imageArray, source->valueint);
+}
+
+static int32_t get_image_from_gltf(const GLTF* gltf, const GLTFTextureInfo* textureInfo) {
+  if(textureInfo->index == -1) return -1;
+  return array_index(GLTFTexture, &gltf->textures, textureInfo->index)->source;
+}
+
+/* Flattens the nodes of the default scene (every node without a parent when there isn't a scene) breadth first so parents come before their children.
+ * order gets the glTF node of each flattened node and parents the flattened index of its parent, returns how many nodes were flattened
+*/
+static uint32_t flatten_gltf_nodes(Arena* arena, const GLTF* gltf, uint32_t* order, int32_t* parents) {
+  size_t nodeCount = gltf->nodes.length;
+  ScratchArena scratch = create_scratch_arena(arena);
+  //a node that is reached twice (an invalid glTF) is only flattened the first time
+  bool* visited = arena_alloc_array(arena, bool, nodeCount);
+  memset(visited, 0, nodeCount*sizeof(bool));
+  uint32_t count = 0;
+#define flatten_gltf_node(nodeIndex, parent) \
+  if(!visited[nodeIndex]) { \
+    visited[nodeIndex] = true; \
+    order[count] = nodeIndex; \
+    parents[count++] = parent; \
+  }
+
+  int32_t sceneIndex = gltf->scene != -1 ? gltf->scene : (gltf->scenes.length ? 0 : -1);
+  if(sceneIndex != -1) {
+    const GLTFScene* scene = array_index(GLTFScene, &gltf->scenes, sceneIndex);
+    for(uint32_t i = 0; i < scene->nodeCount; i++) {
+      GLTFNodeIndex root = *array_index(GLTFNodeIndex, &gltf->nodeIndices, scene->firstNode + i);
+      flatten_gltf_node(root, -1)
     }
-    if(metallicRoughnessTexture) {
-      cJSON* index = cJSON_GetObjectItemCaseSensitive(metallicRoughnessTexture, "index");
-      cJSON* texture = cJSON_GetArrayItem(textures, index->valueint);
-      cJSON* source = cJSON_GetObjectItemCaseSensitive(texture, "source");
-      material.metallicRoughnessTexture = array_get(GLuint, imageArray, source->valueint);
+  }
+  else {
+    bool* isChild = arena_alloc_array(arena, bool, nodeCount);
+    memset(isChild, 0, nodeCount*sizeof(bool));
+    for(size_t i = 0; i < nodeCount; i++) {
+      const GLTFNode* node = array_index(GLTFNode, &gltf->nodes, i);
+      for(uint32_t j = 0; j < node->childCount; j++) isChild[*array_index(GLTFNodeIndex, &gltf->nodeIndices, node->firstChild + j)] = true;
     }
-    material.metallicFactor = 1.0;
-    if(metallicFactor) {
-      material.metallicFactor = metallicFactor->valuedouble;
+    for(uint32_t i = 0; i < nodeCount; i++) {
+      if(!isChild[i]) flatten_gltf_node(i, -1)
     }
-    material.roughnessFactor = 1.0;
-    if(roughnessFactor) {
-      material.roughnessFactor = roughnessFactor->valuedouble;
+  }
+
+  for(uint32_t head = 0; head < count; head++) {
+    const GLTFNode* node = array_index(GLTFNode, &gltf->nodes, order[head]);
+    for(uint32_t j = 0; j < node->childCount; j++) {
+      GLTFNodeIndex child = *array_index(GLTFNodeIndex, &gltf->nodeIndices, node->firstChild + j);
+      flatten_gltf_node(child, (int32_t)head)
     }
   }
-  cJSON* normalTexture = cJSON_GetObjectItemCaseSensitive(materialJson, "normalTexture");
-  if(normalTexture) {
-    cJSON* index = cJSON_GetObjectItemCaseSensitive(normalTexture, "index");
-    cJSON* texture = cJSON_GetArrayItem(textures, index->valueint);
-    cJSON* source = cJSON_GetObjectItemCaseSensitive(texture, "source");
-    material.normalTexture = array_get(GLuint, imageArray, source->valueint);
-  }
-  cJSON* occulsionTexture = cJSON_GetObjectItemCaseSensitive(materialJson, "occulsionTexture");
-  if(occulsionTexture) {
-    cJSON* index = cJSON_GetObjectItemCaseSensitive(occulsionTexture, "index");
-    cJSON* texture = cJSON_GetArrayItem(textures, index->valueint);
-    cJSON* source = cJSON_GetObjectItemCaseSensitive(texture, "source");
-    material.occulsionTexture = array_get(GLuint, imageArray, source->valueint);
-  }
-  cJSON* emissiveTexture = cJSON_GetObjectItemCaseSensitive(materialJson, "emissiveTexture");
-  if(emissiveTexture) {
-    cJSON* index = cJSON_GetObjectItemCaseSensitive(emissiveTexture, "index");
-    cJSON* texture = cJSON_GetArrayItem(textures, index->valueint);
-    cJSON* source = cJSON_GetObjectItemCaseSensitive(texture, "source");
-    material.emissiveTexture = array_get(GLuint, imageArray, source->valueint);
-  }
-
-  cJSON* emissiveFactor = cJSON_GetObjectItemCaseSensitive(materialJson, "emissiveFactor");
-
-  vec3 defaultEmissiveFactor = {1.0, 1.0, 1.0};
-  glm_vec3_copy(material.emissiveFactor, defaultEmissiveFactor);
-  if(emissiveFactor) {
-    material.emissiveFactor[0] = cJSON_GetArrayItem(emissiveFactor, 0)->valuedouble; 
-    material.emissiveFactor[1] = cJSON_GetArrayItem(emissiveFactor, 1)->valuedouble; 
-    material.emissiveFactor[2] = cJSON_GetArrayItem(emissiveFactor, 2)->valuedouble; 
-  }
-  return (Mesh){geometry, material, GLM_MAT4_IDENTITY_INIT};
+#undef flatten_gltf_node
+  release_scratch_arena(scratch);
+  return count;
 }
 
-#include "data_types/array.c"
+// The local transform of a node as translation, rotation and scale, a matrix is decomposed
+static void cook_gltf_node(const GLTFNode* node, int32_t parent, MeshCacheNode* result) {
+  *result = (MeshCacheNode){.parent=parent, .mesh=node->mesh};
+  if(!node->hasMatrix) {
+    memcpy(result->translation, node->translation, sizeof(result->translation));
+    memcpy(result->rotation, node->rotation, sizeof(result->rotation));
+    memcpy(result->scale, node->scale, sizeof(result->scale));
+    return;
+  }
+  mat4 matrix, rotation;
+  vec4 translation;
+  versor quaternion;
+  memcpy(matrix, node->matrix, sizeof(matrix));
+  glm_decompose(matrix, translation, rotation, result->scale);
+  //a mirroring matrix leaves a rotation part with a negative determinant that no quaternion stands for, one axis is flipped in both instead
+  if(glm_mat4_det(matrix) < 0.0f) {
+    result->scale[0] = -result->scale[0];
+    for(uint8_t k = 0; k < 3; k++) rotation[0][k] = -rotation[0][k];
+  }
+  glm_mat4_quat(rotation, quaternion);
+  memcpy(result->translation, translation, sizeof(result->translation));
+  memcpy(result->rotation, quaternion, sizeof(result->rotation));
+}
 
-Array(Mesh) extract_meshes_from_gltf(Arena* arena, String filePath) {
-  Ccreate_string(filePath, cFilePath);
-  String source = read_file(arena, cFilePath);
-  Ccreate_string(source, cSource)
-  cJSON *json = cJSON_Parse(cSource);
-  assert(json);
+// The encoded bytes of an image stored in a bufferView
+static Bytes get_embedded_image_from_gltf(const Array(Bytes)* bufferArray, const GLTF* gltf, const GLTFImage* image) {
+  const GLTFBufferView* bufferView = array_index(GLTFBufferView, &gltf->bufferViews, image->bufferView);
+  return (Bytes){array_index(Bytes, bufferArray, bufferView->buffer)->data + bufferView->byteOffset, bufferView->byteLength};
+}
 
-  const cJSON* meshes = cJSON_GetObjectItemCaseSensitive(json, "meshes");
-  const cJSON* buffers = cJSON_GetObjectItemCaseSensitive(json, "buffers");
-  const cJSON* images = cJSON_GetObjectItemCaseSensitive(json, "images");
+/* Parses the glTF json and lays out its mesh cache in arena, everything the engine needs from the glTF ends up in the cache.
+ * binChunk is the binary chunk of a .glb (empty for a .gltf) and sourceName the file name of the model.
+ * Returns false when the glTF can't be loaded
+*/
+static bool cook_gltf(Arena* arena, String json, String binChunk, uint64_t sourceHash, String parentPath, String sourceName, MeshCacheWriter* writer) {
+  GLTF gltf;
+  if(!parse_gltf(arena, json, &gltf)) return false;
 
-  size_t bufferCount = cJSON_GetArraySize(buffers);
+  size_t bufferCount = gltf.buffers.length;
   Bytes* bufferData = arena_alloc_array(arena, Bytes, bufferCount);
   Array(Bytes) bufferArray = create_array(Bytes, bufferData, bufferCount);
+  //.bin files are used straight from the mapping and closed once they are copied into the cache
+  FileView* bufferViews = arena_alloc_array(arena, FileView, bufferCount);
+  if(!load_gltf_buffers(arena, &gltf, parentPath, binChunk, bufferData, bufferViews)) return false;
+
+  //the files the cache has to be cooked again for when they change, the json is covered by the source hash
+  //the binary chunk of a .glb isn't hashed, the .glb itself is a dependency instead
+  String* dependencies = arena_alloc_array(arena, String, bufferCount + 1);
+  size_t dependencyCount = 0;
+  if(bufferCount && !array_index(GLTFBuffer, &gltf.buffers, 0)->uri.len) dependencies[dependencyCount++] = sourceName;
+  for(size_t i = 0; i < bufferCount; i++) {
+    if(bufferViews[i].shared) dependencies[dependencyCount++] = array_index(GLTFBuffer, &gltf.buffers, i)->uri;
+  }
 
-  size_t imageCount = images ? cJSON_GetArraySize(images) : 0;
-  GLuint* imageData = arena_alloc_array(arena, GLuint, imageCount);
-  Array(GLuint) imageArray = create_array(GLuint, imageData, imageCount);
+  size_t stringBytes = 0;
+  for(size_t i = 0; i < dependencyCount; i++) stringBytes += dependencies[i].len;
+  size_t imageCount = gltf.images.length;
+  size_t blobBytes = 0;
+  for(size_t i = 0; i < imageCount; i++) {
+    const GLTFImage* image = array_index(GLTFImage, &gltf.images, i);
+    if(image->bufferView != -1) blobBytes += mesh_cache_blob_size(get_embedded_image_from_gltf(&bufferArray, &gltf, image).len);
+    else stringBytes += image->uri.len;
+  }
 
-  //buffer handling
-  for(int i = 0; i < bufferCount; i++) {
-    const cJSON* buffer = cJSON_GetArrayItem(buffers, i);
-    const cJSON* buffLen = cJSON_GetObjectItemCaseSensitive(buffer, "byteLength");
-    const cJSON* buffURI = cJSON_GetObjectItemCaseSensitive(buffer, "uri");
+  size_t primitiveCount = 0;
+  GLTFCookPrimitive* primitives = arena_alloc_array(arena, GLTFCookPrimitive, gltf.primitives.length);
+  for(size_t i = 0; i < gltf.meshes.length; i++) {
+    const GLTFMesh* mesh = array_index(GLTFMesh, &gltf.meshes, i);
+    for(uint32_t j = 0; j < mesh->primitiveCount; j++) {
+      const GLTFPrimitive* prim = array_index(GLTFPrimitive, &gltf.primitives, mesh->firstPrimitive + j);
+      GLTFCookPrimitive* primitive = &primitives[primitiveCount];
+      if(!gather_gltf_primitive(arena, &bufferArray, &gltf, prim, i, primitive)) continue;
+      blobBytes += mesh_cache_blob_size(primitive->position.count*vertex_format_stride(primitive->format));
+      blobBytes += mesh_cache_blob_size(primitive->indexCount*index_type_size(primitive->indexType));
+      if(primitive->triangles) blobBytes += mesh_cache_blob_size(meshlet_count_bound(primitive->indexCount)*sizeof(Meshlet));
+      primitiveCount++;
+    }
+  }
 
-    String uri;
-    uri.len = strlen(buffURI->valuestring);
-    uri.data = (const char*)buffURI->valuestring;
-    byte* data = arena_alloc_array(arena, byte, buffLen->valueint);
-    
-    Bytes bytes = (Bytes){data, buffLen->valueint};
-    if(string_contains(uri, create_string("data:"))) {
-      Cut cut = string_cut(uri, ';');
-      cut = string_cut(cut.tail, ',');
-      int base = string_to_int(string_span(cut.head.data+4, cut.head.data+cut.head.len));
-      if(base == 64) base64_decode(cut.tail, data);
-      else{ 
-        fprintf(stderr, "%d is an invalid base!", base);
-      }
+  //a glTF without nodes draws each mesh once at the origin
+  size_t nodeCount = gltf.nodes.length ? gltf.nodes.length : gltf.meshes.length;
+  uint32_t* nodeOrder = arena_alloc_array(arena, uint32_t, nodeCount);
+  int32_t* nodeParents = arena_alloc_array(arena, int32_t, nodeCount);
+  if(gltf.nodes.length) nodeCount = flatten_gltf_nodes(arena, &gltf, nodeOrder, nodeParents);
+
+  size_t materialCount = gltf.materials.length;
+  *writer = create_mesh_cache_writer(arena, sourceHash, dependencyCount, imageCount, materialCount, primitiveCount, nodeCount, stringBytes, blobBytes);
+  writer->header->meshCount = gltf.meshes.length;
+
+  for(size_t i = 0; i < nodeCount; i++) {
+    if(gltf.nodes.length) cook_gltf_node(array_index(GLTFNode, &gltf.nodes, nodeOrder[i]), nodeParents[i], &writer->nodes[i]);
+    else writer->nodes[i] = (MeshCacheNode){.parent=-1, .mesh=i, .rotation={0.0f, 0.0f, 0.0f, 1.0f}, .scale={1.0f, 1.0f, 1.0f}};
+  }
+
+  for(size_t i = 0; i < dependencyCount; i++) {
+    MeshCacheDependency* cacheDependency = &writer->dependencies[i];
+    cacheDependency->pathOffset = mesh_cache_write_string(writer, dependencies[i]);
+    cacheDependency->pathLength = dependencies[i].len;
+    //a file that can't be stat'ed makes the cache stale the next time
+    if(!mesh_cache_stat_file(parentPath, dependencies[i], &cacheDependency->size, &cacheDependency->modifiedTime)) cacheDependency->size = -1;
+  }
+
+  for(size_t i = 0; i < imageCount; i++) {
+    const GLTFImage* image = array_index(GLTFImage, &gltf.images, i);
+    MeshCacheImage* cacheImage = &writer->images[i];
+    *cacheImage = (MeshCacheImage){.pathOffset=writer->header->strings.offset, .blobOffset=writer->header->blob.offset};
+    if(image->bufferView != -1) {
+      Bytes encoded = get_embedded_image_from_gltf(&bufferArray, &gltf, image);
+      cacheImage->blobOffset = mesh_cache_write_blob(writer, encoded.len);
+      cacheImage->blobLength = encoded.len;
+      memcpy(writer->data + cacheImage->blobOffset, encoded.data, encoded.len);
     }
     else {
-      int32_t index = string_find_reverse(filePath, '/');
-      String parentPath;
-      if(index == -1) parentPath = filePath; 
-      //+1 is there to include the '/'
-      else parentPath = string_span(filePath.data, filePath.data+index+1);
-      String resFile = (String){0};
-      resFile.data = buffURI->valuestring;
-      resFile.len = strlen(buffURI->valuestring);
-
-      String binFilePath = string_concatenate(arena, parentPath, resFile);
-      Ccreate_string(binFilePath, cBinFile);
-      
-      FILE* file = fopen(cBinFile, "rb");
-      if(!file) fprintf(stderr, "There is no binary file %s", cBinFile);
-      fread(data, buffLen->valueint, 1, file);
-      fclose(file);
+      cacheImage->pathOffset = mesh_cache_write_string(writer, image->uri);
+      cacheImage->pathLength = image->uri.len;
     }
-    array_set(Bytes, &bufferArray, i, bytes);
-  }
-
-  //buffer handling
-  for(int i = 0; i < imageCount; i++) {
-    const cJSON* image = cJSON_GetArrayItem(images, i);
-    const cJSON* imageURI = cJSON_GetObjectItemCaseSensitive(image, "uri");
-
-    String uri;
-    uri.len = strlen(imageURI->valuestring);
-    uri.data = (const char*)imageURI->valuestring;
-  
-    int32_t index = string_find_reverse(filePath, '/');
-    String parentPath;
-    if(index == -1) parentPath = filePath; 
-    //+1 is there to include the '/'
-    else parentPath = string_span(filePath.data, filePath.data+index+1);
-    String resFile = (String){0};
-    resFile.data = imageURI->valuestring;
-    resFile.len = strlen(imageURI->valuestring);
-
-    String binFilePath = string_concatenate(arena, parentPath, resFile);
-    Ccreate_string(binFilePath, cBinFile);
-    
-    GLuint texture = create_texture(cBinFile);
-    
-    array_set(GLuint, &imageArray, i, texture);
-  }
-  
-  size_t meshCount = meshes ? cJSON_GetArraySize(meshes) : 0;
-  Mesh* meshData = arena_alloc_array(arena, Mesh, meshCount);
-  Array(Mesh) result = create_array(Mesh, meshData, meshCount);
-  //Adding Models
-  for(int i = 0; i < meshCount; i++) {
-    const cJSON* mesh = cJSON_GetArrayItem(meshes, i);
-    const cJSON* primitives = cJSON_GetObjectItemCaseSensitive(mesh, "primitives");
-    //Adding Meshes
-    for(int j = 0; j < cJSON_GetArraySize(primitives); j++) {
-      const cJSON* prim = cJSON_GetArrayItem(primitives, j);
-      array_set(Mesh, &result, i, load_mesh_from_gltf(arena, &bufferArray, &imageArray, json, prim));
+  }
+
+  for(size_t i = 0; i < materialCount; i++) {
+    const GLTFMaterial* gltfMaterial = array_index(GLTFMaterial, &gltf.materials, i);
+    MeshCacheMaterial* material = &writer->materials[i];
+    //the parser fills in the glTF defaults for the factors a material leaves out
+    memcpy(material->baseColorFactor, gltfMaterial->baseColorFactor, sizeof(material->baseColorFactor));
+    memcpy(material->emissiveFactor, gltfMaterial->emissiveFactor, sizeof(material->emissiveFactor));
+    material->metallicFactor = gltfMaterial->metallicFactor;
+    material->roughnessFactor = gltfMaterial->roughnessFactor;
+    material->baseColorImage = get_image_from_gltf(&gltf, &gltfMaterial->baseColorTexture);
+    material->metallicRoughnessImage = get_image_from_gltf(&gltf, &gltfMaterial->metallicRoughnessTexture);
+    material->normalImage = get_image_from_gltf(&gltf, &gltfMaterial->normalTexture);
+    material->emissiveImage = get_image_from_gltf(&gltf, &gltfMaterial->emissiveTexture);
+  }
+
+  for(size_t i = 0; i < primitiveCount; i++) {
+    const GLTFCookPrimitive* primitive = &primitives[i];
+    MeshCachePrimitive* cachePrimitive = &writer->primitives[i];
+    uint32_t stride = vertex_format_stride(primitive->format);
+    //the meshlets get the space of as many as there can be, the count is only known once they are built
+    size_t meshletBound = primitive->triangles ? meshlet_count_bound(primitive->indexCount) : 0;
+    *cachePrimitive = (MeshCachePrimitive){
+      .vertexOffset = mesh_cache_write_blob(writer, primitive->position.count*stride),
+      .indexOffset = mesh_cache_write_blob(writer, primitive->indexCount*index_type_size(primitive->indexType)),
+      .meshletOffset = mesh_cache_write_blob(writer, meshletBound*sizeof(Meshlet)),
+      .vertexCount = primitive->position.count,
+      .indexCount = primitive->indexCount,
+      .indexSize = index_type_size(primitive->indexType),
+      .vertexFormat = primitive->format,
+      .vertexStride = stride,
+      .material = primitive->material,
+      .mesh = primitive->mesh,
+    };
+    cook_gltf_vertices(primitive, writer->data + cachePrimitive->vertexOffset, cachePrimitive->boundsMin, cachePrimitive->boundsMax);
+    cook_gltf_indices(&bufferArray, &gltf, primitive, writer->data + cachePrimitive->indexOffset);
+    if(primitive->triangles) {
+      VertexStream position = {primitive->position.data, primitive->position.stride};
+      MeshOptimizeStats stats = optimize_mesh(arena, writer->data + cachePrimitive->indexOffset, cachePrimitive->indexSize, cachePrimitive->indexCount,
+        writer->data + cachePrimitive->vertexOffset, stride, cachePrimitive->vertexCount, position, (Meshlet*)(writer->data + cachePrimitive->meshletOffset));
+      cachePrimitive->meshletCount = stats.meshletCount;
     }
   }
 
-  cJSON_Delete(json);
-  return result;
+  for(size_t i = 0; i < bufferCount; i++) close_file_view(&bufferViews[i]);
+  return true;
+}
+
+//----------------------------
+//Loading
+//----------------------------
+
+static Texture get_texture_from_mesh_cache(const Array(GLuint)* imageArray, int32_t image) {
+  if(image == -1) return whiteTexture;
+  return *array_index(GLuint, imageArray, image);
 }
 
-/*
-Scene load_scene_from_gltf(Arena* arena, String filePath) {
-  Ccreate_string(filePath, cFilePath);
-  String source = read_file(arena, cFilePath);
-  Ccreate_string(source, cSource)
-  cJSON *json = cJSON_Parse(cSource);
-  assert(json);
+Material load_material_from_mesh_cache(Arena* arena, const Array(GLuint)* imageArray, const MeshCache* cache, int32_t materialIndex) {
+  vec3 white = {1.0, 1.0, 1.0};
+  vec3 black = {0.0, 0.0, 0.0};
+  if(materialIndex == -1) return create_pbr_material_values(arena, white, 1.0, 1.0, black);
+  const MeshCacheMaterial* cacheMaterial = &cache->materials[materialIndex];
+
+  Material material = create_pbr_material_textured(
+    arena,
+    get_texture_from_mesh_cache(imageArray, cacheMaterial->baseColorImage),
+    get_texture_from_mesh_cache(imageArray, cacheMaterial->metallicRoughnessImage),
+    get_texture_from_mesh_cache(imageArray, cacheMaterial->normalImage),
+    get_texture_from_mesh_cache(imageArray, cacheMaterial->emissiveImage)
+  );
+
+  material_set_vec3(&material, pbrUniforms.albedoFactor, cacheMaterial->baseColorFactor);
+  material_set_float(&material, pbrUniforms.metallicFactor, cacheMaterial->metallicFactor);
+  material_set_float(&material, pbrUniforms.roughnessFactor, cacheMaterial->roughnessFactor);
+  material_set_vec3(&material, pbrUniforms.emissiveFactor, cacheMaterial->emissiveFactor);
+  return material;
+}
 
-  const cJSON* meshes = cJSON_GetObjectItemCaseSensitive(json, "meshes");
-  const cJSON* buffers = cJSON_GetObjectItemCaseSensitive(json, "buffers");
-  const cJSON* images = cJSON_GetObjectItemCaseSensitive(json, "images");
+typedef struct {
+  TextureDecodeQueue* decodeQueue;
+  InternedString path;
+  GLuint* texture;
+} GLTFImageLoad;
+
+/* An image with the same contents as a cached texture uses that texture,
+ * otherwise the encoded image is handed to the decode jobs as it is and the texture is uploaded once it's decoded.
+ * An image that can't be read is white and isn't cached, so a later load tries the file again
+*/
+static void decode_gltf_image(AsyncRead* read) {
+  GLTFImageLoad* load = read->userData;
+  if(!read->ok) {
+    fprintf(stderr, "Failed to read image %.*s, it is drawn white\n", (int)read->path.len, read->path.data);
+    fflush(stderr);
+    retain_texture(whiteTexture);
+    *load->texture = whiteTexture;
+    return;
+  }
+  uint64_t contentHash = texture_cache_hash_contents(read->data, read->len);
+  *load->texture = texture_cache_find_contents(load->path, contentHash);
+  if(*load->texture) return;
 
-  size_t bufferCount = cJSON_GetArraySize(buffers);
-  Bytes* bufferData = arena_alloc_array(arena, Bytes, bufferCount);
-  Array(Bytes) bufferArray = create_array(Bytes, bufferData, bufferCount);
+  *load->texture = generate_texture();
+  texture_cache_insert(*load->texture, load->path, contentHash);
+  texture_decode_submit(load->decodeQueue, *load->texture, (unsigned char*)async_read_take_data(read), read->len);
+}
+
+/* Embedded images are decoded straight from the cache, the cache has to stay mapped until the decodes are waited for.
+ * They are known to the texture cache as "<model path>#<image index>", an empty image is white like a missing one
+*/
+static void decode_embedded_image(TextureDecodeQueue* decodeQueue, const MeshCache* cache, String filePath, uint32_t image, GLuint* texture) {
+  const MeshCacheImage* cacheImage = &cache->images[image];
+  if(!cacheImage->blobLength) {
+    retain_texture(whiteTexture);
+    *texture = whiteTexture;
+    return;
+  }
+
+  InternedString key = texture_cache_embedded_key(filePath, image);
+  *texture = texture_cache_find_path(key);
+  if(*texture) return;
+
+  const unsigned char* encoded = (const unsigned char*)cache->data + cacheImage->blobOffset;
+  uint64_t contentHash = texture_cache_hash_contents(encoded, cacheImage->blobLength);
+  *texture = texture_cache_find_contents(key, contentHash);
+  if(*texture) return;
+
+  *texture = generate_texture();
+  texture_cache_insert(*texture, key, contentHash);
+  texture_decode_submit_borrowed(decodeQueue, *texture, encoded, cacheImage->blobLength);
+}
 
-  size_t imageCount = images ? cJSON_GetArraySize(images) : 0;
+/* Uploads the primitives of a mesh cache and builds the scene graph of its nodes, with a draw item for every primitive of every node.
+ * The vertex and index data go to the gpu straight from the cache
+*/
+static SceneGraph load_mesh_cache(Arena* arena, const MeshCache* cache, String filePath, String parentPath) {
+  const MeshCacheHeader* header = cache->header;
+
+  //image handling
+  //images that are already in the texture cache aren't read again, the others are read while the geometry is uploaded
+  size_t imageCount = header->images.count;
   GLuint* imageData = arena_alloc_array(arena, GLuint, imageCount);
   Array(GLuint) imageArray = create_array(GLuint, imageData, imageCount);
+  AsyncReadBatch* imageReads = create_async_read_batch(arena, imageCount);
+  TextureDecodeQueue decodeQueue = create_texture_decode_queue(arena);
+  GLTFImageLoad* imageLoads = arena_alloc_array(arena, GLTFImageLoad, imageCount);
+  for(size_t i = 0; i < imageCount; i++) {
+    const MeshCacheImage* image = &cache->images[i];
+    if(!image->pathLength) {
+      decode_embedded_image(&decodeQueue, cache, filePath, i, array_index(GLuint, &imageArray, i));
+      continue;
+    }
+    String uri = mesh_cache_string(cache, image->pathOffset, image->pathLength);
+
+    char imageFilePath[parentPath.len + uri.len];
+    memcpy(imageFilePath, parentPath.data, parentPath.len);
+    memcpy(imageFilePath + parentPath.len, uri.data, uri.len);
+
+    String imagePath = {imageFilePath, parentPath.len + uri.len};
+    GLuint* texture = array_index(GLuint, &imageArray, i);
+    InternedString key = texture_cache_path_key(imagePath);
+    *texture = texture_cache_find_path(key);
+    if(*texture) continue;
+    imageLoads[i] = (GLTFImageLoad){&decodeQueue, key, texture};
+    async_read_file(imageReads, imagePath, decode_gltf_image, &imageLoads[i]);
+  }
+  async_read_batch_submit(imageReads);
+
+  ScratchArena scratch = get_thread_scratch_arena(arena);
+  size_t primitiveCount = header->primitives.count;
+  RenderData* renderData = arena_alloc_array(scratch.allocator, RenderData, primitiveCount);
+  for(size_t i = 0; i < primitiveCount; i++) {
+    const MeshCachePrimitive* prim = &cache->primitives[i];
+    GLenum indexType = prim->indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    renderData[i] = upload_render_data(cache->data + prim->vertexOffset, prim->vertexCount, prim->vertexFormat, cache->data + prim->indexOffset, prim->indexCount, indexType);
+    if(prim->vertexFormat & VERTEX_FORMAT_COMPRESSED) render_data_set_position_bounds(&renderData[i], prim->boundsMin, prim->boundsMax);
+    //the renderer culls with the meshlets every frame, they are copied out of the mapping that is closed after the load
+    Meshlet* meshlets = arena_alloc_array(arena, Meshlet, prim->meshletCount);
+    memcpy(meshlets, cache->data + prim->meshletOffset, prim->meshletCount*sizeof(Meshlet));
+    renderData[i].meshlets = meshlets;
+    renderData[i].meshletCount = prim->meshletCount;
+    async_read_batch_poll(imageReads);
+    texture_decode_upload_finished(&decodeQueue);
+  }
 
-  //buffer handling
-  for(int i = 0; i < bufferCount; i++) {
-    const cJSON* buffer = cJSON_GetArrayItem(buffers, i);
-    const cJSON* buffLen = cJSON_GetObjectItemCaseSensitive(buffer, "byteLength");
-    const cJSON* buffURI = cJSON_GetObjectItemCaseSensitive(buffer, "uri");
+  //the primitives are sorted by mesh, so the primitives of a mesh are a range
+  size_t meshCount = header->meshCount;
+  uint32_t* meshFirstPrimitive = arena_alloc_array(scratch.allocator, uint32_t, meshCount);
+  uint32_t* meshPrimitiveCount = arena_alloc_array(scratch.allocator, uint32_t, meshCount);
+  memset(meshPrimitiveCount, 0, meshCount*sizeof(uint32_t));
+  for(size_t i = primitiveCount; i-- > 0;) {
+    uint32_t mesh = cache->primitives[i].mesh;
+    meshFirstPrimitive[mesh] = i;
+    meshPrimitiveCount[mesh]++;
+  }
 
-    String uri;
-    uri.len = strlen(buffURI->valuestring);
-    uri.data = (const char*)buffURI->valuestring;
-    byte* data = arena_alloc_array(arena, byte, buffLen->valueint);
-    
-    Bytes bytes = (Bytes){data, buffLen->valueint};
-    if(string_contains(uri, create_string("data:"))) {
-      Cut cut = string_cut(uri, ';');
-      cut = string_cut(cut.tail, ',');
-      int base = string_to_int(string_span(cut.head.data+4, cut.head.data+cut.head.len));
-      if(base == 64) base64_decode(cut.tail, data);
-      else{ 
-        fprintf(stderr, "%d is an invalid base!", base);
+  size_t nodeCount = header->nodes.count;
+  size_t drawItemCount = 0;
+  for(size_t i = 0; i < nodeCount; i++) {
+    if(cache->nodes[i].mesh != -1) drawItemCount += meshPrimitiveCount[cache->nodes[i].mesh];
+  }
+  SceneGraph graph = create_scene_graph(arena, nodeCount, drawItemCount);
+
+  //every image has its texture once it has been read, the materials can only be made after that
+  async_read_batch_wait(imageReads);
+  //a primitive drawn by several nodes shares one material between its draw items
+  Material* materials = arena_alloc_array(scratch.allocator, Material, primitiveCount);
+  bool* hasMaterial = arena_alloc_array(scratch.allocator, bool, primitiveCount);
+  memset(hasMaterial, 0, primitiveCount*sizeof(bool));
+
+  uint32_t drawItem = 0;
+  for(uint32_t i = 0; i < nodeCount; i++) {
+    const MeshCacheNode* node = &cache->nodes[i];
+    graph.parents[i] = node->parent;
+    glm_vec3_copy((float*)node->translation, graph.translations[i]);
+    glm_vec4_copy((float*)node->rotation, graph.rotations[i]);
+    glm_vec3_copy((float*)node->scale, graph.scales[i]);
+
+    graph.firstDrawItems[i] = drawItem;
+    graph.drawItemCounts[i] = node->mesh == -1 ? 0 : meshPrimitiveCount[node->mesh];
+    for(uint32_t j = 0; j < graph.drawItemCounts[i]; j++, drawItem++) {
+      uint32_t primitive = meshFirstPrimitive[node->mesh] + j;
+      if(!hasMaterial[primitive]) {
+        materials[primitive] = load_material_from_mesh_cache(arena, &imageArray, cache, cache->primitives[primitive].material);
+        hasMaterial[primitive] = true;
       }
+      *array_index(Mesh, &graph.drawItems, drawItem) = (Mesh){renderData[primitive], materials[primitive], GLM_MAT4_IDENTITY_INIT};
+      graph.drawItemNodes[drawItem] = i;
     }
-    else {
-      int32_t index = string_find_reverse(filePath, '/');
-      String parentPath;
-      if(index == -1) parentPath = filePath; 
-      //+1 is there to include the '/'
-      else parentPath = string_span(filePath.data, filePath.data+index+1);
-      String resFile = (String){0};
-      resFile.data = buffURI->valuestring;
-      resFile.len = strlen(buffURI->valuestring);
-
-      String binFilePath = string_concatenate(arena, parentPath, resFile);
-      Ccreate_string(binFilePath, cBinFile);
-      
-      FILE* file = fopen(cBinFile, "rb");
-      if(!file) fprintf(stderr, "There is no binary file %s", cBinFile);
-      fread(data, buffLen->valueint, 1, file);
-      fclose(file);
-    }
-    array_set(Bytes, &bufferArray, i, bytes);
-  }
-
-  //buffer handling
-  for(int i = 0; i < imageCount; i++) {
-    const cJSON* image = cJSON_GetArrayItem(images, i);
-    const cJSON* imageURI = cJSON_GetObjectItemCaseSensitive(image, "uri");
-
-    String uri;
-    uri.len = strlen(imageURI->valuestring);
-    uri.data = (const char*)imageURI->valuestring;
-  
-    int32_t index = string_find_reverse(filePath, '/');
-    String parentPath;
-    if(index == -1) parentPath = filePath; 
-    //+1 is there to include the '/'
-    else parentPath = string_span(filePath.data, filePath.data+index+1);
-    String resFile = (String){0};
-    resFile.data = imageURI->valuestring;
-    resFile.len = strlen(imageURI->valuestring);
-
-    String binFilePath = string_concatenate(arena, parentPath, resFile);
-    Ccreate_string(binFilePath, cBinFile);
-    
-    GLuint texture = create_texture(cBinFile);
-    
-    array_set(GLuint, &imageArray, i, texture);
-  }
-  
-  size_t meshCount = meshes ? cJSON_GetArraySize(meshes) : 0;
-  Mesh* meshData = arena_alloc_array(arena, Mesh, meshCount);
-  Array(Mesh) result = create_array(Mesh, meshData, meshCount);
-  //Adding Models
-  for(int i = 0; i < meshCount; i++) {
-    const cJSON* mesh = cJSON_GetArrayItem(meshes, i);
-    const cJSON* primitives = cJSON_GetObjectItemCaseSensitive(mesh, "primitives");
-    //Adding Meshes
-    for(int j = 0; j < cJSON_GetArraySize(primitives); j++) {
-      const cJSON* prim = cJSON_GetArrayItem(primitives, j);
-      array_set(Mesh, &result, i, load_mesh_from_gltf(arena, &bufferArray, &imageArray, json, prim));
+  }
+  scene_graph_update(&graph);
+  release_scratch_arena(scratch);
+
+  texture_decode_wait(&decodeQueue);
+  //the materials hold their own references, images no material uses are deleted here
+  for(size_t i = 0; i < imageCount; i++) release_texture(*array_index(GLuint, &imageArray, i));
+  return graph;
+}
+
+/* Loads the default scene of the .gltf or .glb at filePath through its mesh cache (the file next to it with MESH_CACHE_EXTENSION appended).
+ * The cache is cooked the first time and again whenever it's stale, otherwise only the json is read (to hash it)
+ * and the .bin files and the binary chunk of a .glb aren't touched
+*/
+SceneGraph load_scene_from_gltf(Arena* arena, String filePath) {
+  memory_push_tag(MEMORY_TAG_GLTF);
+  //a .glb is used from a single mapping, its binary chunk is read where it is
+  FileView sourceView = open_file_view(filePath, FILE_VIEW_NORMAL);
+  GLBChunks chunks = {file_view_string(sourceView), {0}};
+  if(is_glb(chunks.json) && !read_glb_chunks(file_view_string(sourceView), &chunks)) {
+    fprintf(stderr, "Failed to load %.*s\n", (int)filePath.len, filePath.data);
+    fflush(stderr);
+    close_file_view(&sourceView);
+    memory_pop_tag();
+    return (SceneGraph){0};
+  }
+  //a cache cooked with the other vertex layout or index order is stale too
+  uint64_t sourceHash = wyhash(chunks.json.data, chunks.json.len, VERTEX_COMPRESSION | MESH_OPTIMIZATION << 1);
+
+  int32_t index = string_find_reverse(filePath, '/');
+  //+1 is there to include the '/'
+  String parentPath = index == -1 ? (String){0} : string_span(filePath.data, filePath.data+index+1);
+  String sourceName = string_span(filePath.data+parentPath.len, filePath.data+filePath.len);
+
+  const String extension = create_string_from_literal(MESH_CACHE_EXTENSION);
+  char cachePathData[filePath.len + extension.len];
+  memcpy(cachePathData, filePath.data, filePath.len);
+  memcpy(cachePathData + filePath.len, extension.data, extension.len);
+  String cachePath = {cachePathData, filePath.len + extension.len};
+
+  //only open the cache when it exists, a missing one isn't an error
+  MeshCache cache;
+  bool cacheValid = false;
+  FileView cacheView = {0};
+  int64_t cacheSize, cacheTime;
+  if(mesh_cache_stat_file((String){0}, cachePath, &cacheSize, &cacheTime)) {
+    cacheView = open_file_view(cachePath, FILE_VIEW_SEQUENTIAL);
+    cacheValid = open_mesh_cache(cacheView.data, cacheView.len, &cache) &&
+      cache.header->sourceHash == sourceHash &&
+      mesh_cache_dependencies_current(&cache, parentPath);
+  }
+
+  //the cooked data is only needed until the meshes are uploaded
+  ScratchArena scratch = get_thread_scratch_arena(arena);
+  if(!cacheValid) {
+    close_file_view(&cacheView);
+    MeshCacheWriter writer;
+    if(!cook_gltf(scratch.allocator, chunks.json, chunks.bin, sourceHash, parentPath, sourceName, &writer)) {
+      fprintf(stderr, "Failed to load %.*s\n", (int)filePath.len, filePath.data);
+      fflush(stderr);
+      release_scratch_arena(scratch);
+      close_file_view(&sourceView);
+      memory_pop_tag();
+      return (SceneGraph){0};
     }
+    write_file(cachePath, writer.data, writer.len);
+    open_mesh_cache(writer.data, writer.len, &cache);
   }
+  close_file_view(&sourceView);
 
-  cJSON_Delete(json);
+  SceneGraph result = load_mesh_cache(arena, &cache, filePath, parentPath);
+  release_scratch_arena(scratch);
+  close_file_view(&cacheView);
+  memory_pop_tag();
   return result;
 }
-*/
+
+// Every primitive of every node of the glTF at filePath as a mesh with its world transform
+Array(Mesh) extract_meshes_from_gltf(Arena* arena, String filePath) { return load_scene_from_gltf(arena, filePath).drawItems; }
+
 
 #endif
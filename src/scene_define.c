@@ -6,6 +6,7 @@
 #include "data_types/array.c"
 #include "data_types/hashtable.c"
 #include "shader_type.c"
+#include "meshlet.c"
 
 //Data used for a scene
 typedef struct {
@@ -33,6 +34,15 @@ typedef struct {
   GLuint vbo;
   GLuint ebo;
   size_t indexCount;
+  GLenum indexType; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  uint32_t vertexCount;
+  uint32_t vertexFormat; // VertexFormat flags
+  // a compressed position is decoded as positionOffset + unorm * positionScale
+  vec3 positionOffset;
+  vec3 positionScale;
+  // the index buffer is the triangles of the meshlets one after another, meshletCount is 0 when the mesh isn't split (not a triangle list)
+  const Meshlet* meshlets;
+  uint32_t meshletCount;
 } RenderData;
 
 typedef union {
@@ -55,23 +65,13 @@ typedef struct {
   Sampler sampler;
 } SamplerValue;
 
-uint64_t hashUniformString(String string) {
-  uint64_t hash = 0;
-  for(int i = 0; i < string.len && i < 2; i++) {
-    hash += string.data[i];
-    hash <<= 8;
-    hash += string.data[string.len-1-i];
-    hash <<= 8;
-  }
-  return hash;
-}
-DEFINE_HASH_TABLE(String, UniformValue, hashUniformString, string_equals)
-DEFINE_HASH_TABLE(String, SamplerValue, hashUniformString, string_equals)
+DEFINE_HASH_TABLE(InternedString, UniformValue, interned_string_hash, interned_string_equals)
+DEFINE_HASH_TABLE(InternedString, SamplerValue, interned_string_hash, interned_string_equals)
 
 typedef struct {
   const ShaderProgram* shaderProgram;
-  HashTable(String, UniformValue) uniformProperties;
-  HashTable(String, SamplerValue) samplerProperties;
+  HashTable(InternedString, UniformValue) uniformProperties;
+  HashTable(InternedString, SamplerValue) samplerProperties;
 } Material;
 
 // The mesh is contains all the data for rendering geometry and material
@@ -0,0 +1,83 @@
+#ifndef SCENE_GRAPH_IMPL
+#define SCENE_GRAPH_IMPL
+
+#include <cglm/cglm.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "data_types/arena.c"
+#include "data_types/array.c"
+#include "scene_define.c"
+
+/* A node hierarchy flattened into arrays, one entry per node in each array (structure of arrays).
+ * Nodes are sorted so a parent always comes before its children, so the world matrices are updated in a single
+ * linear pass where the parent's world matrix is always ready: world[i] = world[parent[i]] * local[i].
+ * Every primitive a node draws is a draw item, the draw items of a node are the range [firstDrawItem, firstDrawItem + drawItemCount).
+ * The draw items are Meshes so they can be rendered as they are, scene_graph_update writes their model matrices
+*/
+typedef struct {
+  uint32_t nodeCount;
+  int32_t* parents; // -1 for roots
+  vec3* translations;
+  versor* rotations;
+  vec3* scales;
+  mat4* localMatrices;
+  mat4* worldMatrices;
+  uint32_t* firstDrawItems;
+  uint32_t* drawItemCounts;
+
+  Array(Mesh) drawItems;
+  uint32_t* drawItemNodes;
+} SceneGraph;
+
+// the matrices are aligned for the simd paths of cglm
+#define SCENE_GRAPH_MATRIX_ALIGNMENT 32
+
+SceneGraph create_scene_graph(Arena* arena, uint32_t nodeCount, uint32_t drawItemCount) {
+  SceneGraph graph = {.nodeCount=nodeCount};
+  graph.parents = arena_alloc_array(arena, int32_t, nodeCount);
+  graph.translations = arena_alloc_array(arena, vec3, nodeCount);
+  graph.rotations = arena_alloc_align(arena, sizeof(versor) * nodeCount, SCENE_GRAPH_MATRIX_ALIGNMENT);
+  graph.scales = arena_alloc_array(arena, vec3, nodeCount);
+  graph.localMatrices = arena_alloc_align(arena, sizeof(mat4) * nodeCount, SCENE_GRAPH_MATRIX_ALIGNMENT);
+  graph.worldMatrices = arena_alloc_align(arena, sizeof(mat4) * nodeCount, SCENE_GRAPH_MATRIX_ALIGNMENT);
+  graph.firstDrawItems = arena_alloc_array(arena, uint32_t, nodeCount);
+  graph.drawItemCounts = arena_alloc_array(arena, uint32_t, nodeCount);
+
+  Mesh* drawItemData = arena_alloc_array(arena, Mesh, drawItemCount);
+  graph.drawItems = create_array(Mesh, drawItemData, drawItemCount);
+  graph.drawItemNodes = arena_alloc_array(arena, uint32_t, drawItemCount);
+  return graph;
+}
+
+// local = translation * rotation * scale, the scale only multiplies the columns of the rotation
+void scene_graph_update_local(SceneGraph* graph) {
+  for(uint32_t i = 0; i < graph->nodeCount; i++) {
+    mat4* local = &graph->localMatrices[i];
+    glm_quat_mat4(graph->rotations[i], *local);
+    glm_vec4_scale((*local)[0], graph->scales[i][0], (*local)[0]);
+    glm_vec4_scale((*local)[1], graph->scales[i][1], (*local)[1]);
+    glm_vec4_scale((*local)[2], graph->scales[i][2], (*local)[2]);
+    glm_vec3_copy(graph->translations[i], (*local)[3]);
+  }
+}
+
+void scene_graph_update_world(SceneGraph* graph) {
+  for(uint32_t i = 0; i < graph->nodeCount; i++) {
+    int32_t parent = graph->parents[i];
+    if(parent < 0) glm_mat4_copy(graph->localMatrices[i], graph->worldMatrices[i]);
+    else glm_mat4_mul(graph->worldMatrices[parent], graph->localMatrices[i], graph->worldMatrices[i]);
+  }
+}
+
+// Recomputes every transform after the local TRS changed and gives the draw items their new model matrices
+void scene_graph_update(SceneGraph* graph) {
+  scene_graph_update_local(graph);
+  scene_graph_update_world(graph);
+  for(size_t i = 0; i < graph->drawItems.length; i++) {
+    glm_mat4_copy(graph->worldMatrices[graph->drawItemNodes[i]], array_index(Mesh, &graph->drawItems, i)->modelMatrix);
+  }
+}
+
+#endif
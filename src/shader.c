@@ -6,7 +6,8 @@
 #include "data_types/string.c"
 #include "data_types/io.c"
 
-#define create_shader_program(void) (ShaderProgram){glCreateProgram(), create_dynamic_array(Uniform, 16)};
+//the uniform list is kept in the arena, it grows in place when nothing else was allocated after it
+#define create_shader_program(arena) (ShaderProgram){glCreateProgram(), create_arena_dynamic_array(Uniform, arena, 16)}
 
 UniformType string_to_uniform_type(String type) {
   //This function assumes that the 'type' is valid!!!
@@ -60,11 +61,13 @@ UniformType string_to_uniform_type(String type) {
 }
 
 void attach_shader_to_program(Arena* arena, ShaderProgram* shaderProgram, GLenum shaderType, String filePath) {
+  memory_push_tag(MEMORY_TAG_SHADER);
   int success;
   char infoLog[512];
 
   GLuint shader = glCreateShader(shaderType);
-  String shaderSource = read_file(arena, filePath);
+  FileView sourceView = open_file_view(filePath, FILE_VIEW_SEQUENTIAL);
+  String shaderSource = file_view_string(sourceView);
   const String strUniform = create_string_from_literal("uniform");
   const String strDoubleSlash = create_string_from_literal("//");
   //File Parsing
@@ -86,17 +89,17 @@ void attach_shader_to_program(Arena* arena, ShaderProgram* shaderProgram, GLenum
     keywordCut = string_cut(string_trim_left(keywordCut.tail, create_string_from_literal(" ")), ' ');
     String type = keywordCut.head;
     String name = string_trim_right(keywordCut.tail, create_string_from_literal(" ;"));
-    Uniform uniform = (Uniform){string_to_uniform_type(type), name, 0};
+    Uniform uniform = (Uniform){string_to_uniform_type(type), intern_string(name), 0};
     dynamic_array_append(Uniform, &shaderProgram->uniforms, &uniform);
   }
   
-  //Compliation and stuff
-  char cShaderSource[shaderSource.len+1];
-  string_to_c_str(shaderSource, cShaderSource);
-  const char* source = cShaderSource;
+  //Compliation and stuff (the length is passed so the source doesn't need to be null terminated)
+  const char* source = shaderSource.data;
+  GLint sourceLength = shaderSource.len;
 
-  glShaderSource(shader, 1, &source, NULL);
+  glShaderSource(shader, 1, &source, &sourceLength);
   glCompileShader(shader);
+  close_file_view(&sourceView);
 
   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
   if (!success) {
@@ -108,6 +111,7 @@ void attach_shader_to_program(Arena* arena, ShaderProgram* shaderProgram, GLenum
   }
   glAttachShader(shaderProgram->id, shader);
   glDeleteShader(shader);
+  memory_pop_tag();
 }
 
 void finalize_shader_program(ShaderProgram* shaderProgram) {
@@ -127,8 +131,8 @@ void finalize_shader_program(ShaderProgram* shaderProgram) {
   //setup the uniform locations
   for(size_t i = 0; i < shaderProgram->uniforms.length; i++) {
     Uniform* uniform = dynamic_array_index(Uniform, &shaderProgram->uniforms, i);
-    char uniformName[uniform->name.len+1];
-    string_to_c_str(uniform->name, uniformName);
+    //interned strings are always null terminated
+    const char* uniformName = uniform->name.string.data;
 
     int location = glGetUniformLocation(shaderProgram->id, uniformName);
 
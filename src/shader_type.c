@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include "data_types/string.c"
 #include "data_types/array.c"
+#include "data_types/intern.c"
 
 typedef enum {
   UNIFORM_TYPE_BOOL = 0,
@@ -33,7 +34,7 @@ typedef enum {
 
 typedef struct {
   UniformType type;
-  String name;
+  InternedString name;
   int location;
 } Uniform;
 
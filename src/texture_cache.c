@@ -0,0 +1,190 @@
+#ifndef TEXTURE_CACHE_IMPL
+#define TEXTURE_CACHE_IMPL
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "data_types/arena.c"
+#include "data_types/string.c"
+#include "data_types/hashtable.c"
+#include "data_types/intern.c"
+#include "data_types/io.c"
+#include "data_types/memory_stats.c"
+#include "opengl_utils.c"
+
+/* Every texture loaded from an image file goes through this cache so a file is only decoded and uploaded once.
+ * Textures are found by the canonical path of the file and by a hash of its contents,
+ * so the same image under two paths (or copied next to two different gltf files) is shared too.
+ * Each texture has a refcount, acquire/retain add a reference and the GL texture is deleted when the last one is released.
+ * Textures that didn't come from the cache (render targets, environment maps...) can be passed to retain/release, they are ignored.
+ * The cache isn't thread safe, it's used from the GL thread
+*/
+typedef struct {
+  uint32_t refCount;
+  uint64_t contentHash;
+} TextureCacheEntry;
+
+static uint64_t texture_cache_id_hash(GLuint texture) { return texture; }
+static bool texture_cache_id_equals(GLuint a, GLuint b) { return a == b; }
+// content hashes are already well mixed
+static uint64_t texture_cache_content_hash(uint64_t hash) { return hash; }
+static bool texture_cache_content_equals(uint64_t a, uint64_t b) { return a == b; }
+
+DEFINE_HASH_TABLE(GLuint, TextureCacheEntry, texture_cache_id_hash, texture_cache_id_equals)
+DEFINE_HASH_TABLE(InternedString, GLuint, interned_string_hash, interned_string_equals)
+DEFINE_HASH_TABLE(uint64_t, GLuint, texture_cache_content_hash, texture_cache_content_equals)
+
+static struct {
+  bool initialized;
+  HashTable(GLuint, TextureCacheEntry) entries;
+  HashTable(InternedString, GLuint) paths;
+  HashTable(uint64_t, GLuint) contents;
+  GLuint whiteTexture;
+} textureCache;
+
+static void texture_cache_init(void) {
+  if(textureCache.initialized) return;
+  textureCache.entries = create_hash_table(GLuint, TextureCacheEntry, NULL, 64);
+  textureCache.paths = create_hash_table(InternedString, GLuint, NULL, 64);
+  textureCache.contents = create_hash_table(uint64_t, GLuint, NULL, 64);
+  textureCache.initialized = true;
+}
+
+// The path the cache knows a file by, "a/../b.png" and "./b.png" are the same file (falls back to the path as written when it doesn't exist)
+InternedString texture_cache_path_key(String path) {
+  char cPath[path.len + 1];
+  string_to_c_str(path, cPath);
+  char resolved[PATH_MAX];
+  if(!realpath(cPath, resolved)) return intern_string(path);
+  return intern_string((String){resolved, strlen(resolved)});
+}
+
+// The name of an image stored inside another file (a .glb), "<canonical path of the file>#<index>"
+InternedString texture_cache_embedded_key(String containerPath, uint32_t index) {
+  char cPath[containerPath.len + 1];
+  string_to_c_str(containerPath, cPath);
+  char resolved[PATH_MAX + 16];
+  if(!realpath(cPath, resolved)) snprintf(resolved, sizeof(resolved), "%s", cPath);
+  size_t len = strlen(resolved);
+  snprintf(resolved + len, sizeof(resolved) - len, "#%u", index);
+  return intern_string((String){resolved, strlen(resolved)});
+}
+
+uint64_t texture_cache_hash_contents(const void* data, size_t len) { return wyhash(data, len, 0); }
+
+// Adds a reference to a cached texture, does nothing for other textures
+void retain_texture(GLuint texture) {
+  if(!textureCache.initialized) return;
+  TextureCacheEntry* entry = hash_table_index(GLuint, TextureCacheEntry, &textureCache.entries, texture);
+  if(entry) entry->refCount++;
+}
+
+// Drops a reference to a cached texture, the texture is deleted with the last one. Does nothing for other textures
+void release_texture(GLuint texture) {
+  if(!textureCache.initialized) return;
+  TextureCacheEntry* entry = hash_table_index(GLuint, TextureCacheEntry, &textureCache.entries, texture);
+  if(!entry || --entry->refCount) return;
+
+  hash_table_remove(uint64_t, GLuint, &textureCache.contents, entry->contentHash);
+  hash_table_remove(GLuint, TextureCacheEntry, &textureCache.entries, texture);
+  //a texture can be known by several paths
+  hash_table_foreach(InternedString, GLuint, &textureCache.paths, pair, {
+    if(pair->value == texture) hash_table_remove(InternedString, GLuint, &textureCache.paths, pair->key);
+  })
+
+#ifdef MEMORY_TRACKING
+  GLint width = 0, height = 0;
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  memory_track_free(MEMORY_TAG_GL_TEXTURE, (size_t)width * height * 4 * 4 / 3);
+#endif
+  glDeleteTextures(1, &texture);
+}
+
+// The cached texture of the file at the path (retained), 0 when the file hasn't been loaded yet
+GLuint texture_cache_find_path(InternedString path) {
+  texture_cache_init();
+  GLuint texture = hash_table_get(InternedString, GLuint, &textureCache.paths, path, 0);
+  retain_texture(texture);
+  return texture;
+}
+
+/* The cached texture with the same contents (retained), 0 when there isn't one.
+ * On a hit path becomes another name of the texture
+*/
+GLuint texture_cache_find_contents(InternedString path, uint64_t contentHash) {
+  texture_cache_init();
+  GLuint texture = hash_table_get(uint64_t, GLuint, &textureCache.contents, contentHash, 0);
+  if(!texture) return 0;
+  retain_texture(texture);
+  hash_table_set(InternedString, GLuint, &textureCache.paths, path, texture);
+  return texture;
+}
+
+// Registers a texture that was just created for the file at path, the caller holds the first reference
+void texture_cache_insert(GLuint texture, InternedString path, uint64_t contentHash) {
+  texture_cache_init();
+  hash_table_set(GLuint, TextureCacheEntry, &textureCache.entries, texture, ((TextureCacheEntry){1, contentHash}));
+  hash_table_set(InternedString, GLuint, &textureCache.paths, path, texture);
+  hash_table_set(uint64_t, GLuint, &textureCache.contents, contentHash, texture);
+}
+
+/* A 1x1 white texture (with a new reference) for the files that can't be loaded. The cache keeps a reference of its own so it's never deleted,
+ * it isn't known by any path or contents so a file that failed is tried again the next time it's acquired
+*/
+GLuint texture_cache_white_texture(void) {
+  texture_cache_init();
+  if(!textureCache.whiteTexture) {
+    static const unsigned char white[4] = {255, 255, 255, 255};
+    textureCache.whiteTexture = generate_texture();
+    upload_texture_rgba(textureCache.whiteTexture, white, 1, 1);
+    hash_table_set(GLuint, TextureCacheEntry, &textureCache.entries, textureCache.whiteTexture, ((TextureCacheEntry){1, 0}));
+  }
+  retain_texture(textureCache.whiteTexture);
+  return textureCache.whiteTexture;
+}
+
+// The texture of the image file at path with a new reference, the file is only loaded the first time (the white texture when it can't be)
+GLuint acquire_texture(String path) {
+  InternedString key = texture_cache_path_key(path);
+  GLuint texture = texture_cache_find_path(key);
+  if(texture) return texture;
+
+  ScratchArena scratch = get_thread_scratch_arena(NULL);
+  String contents = read_file(scratch.allocator, path);
+  if(!contents.len) {
+    //a file that can't be opened was already reported by read_file
+    if(contents.data) {
+      fprintf(stderr, "Texture %.*s is empty, it is drawn white\n", (int)path.len, path.data);
+      fflush(stderr);
+    }
+    release_scratch_arena(scratch);
+    return texture_cache_white_texture();
+  }
+  uint64_t contentHash = texture_cache_hash_contents(contents.data, contents.len);
+  texture = texture_cache_find_contents(key, contentHash);
+  if(!texture) {
+    texture = generate_texture();
+    if(!load_texture_from_memory(texture, contents.data, contents.len)) {
+      fprintf(stderr, "Failed to decode texture %.*s (%s), it is drawn white\n", (int)path.len, path.data, stbi_failure_reason());
+      fflush(stderr);
+      glDeleteTextures(1, &texture);
+      release_scratch_arena(scratch);
+      return texture_cache_white_texture();
+    }
+    texture_cache_insert(texture, key, contentHash);
+  }
+  release_scratch_arena(scratch);
+  return texture;
+}
+
+#define acquire_texture_literal(path) acquire_texture(create_string_from_literal(path))
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef VERTEX_PACK_IMPL
+#define VERTEX_PACK_IMPL
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+// Which optional attributes follow the position in an interleaved vertex, the attributes are always in this order
+typedef enum {
+  VERTEX_FORMAT_NORMAL = 1 << 0,
+  VERTEX_FORMAT_TEXCOORD = 1 << 1,
+  /* The smaller layout: the position as 3 unorm16 (and 2 bytes of padding) inside the bounds of the mesh,
+   * the normal octahedral encoded in 2 snorm16 and the texture coordinate as 2 half floats.
+   * Every attribute is half the size or less, vertex.glsl decodes the position and normal
+  */
+  VERTEX_FORMAT_COMPRESSED = 1 << 2,
+} VertexFormat;
+
+uint32_t vertex_format_stride(uint32_t format) {
+  bool compressed = format & VERTEX_FORMAT_COMPRESSED;
+  uint32_t stride = compressed ? 4*sizeof(uint16_t) : 3*sizeof(float);
+  if(format & VERTEX_FORMAT_NORMAL) stride += compressed ? 2*sizeof(int16_t) : 3*sizeof(float);
+  if(format & VERTEX_FORMAT_TEXCOORD) stride += compressed ? 2*sizeof(uint16_t) : 2*sizeof(float);
+  return stride;
+}
+
+uint32_t vertex_format_normal_offset(uint32_t format) { return format & VERTEX_FORMAT_COMPRESSED ? 4*sizeof(uint16_t) : 3*sizeof(float); }
+
+uint32_t vertex_format_texcoord_offset(uint32_t format) {
+  uint32_t offset = vertex_format_normal_offset(format);
+  if(format & VERTEX_FORMAT_NORMAL) offset += format & VERTEX_FORMAT_COMPRESSED ? 2*sizeof(int16_t) : 3*sizeof(float);
+  return offset;
+}
+
+/* Interleaving the attributes of a mesh into the vertex buffer layout (pack) and splitting a vertex buffer back into
+ * one tight array per attribute (unpack).
+ * There is a loop for every vertex format so nothing is decided per vertex, and pack gets a second copy of each loop
+ * for tight sources so the compiler sees constant strides.
+ * The SIMD loops move every attribute with one 16 byte load and one 16 byte store. The bytes past the end of the attribute
+ * land in the next attribute or vertex and are overwritten when that is written, so the last vertex is copied with memcpy
+ * and nothing is read or written past the ends of the buffers.
+ * Define VERTEX_PACK_NO_SIMD to force the scalar versions
+*/
+#if defined(__SSE2__) && !defined(VERTEX_PACK_NO_SIMD)
+#include <emmintrin.h>
+#define VERTEX_PACK_SIMD 1
+typedef __m128 VertexPackSimd;
+static inline VertexPackSimd vertex_pack_load(const char* p) { return _mm_loadu_ps((const float*)p); }
+static inline void vertex_pack_store(char* p, VertexPackSimd v) { _mm_storeu_ps((float*)p, v); }
+static inline VertexPackSimd vertex_pack_splat(float f) { return _mm_set1_ps(f); }
+static inline VertexPackSimd vertex_pack_min(VertexPackSimd a, VertexPackSimd b) { return _mm_min_ps(a, b); }
+static inline VertexPackSimd vertex_pack_max(VertexPackSimd a, VertexPackSimd b) { return _mm_max_ps(a, b); }
+
+#elif defined(__ARM_NEON) && !defined(VERTEX_PACK_NO_SIMD)
+#include <arm_neon.h>
+#define VERTEX_PACK_SIMD 1
+typedef float32x4_t VertexPackSimd;
+static inline VertexPackSimd vertex_pack_load(const char* p) { return vreinterpretq_f32_u8(vld1q_u8((const uint8_t*)p)); }
+static inline void vertex_pack_store(char* p, VertexPackSimd v) { vst1q_u8((uint8_t*)p, vreinterpretq_u8_f32(v)); }
+static inline VertexPackSimd vertex_pack_splat(float f) { return vdupq_n_f32(f); }
+static inline VertexPackSimd vertex_pack_min(VertexPackSimd a, VertexPackSimd b) { return vminq_f32(a, b); }
+static inline VertexPackSimd vertex_pack_max(VertexPackSimd a, VertexPackSimd b) { return vmaxq_f32(a, b); }
+#endif
+
+// An attribute in memory, stride is the distance in bytes from one element to the next
+typedef struct {
+  const void* data;
+  size_t stride;
+} VertexStream;
+
+// The float position of one vertex of the stream
+static inline void load_position(VertexStream position, uint32_t vertex, float result[3]) {
+  memcpy(result, (const char*)position.data + vertex*position.stride, 3*sizeof(float));
+}
+
+// The bounds of count positions
+void vertex_position_bounds(VertexStream position, size_t count, float* boundsMin, float* boundsMax) {
+  const char* positionData = position.data;
+  float minimum[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+  float maximum[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+  size_t i = 0;
+#ifdef VERTEX_PACK_SIMD
+  if(position.stride >= 3*sizeof(float) && count > 1) {
+    VertexPackSimd simdMin = vertex_pack_splat(FLT_MAX);
+    VertexPackSimd simdMax = vertex_pack_splat(-FLT_MAX);
+    for(; i + 1 < count; i++) {
+      VertexPackSimd p = vertex_pack_load(positionData + i*position.stride);
+      simdMin = vertex_pack_min(p, simdMin);
+      simdMax = vertex_pack_max(p, simdMax);
+    }
+    vertex_pack_store((char*)minimum, simdMin);
+    vertex_pack_store((char*)maximum, simdMax);
+  }
+#endif
+  for(; i < count; i++) {
+    float p[3];
+    memcpy(p, positionData + i*position.stride, 3*sizeof(float));
+    for(uint8_t j = 0; j < 3; j++) {
+      minimum[j] = fminf(minimum[j], p[j]);
+      maximum[j] = fmaxf(maximum[j], p[j]);
+    }
+  }
+  memcpy(boundsMin, minimum, 3*sizeof(float));
+  memcpy(boundsMax, maximum, 3*sizeof(float));
+}
+
+//------------------------------------------
+// Compressed vertices
+//------------------------------------------
+
+// Round to nearest even, values too large for a half become infinity
+uint16_t float_to_half(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7fffffff;
+  if(magnitude >= 0x7f800000) return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+  if(magnitude >= 0x477ff000) return sign | 0x7c00; // 65520 and above round past the largest half
+  if(magnitude < 0x38800000) {
+    //too small for a normal half, the subnormal halves are multiples of 2^-24
+    float absolute;
+    memcpy(&absolute, &magnitude, sizeof(absolute));
+    //adding 2^23 leaves no bits below 1 so the add rounds to nearest even, without a call to lrintf
+    return sign | (uint16_t)(absolute * 16777216.0f + 8388608.0f - 8388608.0f);
+  }
+  //move the exponent from the float bias (127) to the half bias (15) and round the 13 bits that are cut off
+  magnitude += 0xc8000fff + ((magnitude >> 13) & 1);
+  return sign | (uint16_t)(magnitude >> 13);
+}
+
+float half_to_float(uint16_t half) {
+  uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+  float value;
+  if(exponent == 0) value = (float)mantissa / 16777216.0f;
+  else if(exponent == 0x1f) value = mantissa ? NAN : INFINITY;
+  else {
+    uint32_t bits = ((exponent + 112) << 23) | (mantissa << 13);
+    memcpy(&value, &bits, sizeof(value));
+  }
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits |= sign;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Rounds half away from zero. Comparisons instead of fminf/fmaxf and lrintf, those are calls unless errno and NaN handling are turned off
+static inline int16_t vertex_quantize_snorm16(float value) {
+  float q = (value < -1.0f ? -1.0f : value > 1.0f ? 1.0f : value) * 32767.0f;
+  return (int16_t)(q + (q >= 0.0f ? 0.5f : -0.5f));
+}
+
+/* Maps the unit sphere onto the [-1, 1] square: the normal is projected onto the octahedron |x| + |y| + |z| = 1
+ * and the lower half is folded over the diagonals. vertex.glsl has the inverse
+*/
+void octahedral_encode(const float normal[3], int16_t result[2]) {
+  float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+  float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+  float x = normal[0] * inverseLength;
+  float y = normal[1] * inverseLength;
+  //selects instead of a branch, the side of the fold is random from one vertex to the next
+  float foldedX = (1.0f - fabsf(y)) * copysignf(1.0f, x);
+  float foldedY = (1.0f - fabsf(x)) * copysignf(1.0f, y);
+  bool lower = normal[2] < 0.0f;
+  result[0] = vertex_quantize_snorm16(lower ? foldedX : x);
+  result[1] = vertex_quantize_snorm16(lower ? foldedY : y);
+}
+
+void octahedral_decode(const int16_t encoded[2], float result[3]) {
+  float x = fmaxf(encoded[0] / 32767.0f, -1.0f);
+  float y = fmaxf(encoded[1] / 32767.0f, -1.0f);
+  float z = 1.0f - fabsf(x) - fabsf(y);
+  float t = fmaxf(-z, 0.0f);
+  x += x >= 0.0f ? -t : t;
+  y += y >= 0.0f ? -t : t;
+  float length = sqrtf(x*x + y*y + z*z);
+  result[0] = x / length;
+  result[1] = y / length;
+  result[2] = z / length;
+}
+
+static inline uint16_t vertex_quantize_unorm16(float value, float min, float scale) {
+  float q = (value - min) * scale + 0.5f;
+  return q <= 0.0f ? 0 : q >= 65535.0f ? 65535 : (uint16_t)q;
+}
+
+static inline __attribute__((always_inline)) void pack_compressed_vertices_kernel(char* vertexData, uint32_t format, VertexStream position, VertexStream normal, VertexStream texCoord, size_t count, const float* boundsMin, const float* boundsMax) {
+  const uint32_t stride = vertex_format_stride(format);
+  const uint32_t normalOffset = vertex_format_normal_offset(format);
+  const uint32_t texCoordOffset = vertex_format_texcoord_offset(format);
+  float scale[3];
+  for(uint8_t j = 0; j < 3; j++) {
+    float extent = boundsMax[j] - boundsMin[j];
+    scale[j] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+  }
+
+  for(size_t i = 0; i < count; i++) {
+    char* vertex = vertexData + i*stride;
+    float p[3];
+    memcpy(p, (const char*)position.data + i*position.stride, sizeof(p));
+    //whole words built with shifts, small arrays copied out stall on the store forwarding
+    uint64_t quantized = vertex_quantize_unorm16(p[0], boundsMin[0], scale[0]) | (uint64_t)vertex_quantize_unorm16(p[1], boundsMin[1], scale[1]) << 16 | (uint64_t)vertex_quantize_unorm16(p[2], boundsMin[2], scale[2]) << 32;
+    memcpy(vertex, &quantized, sizeof(quantized));
+    if(format & VERTEX_FORMAT_NORMAL) {
+      float n[3];
+      int16_t encoded[2];
+      memcpy(n, (const char*)normal.data + i*normal.stride, sizeof(n));
+      octahedral_encode(n, encoded);
+      memcpy(vertex + normalOffset, encoded, sizeof(encoded));
+    }
+    if(format & VERTEX_FORMAT_TEXCOORD) {
+      float t[2];
+      memcpy(t, (const char*)texCoord.data + i*texCoord.stride, sizeof(t));
+      uint32_t half = float_to_half(t[0]) | (uint32_t)float_to_half(t[1]) << 16;
+      memcpy(vertex + texCoordOffset, &half, sizeof(half));
+    }
+  }
+}
+
+#define PACK_COMPRESSED_VERTICES_CASE(format) case format: pack_compressed_vertices_kernel(vertexData, format, position, normal, texCoord, count, boundsMin, boundsMax); break;
+
+/* pack_vertices for VERTEX_FORMAT_COMPRESSED, the positions are quantized inside boundsMin/boundsMax which have to be found first.
+ * A position is decoded as boundsMin + unorm * (boundsMax - boundsMin)
+*/
+void pack_compressed_vertices(void* vertexData, uint32_t format, VertexStream position, VertexStream normal, VertexStream texCoord, size_t count, const float* boundsMin, const float* boundsMax) {
+  switch(format | VERTEX_FORMAT_COMPRESSED) {
+    PACK_COMPRESSED_VERTICES_CASE(VERTEX_FORMAT_COMPRESSED)
+    PACK_COMPRESSED_VERTICES_CASE(VERTEX_FORMAT_COMPRESSED | VERTEX_FORMAT_NORMAL)
+    PACK_COMPRESSED_VERTICES_CASE(VERTEX_FORMAT_COMPRESSED | VERTEX_FORMAT_TEXCOORD)
+    PACK_COMPRESSED_VERTICES_CASE(VERTEX_FORMAT_COMPRESSED | VERTEX_FORMAT_NORMAL | VERTEX_FORMAT_TEXCOORD)
+  }
+}
+
+#undef PACK_COMPRESSED_VERTICES_CASE
+
+//------------------------------------------
+// Packing
+//------------------------------------------
+
+// Inlined with a constant format (and constant strides for tight streams) so every branch on them disappears
+static inline __attribute__((always_inline)) void pack_vertices_kernel(char* vertexData, uint32_t format, bool simd, VertexStream position, VertexStream normal, VertexStream texCoord, size_t count, float* boundsMin, float* boundsMax) {
+  const uint32_t stride = vertex_format_stride(format);
+  const uint32_t texCoordOffset = vertex_format_texcoord_offset(format);
+  const char* positionData = position.data;
+  const char* normalData = normal.data;
+  const char* texCoordData = texCoord.data;
+
+  float minimum[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+  float maximum[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+  size_t i = 0;
+#ifdef VERTEX_PACK_SIMD
+  if(simd && count > 1) {
+    VertexPackSimd simdMin = vertex_pack_splat(FLT_MAX);
+    VertexPackSimd simdMax = vertex_pack_splat(-FLT_MAX);
+    for(; i + 1 < count; i++) {
+      char* vertex = vertexData + i*stride;
+      VertexPackSimd p = vertex_pack_load(positionData + i*position.stride);
+      //the 4th lane is whatever followed the position, it's never read back. p goes first so a NaN is skipped like fminf does (on SSE)
+      simdMin = vertex_pack_min(p, simdMin);
+      simdMax = vertex_pack_max(p, simdMax);
+      vertex_pack_store(vertex, p);
+      if(format & VERTEX_FORMAT_NORMAL) vertex_pack_store(vertex + 3*sizeof(float), vertex_pack_load(normalData + i*normal.stride));
+      if(format & VERTEX_FORMAT_TEXCOORD) vertex_pack_store(vertex + texCoordOffset, vertex_pack_load(texCoordData + i*texCoord.stride));
+    }
+    vertex_pack_store((char*)minimum, simdMin);
+    vertex_pack_store((char*)maximum, simdMax);
+  }
+#endif
+  for(; i < count; i++) {
+    char* vertex = vertexData + i*stride;
+    float p[3];
+    memcpy(p, positionData + i*position.stride, 3*sizeof(float));
+    for(uint8_t j = 0; j < 3; j++) {
+      minimum[j] = fminf(minimum[j], p[j]);
+      maximum[j] = fmaxf(maximum[j], p[j]);
+    }
+    memcpy(vertex, p, 3*sizeof(float));
+    if(format & VERTEX_FORMAT_NORMAL) memcpy(vertex + 3*sizeof(float), normalData + i*normal.stride, 3*sizeof(float));
+    if(format & VERTEX_FORMAT_TEXCOORD) memcpy(vertex + texCoordOffset, texCoordData + i*texCoord.stride, 2*sizeof(float));
+  }
+  if(boundsMin) memcpy(boundsMin, minimum, 3*sizeof(float));
+  if(boundsMax) memcpy(boundsMax, maximum, 3*sizeof(float));
+}
+
+#define PACK_VERTICES_CASE(format)\
+  case format:\
+    if(tight) pack_vertices_kernel(vertexData, format, simd, (VertexStream){position.data, 3*sizeof(float)}, (VertexStream){normal.data, 3*sizeof(float)}, (VertexStream){texCoord.data, 2*sizeof(float)}, count, boundsMin, boundsMax);\
+    else pack_vertices_kernel(vertexData, format, simd, position, normal, texCoord, count, boundsMin, boundsMax);\
+    break;
+
+/* Interleaves count vertices into vertexData in the layout of format (vertex_format_stride(format)*count bytes),
+ * the streams of attributes that aren't in the format are ignored.
+ * The bounds of the positions are written to boundsMin/boundsMax when they aren't NULL, a compressed format needs them to decode the positions
+*/
+void pack_vertices(void* vertexData, uint32_t format, VertexStream position, VertexStream normal, VertexStream texCoord, size_t count, float* boundsMin, float* boundsMax) {
+  if(format & VERTEX_FORMAT_COMPRESSED) {
+    float minimum[3], maximum[3];
+    vertex_position_bounds(position, count, minimum, maximum);
+    pack_compressed_vertices(vertexData, format, position, normal, texCoord, count, minimum, maximum);
+    if(boundsMin) memcpy(boundsMin, minimum, sizeof(minimum));
+    if(boundsMax) memcpy(boundsMax, maximum, sizeof(maximum));
+    return;
+  }
+  bool hasNormal = format & VERTEX_FORMAT_NORMAL;
+  bool hasTexCoord = format & VERTEX_FORMAT_TEXCOORD;
+  bool tight = position.stride == 3*sizeof(float) && (!hasNormal || normal.stride == 3*sizeof(float)) && (!hasTexCoord || texCoord.stride == 2*sizeof(float));
+  //elements that overlap (a stride smaller than the element) would let the 16 byte loads run past the end of the stream
+  bool simd = position.stride >= 3*sizeof(float) && (!hasNormal || normal.stride >= 3*sizeof(float)) && (!hasTexCoord || texCoord.stride >= 2*sizeof(float));
+
+  switch(format) {
+    PACK_VERTICES_CASE(0)
+    PACK_VERTICES_CASE(VERTEX_FORMAT_NORMAL)
+    PACK_VERTICES_CASE(VERTEX_FORMAT_TEXCOORD)
+    PACK_VERTICES_CASE(VERTEX_FORMAT_NORMAL | VERTEX_FORMAT_TEXCOORD)
+  }
+}
+
+#undef PACK_VERTICES_CASE
+
+static inline __attribute__((always_inline)) void unpack_vertices_kernel(const char* vertexData, uint32_t format, size_t count, char* positions, char* normals, char* texCoords) {
+  const uint32_t stride = vertex_format_stride(format);
+  const uint32_t texCoordOffset = vertex_format_texcoord_offset(format);
+  size_t i = 0;
+#ifdef VERTEX_PACK_SIMD
+  for(; i + 1 < count; i++) {
+    const char* vertex = vertexData + i*stride;
+    vertex_pack_store(positions + i*3*sizeof(float), vertex_pack_load(vertex));
+    if(format & VERTEX_FORMAT_NORMAL) vertex_pack_store(normals + i*3*sizeof(float), vertex_pack_load(vertex + 3*sizeof(float)));
+    if(format & VERTEX_FORMAT_TEXCOORD) vertex_pack_store(texCoords + i*2*sizeof(float), vertex_pack_load(vertex + texCoordOffset));
+  }
+#endif
+  for(; i < count; i++) {
+    const char* vertex = vertexData + i*stride;
+    memcpy(positions + i*3*sizeof(float), vertex, 3*sizeof(float));
+    if(format & VERTEX_FORMAT_NORMAL) memcpy(normals + i*3*sizeof(float), vertex + 3*sizeof(float), 3*sizeof(float));
+    if(format & VERTEX_FORMAT_TEXCOORD) memcpy(texCoords + i*2*sizeof(float), vertex + texCoordOffset, 2*sizeof(float));
+  }
+}
+
+#define UNPACK_VERTICES_CASE(format) case format: unpack_vertices_kernel(vertexData, format, count, (char*)positions, (char*)normals, (char*)texCoords); break;
+
+/* Splits count interleaved vertices of format (not a compressed one) into tight arrays, 3 floats per position and normal and 2 per texture coordinate.
+ * The arrays of attributes that aren't in the format aren't touched (and can be NULL)
+*/
+void unpack_vertices(const void* vertexData, uint32_t format, size_t count, float* positions, float* normals, float* texCoords) {
+  switch(format) {
+    UNPACK_VERTICES_CASE(0)
+    UNPACK_VERTICES_CASE(VERTEX_FORMAT_NORMAL)
+    UNPACK_VERTICES_CASE(VERTEX_FORMAT_TEXCOORD)
+    UNPACK_VERTICES_CASE(VERTEX_FORMAT_NORMAL | VERTEX_FORMAT_TEXCOORD)
+  }
+}
+
+#undef UNPACK_VERTICES_CASE
+
+#endif
@@ -0,0 +1,78 @@
+// build and run with build/test.sh arena
+#define MEMORY_TRACKING
+#include "../src/data_types/arena.c"
+#include "test.c"
+
+static int64_t tag_current(MemoryTag tag) { return atomic_load(&memoryStats[tag].current); }
+
+// Bytes are charged to the tag that is current when they are allocated and a rewind gives them back to those tags
+static void test_two_tags(void) {
+  Arena arena = create_virtual_arena(1 << 20);
+  arena_alloc(&arena, 256);
+
+  memory_push_tag(MEMORY_TAG_MESH);
+  ScratchArena scratch = create_scratch_arena(&arena);
+  arena_alloc(&arena, 1000);
+  memory_push_tag(MEMORY_TAG_GLTF);
+  arena_alloc(&arena, 500);
+  memory_pop_tag();
+  arena_alloc(&arena, 24);
+  memory_pop_tag();
+  CHECK(tag_current(MEMORY_TAG_UNTAGGED) == 256);
+  CHECK(tag_current(MEMORY_TAG_MESH) >= 1024);
+  CHECK(tag_current(MEMORY_TAG_GLTF) >= 500);
+
+  //released under a tag that charged nothing
+  memory_push_tag(MEMORY_TAG_SHADER);
+  release_scratch_arena(scratch);
+  memory_pop_tag();
+  CHECK(tag_current(MEMORY_TAG_MESH) == 0);
+  CHECK(tag_current(MEMORY_TAG_GLTF) == 0);
+  CHECK(tag_current(MEMORY_TAG_SHADER) == 0);
+  CHECK(tag_current(MEMORY_TAG_UNTAGGED) == 256);
+
+  //a rewind into the middle of a run only gives back the part above the mark
+  memory_push_tag(MEMORY_TAG_MESH);
+  char* block = arena_alloc_align(&arena, 100, 1);
+  arena_realloc(&arena, block, 100, 40, 1);
+  CHECK(tag_current(MEMORY_TAG_MESH) == 40);
+  arena_realloc(&arena, block, 40, 300, 1);
+  memory_pop_tag();
+  CHECK(tag_current(MEMORY_TAG_MESH) == 300);
+
+  arena_clear(&arena);
+  for(uint8_t i = 0; i < MEMORY_TAG_COUNT; i++) CHECK(tag_current(i) == 0);
+  free_arena(&arena);
+}
+
+// Past ARENA_TAG_RUN_COUNT runs the bytes go to the last run, the totals still come back to 0
+static void test_run_overflow(void) {
+  Arena arena = create_virtual_arena(1 << 20);
+  for(uint32_t i = 0; i < 3*ARENA_TAG_RUN_COUNT; i++) {
+    memory_push_tag(i & 1 ? MEMORY_TAG_MESH : MEMORY_TAG_MATERIAL);
+    arena_alloc(&arena, 64);
+    memory_pop_tag();
+  }
+  CHECK(tag_current(MEMORY_TAG_MESH) + tag_current(MEMORY_TAG_MATERIAL) == 3*ARENA_TAG_RUN_COUNT*64);
+  free_arena(&arena);
+  for(uint8_t i = 0; i < MEMORY_TAG_COUNT; i++) CHECK(tag_current(i) == 0);
+}
+
+// The atomic arena keeps the tag it was created under
+static void test_atomic_arena(void) {
+  memory_push_tag(MEMORY_TAG_FRAME);
+  AtomicArena arena = create_virtual_atomic_arena(1 << 20);
+  memory_pop_tag();
+  atomic_arena_alloc(&arena, 128);
+  CHECK(tag_current(MEMORY_TAG_FRAME) == 128);
+  CHECK(tag_current(MEMORY_TAG_UNTAGGED) == 0);
+  free_atomic_arena(&arena);
+  CHECK(tag_current(MEMORY_TAG_FRAME) == 0);
+}
+
+int main(void) {
+  test_two_tags();
+  test_run_overflow();
+  test_atomic_arena();
+  return test_result("arena");
+}
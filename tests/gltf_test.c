@@ -0,0 +1,31 @@
+// build and run with build/test.sh gltf
+#include "../src/gltf.c"
+#include "test.c"
+
+// Parses a glTF with a single buffer of the given byteLength, returns -1 when the parse fails
+static int64_t parse_buffer_length(const char* byteLength) {
+  Arena arena = create_virtual_arena(1 << 20);
+  char json[256];
+  snprintf(json, sizeof(json), "{\"asset\": {\"version\": \"2.0\"}, \"buffers\": [{\"byteLength\": %s}]}", byteLength);
+  GLTF gltf;
+  int64_t result = parse_gltf(&arena, (String){.data=json, .len=strlen(json)}, &gltf) ? (int64_t)gltf.buffers.data[0].byteLength : -1;
+  free_arena(&arena);
+  return result;
+}
+
+// Integers written with a fraction or an exponent are accepted, values an int64_t can't hold fail the parse
+static void test_integer_range(void) {
+  CHECK(parse_buffer_length("1000") == 1000);
+  CHECK(parse_buffer_length("1e3") == 1000);
+  CHECK(parse_buffer_length("1000.0") == 1000);
+  CHECK(parse_buffer_length("1e30") == -1);
+  CHECK(parse_buffer_length("-1e30") == -1);
+  CHECK(parse_buffer_length("1e300") == -1);
+  CHECK(parse_buffer_length("99999999999999999999") == -1);
+  CHECK(parse_buffer_length("-1") == -1);
+}
+
+int main(void) {
+  test_integer_range();
+  return test_result("gltf");
+}
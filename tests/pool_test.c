@@ -0,0 +1,112 @@
+// build and run with build/test.sh pool
+#define MEMORY_TRACKING
+#include "../src/data_types/pool.c"
+#include "test.c"
+
+DEFINE_SPARSE_POOL(int)
+DEFINE_CONCURRENT_POOL(int)
+
+static int64_t tag_current(MemoryTag tag) { return atomic_load(&memoryStats[tag].current); }
+
+// A heap pool is charged to the tag it was created under, whatever tag is current when it's freed
+static void test_memory_tag(void) {
+  memory_push_tag(MEMORY_TAG_MESH);
+  SparsePool(int) sparsePool = create_sparse_pool(int, NULL, 64);
+  ConcurrentPool(int) concurrentPool = create_concurrent_pool(int, NULL, 64);
+  memory_pop_tag();
+  CHECK(tag_current(MEMORY_TAG_MESH) > 0);
+
+  memory_push_tag(MEMORY_TAG_MATERIAL);
+  free_sparse_pool(int, &sparsePool);
+  free_concurrent_pool(int, &concurrentPool);
+  memory_pop_tag();
+  CHECK(tag_current(MEMORY_TAG_MESH) == 0);
+  CHECK(tag_current(MEMORY_TAG_MATERIAL) == 0);
+}
+
+// Handles to removed elements stop matching, freed slots are reused and iteration only sees the live elements
+static void test_sparse_pool(void) {
+  SparsePool(int) pool = create_sparse_pool(int, NULL, 8);
+  PoolHandle handles[8];
+  for(int i = 0; i < 8; i++) handles[i] = sparse_pool_insert(int, &pool, i);
+  CHECK(!sparse_pool_contains(int, &pool, POOL_INVALID_HANDLE));
+  for(int i = 0; i < 8; i++) CHECK(*sparse_pool_get(int, &pool, handles[i]) == i);
+
+  //a full pool hands out the invalid handle
+  CHECK(sparse_pool_insert(int, &pool, 8) == POOL_INVALID_HANDLE);
+
+  CHECK(sparse_pool_remove(int, &pool, handles[2]));
+  CHECK(sparse_pool_remove(int, &pool, handles[5]));
+  CHECK(!sparse_pool_remove(int, &pool, handles[2]));
+  CHECK(!sparse_pool_contains(int, &pool, handles[2]));
+  CHECK(sparse_pool_get(int, &pool, handles[5]) == NULL);
+  //the element swapped into the hole is still found through its handle
+  CHECK(*sparse_pool_get(int, &pool, handles[7]) == 7);
+
+  //the freed slot is reused with a new generation, the old handle still doesn't match
+  PoolHandle reused = sparse_pool_insert(int, &pool, 50);
+  CHECK(pool_handle_index(reused) == pool_handle_index(handles[5]));
+  CHECK(reused != handles[5]);
+  CHECK(sparse_pool_get(int, &pool, handles[5]) == NULL);
+  CHECK(*sparse_pool_get(int, &pool, reused) == 50);
+
+  int sum = 0;
+  size_t visited = 0;
+  sparse_pool_foreach(int, &pool, value, {
+    sum += *value;
+    visited++;
+  });
+  CHECK(visited == 7 && pool.count == 7);
+  CHECK(sum == 0 + 1 + 3 + 4 + 6 + 7 + 50);
+  for(size_t i = 0; i < pool.count; i++) CHECK(sparse_pool_get(int, &pool, sparse_pool_handle_at(&pool, i)) == &pool.dense[i]);
+
+  //a slot removed often enough wraps its generation without ever giving out generation 0
+  PoolHandle handle = handles[0];
+  bool generationZero = false;
+  for(uint32_t i = 0; i < 2*POOL_HANDLE_GENERATION_MASK; i++) {
+    sparse_pool_remove(int, &pool, handle);
+    handle = sparse_pool_insert(int, &pool, 0);
+    if(!pool_handle_generation(handle)) generationZero = true;
+  }
+  CHECK(!generationZero);
+
+  sparse_pool_clear(int, &pool);
+  CHECK(pool.count == 0);
+  CHECK(!sparse_pool_contains(int, &pool, reused));
+  CHECK(!sparse_pool_contains(int, &pool, handles[7]));
+  free_sparse_pool(int, &pool);
+}
+
+static void* thread_slot_main(void* data) {
+  ConcurrentPool(int)* pool = data;
+  int* element = concurrent_pool_alloc(int, pool);
+  concurrent_pool_free(int, pool, element);
+  return (void*)(uintptr_t)concurrent_pool_thread_slot();
+}
+
+// Threads that exit give their slot back, so more threads than CONCURRENT_POOL_MAX_THREADS over time all get a magazine
+static void test_thread_slots(void) {
+  ConcurrentPool(int) pool = create_concurrent_pool(int, NULL, 64);
+  uint32_t slotsTaken = 0;
+  for(uint32_t i = 0; i < 2*CONCURRENT_POOL_MAX_THREADS; i++) {
+    pthread_t thread;
+    void* slot;
+    if(pthread_create(&thread, NULL, thread_slot_main, &pool) != 0) break;
+    pthread_join(thread, &slot);
+    if((uintptr_t)slot < CONCURRENT_POOL_MAX_THREADS) slotsTaken++;
+  }
+  CHECK(slotsTaken == 2*CONCURRENT_POOL_MAX_THREADS);
+
+  //the indices left in the recycled magazine are still handed out
+  size_t allocated = 0;
+  while(concurrent_pool_alloc(int, &pool)) allocated++;
+  CHECK(allocated == 64);
+  free_concurrent_pool(int, &pool);
+}
+
+int main(void) {
+  test_memory_tag();
+  test_sparse_pool();
+  test_thread_slots();
+  return test_result("pool");
+}
@@ -0,0 +1,98 @@
+// build and run with build/test.sh resource
+#include "../src/resource.c"
+#include "test.c"
+
+// The matrix the scene graph rebuilds from a cooked node: rotation with each column scaled
+static void compose_node_matrix(const MeshCacheNode* node, mat4 result) {
+  versor rotation;
+  memcpy(rotation, node->rotation, sizeof(rotation));
+  glm_quat_mat4(rotation, result);
+  for(uint8_t i = 0; i < 3; i++) {
+    for(uint8_t k = 0; k < 3; k++) result[i][k] *= node->scale[i];
+  }
+  for(uint8_t k = 0; k < 3; k++) result[3][k] = node->translation[k];
+}
+
+// Cooks a node given as a matrix and checks that its translation, rotation and scale give back the same matrix
+static void check_node_matrix(const mat4 matrix) {
+  GLTFNode node = {.mesh=0, .hasMatrix=true};
+  memcpy(node.matrix, matrix, sizeof(node.matrix));
+  MeshCacheNode cooked;
+  cook_gltf_node(&node, -1, &cooked);
+
+  float length = sqrtf(cooked.rotation[0]*cooked.rotation[0] + cooked.rotation[1]*cooked.rotation[1]
+    + cooked.rotation[2]*cooked.rotation[2] + cooked.rotation[3]*cooked.rotation[3]);
+  CHECK_NEAR(length, 1.0f, 1e-4f);
+
+  mat4 composed;
+  compose_node_matrix(&cooked, composed);
+  for(uint8_t i = 0; i < 4; i++) {
+    for(uint8_t k = 0; k < 4; k++) CHECK_NEAR(composed[i][k], matrix[i][k], 1e-4f);
+  }
+}
+
+// translation (1, 2, 3), 30 degrees around z and the given scale, column major like glTF
+static void make_trs_matrix(vec3 scale, mat4 result) {
+  float c = cosf(M_PI/6.0f), s = sinf(M_PI/6.0f);
+  mat4 matrix = {
+    {c*scale[0], s*scale[0], 0.0f, 0.0f},
+    {-s*scale[1], c*scale[1], 0.0f, 0.0f},
+    {0.0f, 0.0f, scale[2], 0.0f},
+    {1.0f, 2.0f, 3.0f, 1.0f},
+  };
+  memcpy(result, matrix, sizeof(matrix));
+}
+
+static void test_node_matrix(void) {
+  mat4 matrix;
+  make_trs_matrix((vec3){2.0f, 3.0f, 4.0f}, matrix);
+  check_node_matrix(matrix);
+  //mirrored along one and along all three axes
+  make_trs_matrix((vec3){-2.0f, 3.0f, 4.0f}, matrix);
+  check_node_matrix(matrix);
+  make_trs_matrix((vec3){2.0f, 3.0f, -4.0f}, matrix);
+  check_node_matrix(matrix);
+  make_trs_matrix((vec3){-2.0f, -3.0f, -4.0f}, matrix);
+  check_node_matrix(matrix);
+}
+
+// Loads a glTF with one data uri buffer, returns false when the buffer is rejected
+static bool load_data_uri_buffer(const char* uri, size_t byteLength, Bytes* result) {
+  Arena arena = create_virtual_arena(1 << 20);
+  char json[256];
+  snprintf(json, sizeof(json), "{\"asset\": {\"version\": \"2.0\"}, \"buffers\": [{\"uri\": \"%s\", \"byteLength\": %zu}]}", uri, byteLength);
+  GLTF gltf;
+  bool loaded = parse_gltf(&arena, (String){json, strlen(json)}, &gltf);
+  Bytes bytes = {0};
+  FileView view;
+  loaded = loaded && load_gltf_buffers(&arena, &gltf, (String){0}, (String){0}, &bytes, &view);
+  if(loaded) {
+    *result = (Bytes){malloc(bytes.len), bytes.len};
+    memcpy(result->data, bytes.data, bytes.len);
+  }
+  free_arena(&arena);
+  return loaded;
+}
+
+// A data uri is only decoded when it holds exactly byteLength bytes
+static void test_data_uri_length(void) {
+  Bytes bytes;
+  CHECK(load_data_uri_buffer("data:application/octet-stream;base64,AAEC", 3, &bytes));
+  CHECK(bytes.len == 3 && bytes.data[0] == 0 && bytes.data[1] == 1 && bytes.data[2] == 2);
+  free(bytes.data);
+  CHECK(load_data_uri_buffer("data:application/octet-stream;base64,AAE=", 2, &bytes));
+  CHECK(bytes.len == 2 && bytes.data[0] == 0 && bytes.data[1] == 1);
+  free(bytes.data);
+
+  CHECK(!load_data_uri_buffer("data:application/octet-stream;base64,AAEC", 64, &bytes));
+  CHECK(!load_data_uri_buffer("data:application/octet-stream;base64,AAECAwQF", 3, &bytes));
+  CHECK(!load_data_uri_buffer("data:application/octet-stream;base64,AAE", 2, &bytes));
+  CHECK(!load_data_uri_buffer("data:application/octet-stream;base64,AA!C", 3, &bytes));
+  CHECK(!load_data_uri_buffer("data:application/octet-stream;base32,AAEC", 3, &bytes));
+}
+
+int main(void) {
+  test_node_matrix();
+  test_data_uri_length();
+  return test_result("resource");
+}
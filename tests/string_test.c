@@ -0,0 +1,62 @@
+// build and run with build/test.sh string
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/data_types/string.c"
+#include "test.c"
+
+static bool parses_like_strtof(const char* text) {
+  float value = 0.0f;
+  size_t used = string_parse_float((String){text, strlen(text)}, &value);
+  char* end;
+  float expected = strtof(text, &end);
+  return used == (size_t)(end - text) && memcmp(&value, &expected, sizeof(float)) == 0;
+}
+
+// More digits than the 19 that fit in the mantissa go to strtof, however long the token is
+static void test_long_tokens(void) {
+  //2^24 + 1 is halfway between two floats, only the 1 at the very end decides to round up
+  char halfway[256] = "16777217.";
+  memset(halfway + strlen(halfway), '0', 100);
+  strcat(halfway, "1");
+  CHECK(strlen(halfway) > STRING_FLOAT_FALLBACK_STACK);
+  CHECK(parses_like_strtof(halfway));
+  float value = 0.0f;
+  string_parse_float((String){halfway, strlen(halfway)}, &value);
+  CHECK(value == 16777218.0f);
+
+  char below[256] = "16777216.99999999999999999999999999999999999999999999999999999999999999999999999999999999999";
+  CHECK(parses_like_strtof(below));
+  CHECK(parses_like_strtof("0.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001e-40"));
+  CHECK(parses_like_strtof("3.40282356779733661637539395458142568448e38"));
+  CHECK(parses_like_strtof("1.00000005960464477539062500000000000000000000000000000000000000000000001"));
+}
+
+static void test_spellings(void) {
+  CHECK(parses_like_strtof("inf"));
+  CHECK(parses_like_strtof("-Infinity"));
+  CHECK(parses_like_strtof("nan"));
+  CHECK(parses_like_strtof("1.5e3"));
+  CHECK(parses_like_strtof("-0.0"));
+  float value = 1.0f;
+  CHECK(string_parse_float(create_string_from_literal("x1.0"), &value) == 0);
+}
+
+// A token that isn't a float only looks at itself, not the rest of a large input
+static void test_bad_token_in_large_input(void) {
+  size_t size = (size_t)64 << 20;
+  char* text = malloc(size);
+  memset(text, ' ', size);
+  memcpy(text, "1.0 2.0 x", 9);
+  float values[4];
+  CHECK(string_parse_floats((String){text, size}, values, 4) == 2);
+  CHECK(values[0] == 1.0f && values[1] == 2.0f);
+  free(text);
+}
+
+int main(void) {
+  test_long_tokens();
+  test_spellings();
+  test_bad_token_in_large_input();
+  return test_result("string");
+}
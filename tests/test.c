@@ -0,0 +1,30 @@
+#ifndef TEST_IMPL
+#define TEST_IMPL
+
+#include <stdio.h>
+#include <math.h>
+
+/* Tests are plain programs, build/test.sh builds every tests/<name>_test.c and runs it.
+ * A failed CHECK prints where it is and the test goes on, test_result is what main returns
+*/
+static int testFailures;
+static int testChecks;
+
+#define CHECK(condition) do {\
+    testChecks++;\
+    if(!(condition)) {\
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);\
+      fflush(stderr);\
+      testFailures++;\
+    }\
+  } while(0)
+
+#define CHECK_NEAR(a, b, epsilon) CHECK(fabs((double)(a) - (double)(b)) <= (epsilon))
+
+static int test_result(const char* name) {
+  if(testFailures) fprintf(stderr, "%s: %d of %d checks failed\n", name, testFailures, testChecks);
+  else printf("%s: %d checks passed\n", name, testChecks);
+  return testFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,253 @@
+/* Runs the mesh optimization passes and the meshlet build on the primitives of glTF files without a window or GL context and reports
+ * what each pass does to the vertex cache (ACMR/ATVR), the vertex fetch and the overdraw, and how much the meshlets cull.
+ * The primitives are read the way cook_gltf reads them, nothing is written.
+ * build and run with build/tool.sh optimize_meshes [--cache-size n] [--threshold x] files...
+ * The checksum is of the final indices, vertices and meshlets, it's the same on every run.
+ * Every primitive is also cooked with optimize_mesh at the default settings, the tool fails when that ends with a worse ACMR than the input
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/resource.c"
+
+typedef struct {
+  uint32_t cacheSize;
+  float threshold;
+} OptimizeOptions;
+
+static bool acmrWorse;
+
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+static void print_stage(Arena* arena, const char* name, const uint32_t* indices, size_t indexCount, uint32_t vertexCount, size_t vertexStride, VertexStream position, uint32_t cacheSize) {
+  VertexCacheStats stats = analyze_vertex_cache(arena, indices, indexCount, vertexCount, cacheSize);
+  float overfetch = analyze_vertex_fetch(arena, indices, indexCount, vertexCount, vertexStride, cacheSize);
+  float overdraw = analyze_overdraw(arena, indices, indexCount, position, vertexCount);
+  printf("  %-14s %8.3f %8.3f %10.3f %9.3f\n", name, stats.acmr, stats.atvr, overfetch, overdraw);
+}
+
+// The planes of a 90 degree view from camera down axis (the negative direction when flip), without a far plane
+static void axis_view_planes(const float camera[3], uint8_t axis, bool flip, float planes[6][4]) {
+  for(uint8_t i = 0; i < 6; i++) {
+    float normal[3] = {0.0f, 0.0f, 0.0f};
+    normal[axis] = flip ? -1.0f : 1.0f;
+    //the side planes lean 45 degrees out, the last two are both the near plane through the camera
+    if(i < 4) normal[(axis + 1 + i/2) % 3] = i & 1 ? -1.0f : 1.0f;
+    float length = sqrtf(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+    planes[i][3] = 0.0f;
+    for(uint8_t k = 0; k < 3; k++) {
+      planes[i][k] = normal[k] / length;
+      planes[i][3] -= planes[i][k]*camera[k];
+    }
+  }
+}
+
+/* The frustum test is a cube map of 90 degree views from the center of the mesh, every triangle is in one of them so drawing
+ * whole meshes draws 6 triangles per triangle and perfect culling 1.
+ * The cone test is from a camera on each side of the mesh, next to the share of triangles that face away from it
+*/
+static void print_meshlet_culling(const Meshlet* meshlets, size_t meshletCount, const uint32_t* indices, size_t indexCount, VertexStream position, uint32_t vertexCount) {
+  float boundsMin[3], boundsMax[3], center[3];
+  vertex_position_bounds(position, vertexCount, boundsMin, boundsMax);
+  float extent = 0.0f;
+  for(uint8_t k = 0; k < 3; k++) {
+    center[k] = (boundsMin[k] + boundsMax[k])*0.5f;
+    extent = fmaxf(extent, boundsMax[k] - boundsMin[k]);
+  }
+  size_t vertices = 0, cones = 0;
+  for(size_t i = 0; i < meshletCount; i++) {
+    vertices += meshlets[i].vertexCount;
+    cones += meshlets[i].coneCutoff < 1.0f;
+  }
+
+  size_t frustumDrawn = 0, coneCulled = 0, backFacing = 0;
+  float everything[6][4] = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 1.0f}};
+  for(uint8_t view = 0; view < 6; view++) {
+    float planes[6][4];
+    axis_view_planes(center, view >> 1, view & 1, planes);
+    float camera[3] = {center[0], center[1], center[2]};
+    camera[view >> 1] += (view & 1 ? -2.0f : 2.0f)*extent;
+    for(size_t i = 0; i < meshletCount; i++) {
+      if(meshlet_visible(&meshlets[i], planes, NULL)) frustumDrawn += meshlets[i].triangleCount;
+      if(!meshlet_visible(&meshlets[i], everything, camera)) coneCulled += meshlets[i].triangleCount;
+    }
+    for(size_t i = 0; i + 2 < indexCount; i += 3) {
+      float p0[3], p1[3], p2[3];
+      load_position(position, indices[i], p0);
+      load_position(position, indices[i + 1], p1);
+      load_position(position, indices[i + 2], p2);
+      float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      float n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+      backFacing += n[0]*(p0[0] - camera[0]) + n[1]*(p0[1] - camera[1]) + n[2]*(p0[2] - camera[2]) >= 0.0f;
+    }
+  }
+  size_t triangleCount = indexCount/3;
+  printf("  %zu meshlets, %.1f vertices and %.1f triangles each, %.0f%% have a cone\n", meshletCount, (float)vertices / meshletCount,
+    (float)triangleCount / meshletCount, 100.0f*cones / meshletCount);
+  printf("  frustum: %.2f triangles drawn per triangle for a cube map from the center, cones: %.1f%% culled from the sides where %.1f%% face away\n",
+    (float)frustumDrawn / triangleCount, 100.0f*coneCulled / (6*triangleCount), 100.0f*backFacing / (6*triangleCount));
+}
+
+// The passes one at a time, the way optimize_mesh runs them. False when the primitive is skipped
+static bool optimize_primitive(Arena* arena, const Array(Bytes)* bufferArray, const GLTF* gltf, GLTFCookPrimitive* primitive, uint32_t index, OptimizeOptions options, VertexCacheStats* total) {
+  uint32_t vertexCount = primitive->position.count;
+  size_t indexCount = primitive->indexCount;
+  printf("primitive %u (mesh %u): %zu triangles, %u vertices\n", index, primitive->mesh, indexCount/3, vertexCount);
+  if(!primitive->triangles || indexCount % 3) {
+    printf("  not a triangle list, skipped\n");
+    return false;
+  }
+  ScratchArena scratch = create_scratch_arena(arena);
+  uint32_t stride = vertex_format_stride(primitive->format);
+  char* vertexData = arena_alloc(arena, (size_t)vertexCount*stride);
+  float boundsMin[3], boundsMax[3];
+  cook_gltf_vertices(primitive, vertexData, boundsMin, boundsMax);
+  //always 32 bit here, the passes work on those
+  primitive->indexType = GL_UNSIGNED_INT;
+  uint32_t* indices = arena_alloc_array(arena, uint32_t, indexCount);
+  uint32_t* reordered = arena_alloc_array(arena, uint32_t, indexCount);
+  cook_gltf_indices(bufferArray, gltf, primitive, indices);
+  for(size_t i = 0; i < indexCount; i++) {
+    if(indices[i] < vertexCount) continue;
+    printf("  index %u is past the vertices, skipped\n", indices[i]);
+    release_scratch_arena(scratch);
+    return false;
+  }
+  VertexStream position = {primitive->position.data, primitive->position.stride};
+  VertexCacheStats before = analyze_vertex_cache(arena, indices, indexCount, vertexCount, options.cacheSize);
+
+  printf("  %-14s %8s %8s %10s %9s\n", "stage", "ACMR", "ATVR", "overfetch", "overdraw");
+  print_stage(arena, "original", indices, indexCount, vertexCount, stride, position, options.cacheSize);
+  double start = now_seconds();
+  optimize_vertex_cache(arena, reordered, indices, indexCount, vertexCount, options.cacheSize);
+  double vertexCacheTime = now_seconds() - start;
+  print_stage(arena, "vertex cache", reordered, indexCount, vertexCount, stride, position, options.cacheSize);
+
+  start = now_seconds();
+  optimize_overdraw(arena, indices, reordered, indexCount, position, vertexCount, options.cacheSize, options.threshold);
+  double overdrawTime = now_seconds() - start;
+  print_stage(arena, "overdraw", indices, indexCount, vertexCount, stride, position, options.cacheSize);
+
+  start = now_seconds();
+  Meshlet* meshlets = arena_alloc_array(arena, Meshlet, meshlet_count_bound(indexCount));
+  size_t meshletCount = build_meshlets(arena, meshlets, reordered, indices, indexCount, position, vertexCount);
+  memcpy(indices, reordered, indexCount*sizeof(uint32_t));
+  optimize_meshlet_vertex_cache(arena, indices, meshlets, meshletCount, vertexCount, options.cacheSize);
+  double meshletTime = now_seconds() - start;
+  print_stage(arena, "meshlets", indices, indexCount, vertexCount, stride, position, options.cacheSize);
+
+  //the positions are remapped with the vertices so the overdraw can still be measured
+  start = now_seconds();
+  uint32_t* remap = arena_alloc_array(arena, uint32_t, vertexCount);
+  optimize_vertex_fetch_remap(remap, indices, indexCount, vertexCount);
+  remap_indices(indices, indexCount, remap);
+  char* remapped = arena_alloc(arena, (size_t)vertexCount*stride);
+  remap_vertices(remapped, vertexData, vertexCount, stride, remap);
+  double remapTime = now_seconds() - start;
+  float* positions = arena_alloc_array(arena, float, (size_t)vertexCount*3);
+  for(uint32_t i = 0; i < vertexCount; i++) memcpy(positions + remap[i]*3, (const char*)position.data + i*position.stride, 3*sizeof(float));
+  print_stage(arena, "fetch remap", indices, indexCount, vertexCount, stride, (VertexStream){positions, 3*sizeof(float)}, options.cacheSize);
+
+  VertexCacheStats after = analyze_vertex_cache(arena, indices, indexCount, vertexCount, options.cacheSize);
+  print_meshlet_culling(meshlets, meshletCount, indices, indexCount, (VertexStream){positions, 3*sizeof(float)}, vertexCount);
+  uint64_t checksum = wyhash(indices, indexCount*sizeof(uint32_t), wyhash(remapped, (size_t)vertexCount*stride, wyhash(meshlets, meshletCount*sizeof(Meshlet), 0)));
+  printf("  vertex cache %.3f ms, overdraw %.3f ms, meshlets %.3f ms, fetch remap %.3f ms, checksum %016llx\n", vertexCacheTime*1e3, overdrawTime*1e3,
+    meshletTime*1e3, remapTime*1e3, (unsigned long long)checksum);
+
+  //what cook_gltf writes, from a fresh copy of the primitive
+  cook_gltf_vertices(primitive, vertexData, boundsMin, boundsMax);
+  cook_gltf_indices(bufferArray, gltf, primitive, indices);
+  MeshOptimizeStats cooked = optimize_mesh(arena, indices, sizeof(uint32_t), indexCount, vertexData, stride, vertexCount, position, meshlets);
+  printf("  cooked ACMR %.3f -> %.3f with %zu meshlets\n", cooked.before.acmr, cooked.after.acmr, cooked.meshletCount);
+  if(cooked.after.acmr > cooked.before.acmr) {
+    fprintf(stderr, "primitive %u: the cooked ACMR %.3f is worse than the input's %.3f\n", index, cooked.after.acmr, cooked.before.acmr);
+    fflush(stderr);
+    acmrWorse = true;
+  }
+
+  //triangle weighted sums, main divides them
+  total[0].acmr += before.acmr*(indexCount/3);
+  total[0].atvr += before.atvr*(indexCount/3);
+  total[1].acmr += after.acmr*(indexCount/3);
+  total[1].atvr += after.atvr*(indexCount/3);
+  release_scratch_arena(scratch);
+  return true;
+}
+
+static bool optimize_file(Arena* arena, String filePath, OptimizeOptions options) {
+  FileView sourceView = open_file_view(filePath, FILE_VIEW_NORMAL);
+  GLBChunks chunks = {file_view_string(sourceView), {0}};
+  GLTF gltf;
+  if(!chunks.json.len || (is_glb(chunks.json) && !read_glb_chunks(file_view_string(sourceView), &chunks)) || !parse_gltf(arena, chunks.json, &gltf)) {
+    close_file_view(&sourceView);
+    return false;
+  }
+  int32_t index = string_find_reverse(filePath, '/');
+  String parentPath = index == -1 ? (String){0} : string_span(filePath.data, filePath.data+index+1);
+
+  size_t bufferCount = gltf.buffers.length;
+  Bytes* bufferData = arena_alloc_array(arena, Bytes, bufferCount);
+  Array(Bytes) bufferArray = create_array(Bytes, bufferData, bufferCount);
+  FileView* bufferViews = arena_alloc_array(arena, FileView, bufferCount);
+  if(!load_gltf_buffers(arena, &gltf, parentPath, chunks.bin, bufferData, bufferViews)) {
+    close_file_view(&sourceView);
+    return false;
+  }
+
+  printf("%.*s\n", (int)filePath.len, filePath.data);
+  VertexCacheStats total[2] = {0};
+  size_t triangleCount = 0;
+  uint32_t primitiveIndex = 0;
+  for(size_t i = 0; i < gltf.meshes.length; i++) {
+    const GLTFMesh* mesh = array_index(GLTFMesh, &gltf.meshes, i);
+    for(uint32_t j = 0; j < mesh->primitiveCount; j++) {
+      GLTFCookPrimitive primitive;
+      if(!gather_gltf_primitive(arena, &bufferArray, &gltf, array_index(GLTFPrimitive, &gltf.primitives, mesh->firstPrimitive + j), i, &primitive)) continue;
+      if(optimize_primitive(arena, &bufferArray, &gltf, &primitive, primitiveIndex++, options, total)) triangleCount += primitive.indexCount/3;
+    }
+  }
+  if(triangleCount) {
+    printf("total %zu triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n\n", triangleCount, total[0].acmr/triangleCount, total[1].acmr/triangleCount,
+      total[0].atvr/triangleCount, total[1].atvr/triangleCount);
+  }
+
+  for(size_t i = 0; i < bufferCount; i++) close_file_view(&bufferViews[i]);
+  close_file_view(&sourceView);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  OptimizeOptions options = {MESH_OPTIMIZE_CACHE_SIZE, MESH_OPTIMIZE_OVERDRAW_THRESHOLD};
+  Arena arena = create_virtual_arena((size_t)1 << 34);
+  int result = 0;
+  bool anyFile = false;
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--cache-size") && i + 1 < argc) {
+      options.cacheSize = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "--threshold") && i + 1 < argc) {
+      options.threshold = atof(argv[++i]);
+      continue;
+    }
+    anyFile = true;
+    ScratchArena scratch = create_scratch_arena(&arena);
+    if(!optimize_file(&arena, (String){argv[i], strlen(argv[i])}, options)) {
+      fprintf(stderr, "Failed to load %s\n", argv[i]);
+      result = 1;
+    }
+    release_scratch_arena(scratch);
+  }
+  if(!anyFile) {
+    fprintf(stderr, "usage: %s [--cache-size n] [--threshold x] files...\n", argv[0]);
+    return 1;
+  }
+  free_arena(&arena);
+  return result || acmrWorse;
+}